@@ -0,0 +1,99 @@
+#include "ImageTexture.h"
+
+#include "Executor.h"
+#include "Logger.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	ImageTexture::~ImageTexture()
+	{
+		if (texture_id) glDeleteTextures(1, &texture_id);
+	}
+
+	template <typename Type>
+	void ImageTexture::update_pixels(const TImage<Type>& source, const GLenum data_type)
+	{
+		trace_zone("rebuild texture");
+		const int width = source.get_width();
+		const int height = source.get_height();
+		const int display_channels = source.get_display_channels();
+		const GLenum format = display_channels == 1 ? GL_RED : display_channels == 2 ? GL_RG : display_channels == 3 ? GL_RGB : GL_RGBA;
+		const size_t row_size = static_cast<size_t>(width) * display_channels;
+
+		const bool reallocate = width != texture_width || height != texture_height || format != texture_format;
+		if (reallocate || pixels.empty()) dirty_channels = ~0u;
+		pixels.resize(row_size * height * sizeof(Type));
+		Type* destination = reinterpret_cast<Type*>(pixels.data());
+
+		if ((dirty_channels & ((1u << display_channels) - 1)) == ((1u << display_channels) - 1))
+		{
+			TChannelView<Type> views[4];
+			for (int c = 0; c < display_channels; ++c) views[c] = source.get_channel_view(c);
+			Executor::parallel_for_rows(height, row_size * sizeof(Type), [&](const int y_begin, const int y_end)
+			{
+				interleave_views(views, display_channels, destination + y_begin * row_size, y_begin, y_end);
+			});
+		}
+		else
+		{
+			// Other channels are still valid in the interleaved buffer
+			for (int c = 0; c < display_channels; ++c)
+			{
+				if (!(dirty_channels & 1u << c)) continue;
+				const auto& view = source.get_channel_view(c);
+				Executor::parallel_for_rows(height, row_size * sizeof(Type), [&](const int y_begin, const int y_end)
+				{
+					write_channel_view(view, c, display_channels, destination + y_begin * row_size, y_begin, y_end);
+				});
+			}
+		}
+
+		// Rows of 1 or 3 channel images are not 4 bytes aligned
+		trace_zone("upload texture");
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (reallocate)
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, data_type, pixels.data());
+			texture_width = width;
+			texture_height = height;
+			texture_format = format;
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, data_type, pixels.data());
+		}
+
+		if (!editable)
+		{
+			pixels.clear();
+			pixels.shrink_to_fit();
+		}
+	}
+
+	GLuint ImageTexture::get_texture()
+	{
+		if (!dirty_channels || !image || !image->is_valid()) return texture_id;
+
+		if (!texture_id)
+		{
+			glGenTextures(1, &texture_id);
+			glBindTexture(GL_TEXTURE_2D, texture_id);
+			// Previews are always drawn with nearest filtering, so no mipmap is required
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, texture_id);
+		}
+
+		if (auto* ldr_image = dynamic_cast<const Image*>(image.get())) update_pixels(*ldr_image, GL_UNSIGNED_BYTE);
+		else if (auto* image_16 = dynamic_cast<const Image16*>(image.get())) update_pixels(*image_16, GL_UNSIGNED_SHORT);
+		else if (auto* hdr_image = dynamic_cast<const HdrImage*>(image.get())) update_pixels(*hdr_image, GL_FLOAT);
+		else logger_error("unsupported image type for display");
+
+		dirty_channels = 0;
+		return texture_id;
+	}
+}
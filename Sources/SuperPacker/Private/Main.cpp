@@ -33,6 +33,9 @@ int main(int argc, char** argv)
 	packer->add_format({ "TGA file", "*.tga", "tga" });
 	packer->add_format({ "JPEG file", "*.jpg;*.jpeg;*.JPEG;*.JPG", "jpg" });
 	packer->add_format({ "BITMAP file", "*.bmp", "bmp" });
+	packer->add_format({ "DirectDraw Surface", "*.dds", "dds" });
+	packer->add_format({ "KTX texture", "*.ktx", "ktx" });
+	packer->add_format({ "Radiance HDR file", "*.hdr", "hdr" });
 
 	packer->add_channel({0, "red","r",{1, 0.3f, 0.3f, 1},0});
 	packer->add_channel({1, "green","g",{0.1f, 0.6f, 0.1f, 1},0});
@@ -40,6 +43,7 @@ int main(int argc, char** argv)
 	packer->add_channel({3, "alpha","a",{0.5f, 0.5f, 0.5f, 1},255});
 
 	packer->add_channel_combination({ "grayscale", {"r"} });
+	packer->add_channel_combination({ "rg", {"r", "g"} });
 	packer->add_channel_combination({ "rgb", {"r", "g", "b"} });
 	packer->add_channel_combination({ "rgba", {"r", "g", "b", "a"} });
 
@@ -4,9 +4,6 @@
 #include <filesystem>
 #include <iostream>
 
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#endif
 #include <stb_image.h>
 
 
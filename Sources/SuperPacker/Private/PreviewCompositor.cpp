@@ -0,0 +1,196 @@
+#include "PreviewCompositor.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Logger.h"
+
+namespace SuperPacker
+{
+	// Full screen triangle, no vertex buffer required
+	static const char* vertex_shader_source = R"(#version 150
+void main()
+{
+	vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+	gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+	// Samplers can only be indexed with constant expressions in GLSL 1.50
+	static const char* fragment_shader_source = R"(#version 150
+uniform sampler2D sources[4];
+uniform int source_channels[4];
+uniform int assigned[4];
+uniform vec4 default_values;
+uniform int channel_count;
+out vec4 output_color;
+
+float fetch_channel(sampler2D source, int source_channel, int is_assigned, float default_value)
+{
+	if (is_assigned == 0) return default_value;
+	return texelFetch(source, ivec2(gl_FragCoord.xy), 0)[source_channel];
+}
+
+void main()
+{
+	vec4 color = vec4(0.0, 0.0, 0.0, 1.0);
+	if (channel_count > 0) color.r = fetch_channel(sources[0], source_channels[0], assigned[0], default_values.r);
+	if (channel_count > 1) color.g = fetch_channel(sources[1], source_channels[1], assigned[1], default_values.g);
+	if (channel_count > 2) color.b = fetch_channel(sources[2], source_channels[2], assigned[2], default_values.b);
+	if (channel_count > 3) color.a = fetch_channel(sources[3], source_channels[3], assigned[3], default_values.a);
+	output_color = color;
+}
+)";
+
+	static GLuint compile_shader(const GLenum type, const char* source)
+	{
+		const GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint success = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			GLchar log[1024];
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			logger_error("failed to compile preview shader : %s", log);
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+
+	PreviewCompositor::PreviewCompositor()
+	{
+		const GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
+		const GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+		if (vertex_shader && fragment_shader)
+		{
+			program = glCreateProgram();
+			glAttachShader(program, vertex_shader);
+			glAttachShader(program, fragment_shader);
+			glBindFragDataLocation(program, 0, "output_color");
+			glLinkProgram(program);
+
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				GLchar log[1024];
+				glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+				logger_error("failed to link preview shader : %s", log);
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+		if (vertex_shader) glDeleteShader(vertex_shader);
+		if (fragment_shader) glDeleteShader(fragment_shader);
+		if (!program) return;
+
+		sources_location = glGetUniformLocation(program, "sources");
+		source_channels_location = glGetUniformLocation(program, "source_channels");
+		assigned_location = glGetUniformLocation(program, "assigned");
+		default_values_location = glGetUniformLocation(program, "default_values");
+		channel_count_location = glGetUniformLocation(program, "channel_count");
+
+		// Core profile requires a bound vertex array, even without attributes
+		glGenVertexArrays(1, &vertex_array);
+		glGenFramebuffers(1, &framebuffer);
+	}
+
+	PreviewCompositor::~PreviewCompositor()
+	{
+		if (texture) glDeleteTextures(1, &texture);
+		if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+		if (vertex_array) glDeleteVertexArrays(1, &vertex_array);
+		if (program) glDeleteProgram(program);
+	}
+
+	GLuint PreviewCompositor::compose(const std::vector<Channel>& channels, const int width, const int height)
+	{
+		if (!program || width <= 0 || height <= 0) return texture;
+
+		GLint previous_framebuffer = 0;
+		GLint previous_viewport[4];
+		GLint previous_program = 0;
+		GLint previous_vertex_array = 0;
+		GLint previous_active_texture = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+		glGetIntegerv(GL_VIEWPORT, previous_viewport);
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vertex_array);
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &previous_active_texture);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		if (!texture || width != texture_width || height != texture_height)
+		{
+			if (!texture) glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+			texture_width = width;
+			texture_height = height;
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) logger_error("incomplete preview framebuffer");
+		}
+
+		GLint units[4] = { 0, 1, 2, 3 };
+		GLint source_channels[4] = {};
+		GLint assigned[4] = {};
+		GLfloat default_values[4] = {};
+		const int channel_count = std::min(static_cast<int>(channels.size()), 4);
+		for (int c = 0; c < channel_count; ++c)
+		{
+			glActiveTexture(GL_TEXTURE0 + c);
+			glBindTexture(GL_TEXTURE_2D, channels[c].texture);
+			source_channels[c] = channels[c].source_channel;
+			assigned[c] = channels[c].texture != 0;
+			default_values[c] = channels[c].default_value / 255.f;
+		}
+
+		glUseProgram(program);
+		glUniform1iv(sources_location, 4, units);
+		glUniform1iv(source_channels_location, 4, source_channels);
+		glUniform1iv(assigned_location, 4, assigned);
+		glUniform4fv(default_values_location, 1, default_values);
+		glUniform1i(channel_count_location, channel_count);
+
+		glViewport(0, 0, width, height);
+		glDisable(GL_BLEND);
+		glDisable(GL_SCISSOR_TEST);
+		glBindVertexArray(vertex_array);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		// ImGui expects to find its own state when it renders the frame
+		glBindVertexArray(previous_vertex_array);
+		glUseProgram(previous_program);
+		glActiveTexture(previous_active_texture);
+		glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+		glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+
+		return texture;
+	}
+
+	std::vector<uint8_t> PreviewCompositor::read_pixels(const int channel_count) const
+	{
+		if (!texture) return {};
+
+		std::vector<uint8_t> rgba(static_cast<size_t>(texture_width) * texture_height * 4);
+		GLint previous_framebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, texture_width, texture_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+
+		if (channel_count == 4) return rgba;
+		std::vector<uint8_t> pixels(static_cast<size_t>(texture_width) * texture_height * channel_count);
+		for (size_t i = 0; i < static_cast<size_t>(texture_width) * texture_height; ++i)
+		{
+			for (int c = 0; c < channel_count; ++c) pixels[i * channel_count + c] = rgba[i * 4 + c];
+		}
+		return pixels;
+	}
+}
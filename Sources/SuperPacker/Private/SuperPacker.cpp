@@ -1,13 +1,20 @@
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
 #include "SuperPacker.h"
 #include "ApiInteface.h"
+#include "Executor.h"
+#include "ImageCache.h"
+#include "ImageWriter.h"
 #include "IniLoader.h"
 #include "Logger.h"
+#include "Packer.h"
+#include "Resample.h"
+#include "StripWriter.h"
+#include "TextureFile.h"
+#include "Trace.h"
 
 namespace SuperPacker
 {
@@ -17,6 +24,31 @@ namespace SuperPacker
 
 		current_export_format = config_ini->get_property_as_string("defaults", "export_extension", "");
 		current_channel_combination = config_ini->get_property_as_string("defaults", "export_palette", "");
+
+		Executor::set_thread_count(config_ini->get_property_as_int("defaults", "thread_count", 0));
+		ImageCache::set_memory_budget(static_cast<size_t>(config_ini->get_property_as_int("defaults", "cache_budget_mb", 1024)) * 1024 * 1024);
+		set_png_compression_level(config_ini->get_property_as_int("defaults", "png_compression_level", 8));
+		PngFilter png_filter = PngFilter::Adaptive;
+		if (parse_png_filter(config_ini->get_property_as_string("defaults", "png_filter", "adaptive"), png_filter)) set_png_filter(png_filter);
+		set_jpeg_quality(config_ini->get_property_as_int("defaults", "jpeg_quality", 90));
+		Jpeg::Subsampling jpeg_subsampling = Jpeg::Subsampling::S420;
+		if (parse_jpeg_subsampling(config_ini->get_property_as_string("defaults", "jpeg_subsampling", "420"), jpeg_subsampling)) set_jpeg_subsampling(jpeg_subsampling);
+		BlockCompression::Format block_format;
+		if (BlockCompression::parse_format(config_ini->get_property_as_string("defaults", "texture_block_format", "auto"), block_format)) set_texture_block_format(block_format);
+		if (config_ini->get_property_as_int("defaults", "export_mips", 0))
+		{
+			MipSettings mip_settings;
+			if (!parse_mip_filter(config_ini->get_property_as_string("defaults", "mip_filter", "kaiser"), mip_settings.filter)) mip_settings.filter = MipFilter::Kaiser;
+			mip_settings.srgb = config_ini->get_property_as_int("defaults", "mip_srgb", 0) != 0;
+			mip_settings.coverage_thresholds[3] = config_ini->get_property_as_int("defaults", "mip_alpha_coverage", 0) / 255.f;
+			set_export_mips(mip_settings);
+		}
+		ResampleFilter resample_filter;
+		if (parse_resample_filter(config_ini->get_property_as_string("defaults", "resample_filter", "none"), resample_filter)) resample = ResampleSettings{ resample_filter };
+
+		gpu_preview = config_ini->get_property_as_int("defaults", "gpu_preview", 1) != 0;
+		gpu_preview_check = config_ini->get_property_as_int("defaults", "gpu_preview_check", 0) != 0;
+		Trace::set_output(config_ini->get_property_as_string("defaults", "trace_output", ""));
 	}
 
 	void add_tooltip(const std::string& text)
@@ -33,6 +65,8 @@ namespace SuperPacker
 
 	void ImagePacker::draw_ui()
 	{
+		poll_pending_loads();
+
 		if (channel_combinations.find(current_channel_combination) == channel_combinations.end()) current_channel_combination = channel_combinations.begin()->first;
 		if (formats.find(current_export_format) == formats.end()) current_export_format = formats.begin()->first;
 		if (ImGui::Button("Pick source")) if (auto file = pick_file("", formats_string)) reset_from_source(file.value());
@@ -49,7 +83,7 @@ namespace SuperPacker
 		ImGui::Columns(1);
 		
 		if (preview_image) {
-			ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<size_t>(preview_image->get_texture())), ImVec2(200, 200), ImVec2(0, 0), ImVec2(1, 1));
+			ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<size_t>(get_preview_texture())), ImVec2(preview_size, preview_size), ImVec2(0, 0), ImVec2(1, 1));
 			add_tooltip("output preview");
 			ImGui::SameLine();
 			ImGui::Text("preview");
@@ -79,6 +113,44 @@ namespace SuperPacker
 			}
 			ImGui::EndCombo();
 		}
+		if (formats[current_export_format].short_name == "jpg")
+		{
+			int jpeg_quality = get_jpeg_quality();
+			if (ImGui::SliderInt("quality", &jpeg_quality, 1, 100))
+			{
+				set_jpeg_quality(jpeg_quality);
+				config_ini->set_property_as_int("defaults", "jpeg_quality", jpeg_quality);
+			}
+			static constexpr const char* subsampling_names[] = { "444", "422", "420" };
+			int subsampling = static_cast<int>(get_jpeg_subsampling());
+			if (ImGui::Combo("chroma subsampling", &subsampling, subsampling_names, 3))
+			{
+				set_jpeg_subsampling(static_cast<Jpeg::Subsampling>(subsampling));
+				config_ini->set_property_as_string("defaults", "jpeg_subsampling", subsampling_names[subsampling]);
+			}
+		}
+		if (is_texture_format(formats[current_export_format].short_name))
+		{
+			static constexpr const char* block_format_names[] = { "auto", "bc1", "bc3", "bc4", "bc5", "bc7" };
+			const auto texture_block_format = get_texture_block_format();
+			int block_format = texture_block_format ? static_cast<int>(*texture_block_format) + 1 : 0;
+			if (ImGui::Combo("block format", &block_format, block_format_names, 6))
+			{
+				set_texture_block_format(block_format ? std::optional(static_cast<BlockCompression::Format>(block_format - 1)) : std::nullopt);
+				config_ini->set_property_as_string("defaults", "texture_block_format", block_format_names[block_format]);
+			}
+			add_tooltip("auto : bc4 for grayscale, bc5 for rg, bc1 for rgb and bc3 for rgba");
+		}
+		static constexpr const char* resample_names[] = { "none", "nearest", "bilinear", "box", "kaiser", "lanczos" };
+		int resample_filter = resample ? static_cast<int>(resample->filter) + 1 : 0;
+		if (ImGui::Combo("resample", &resample_filter, resample_names, 6))
+		{
+			resample = resample_filter ? std::optional(ResampleSettings{ static_cast<ResampleFilter>(resample_filter - 1) }) : std::nullopt;
+			config_ini->set_property_as_string("defaults", "resample_filter", resample_names[resample_filter]);
+			update_preview();
+		}
+		add_tooltip("bring sources of other sizes to the size of the largest one (none : sources must have the same size)");
+		if (formats[current_export_format].short_name != "hdr") draw_mip_settings();
 		if (ImGui::Button("Export"))
 		{
 			std::vector<char> current_format_string;
@@ -111,7 +183,59 @@ namespace SuperPacker
 	{
 		channels[channel.short_name] = channel;
 		channels[channel.short_name].desired_channel = config_ini->get_property_as_string("defaults", "palette_" + channel.short_name);
+		set_expression(channels[channel.short_name], config_ini->get_property_as_string("defaults", "expression_" + channel.short_name, ""));
+	}
+
+	void ImagePacker::set_expression(ImageChannel& channel, const std::string& text)
+	{
+		channel.expression_text = text;
+		channel.expression = nullptr;
+		channel.expression_error.clear();
+		if (text.empty()) return;
+
+		// Variable i is the channel of offset i (channels that are not added yet keep their default name)
+		std::vector<std::string> variables(4);
+		for (const auto& other : channels)
+			if (other.second.channel_offset < variables.size()) variables[other.second.channel_offset] = other.second.short_name;
+		for (size_t i = 0; i < variables.size(); ++i)
+			if (variables[i].empty()) variables[i] = std::string(1, "rgba"[i]);
+
+		channel.expression = Expression::compile(text, variables, channel.expression_error);
 	}
+	void ImagePacker::draw_mip_settings()
+	{
+		auto mip_settings = get_export_mips();
+		bool export_mips = mip_settings.has_value();
+		bool changed = ImGui::Checkbox("mips", &export_mips);
+		add_tooltip("embedded in dds and ktx files, written as <name>_mip<N> files for other formats");
+		if (!export_mips)
+		{
+			if (!changed) return;
+			set_export_mips({});
+			config_ini->set_property_as_int("defaults", "export_mips", 0);
+			return;
+		}
+		if (!mip_settings) mip_settings.emplace();
+
+		static constexpr const char* filter_names[] = { "box", "kaiser" };
+		int filter = static_cast<int>(mip_settings->filter);
+		changed |= ImGui::Combo("mip filter", &filter, filter_names, 2);
+		mip_settings->filter = static_cast<MipFilter>(filter);
+		changed |= ImGui::Checkbox("srgb color", &mip_settings->srgb);
+		add_tooltip("filter rgb channels in linear space");
+		int alpha_coverage = static_cast<int>(std::lround(std::max(0.f, mip_settings->coverage_thresholds[3]) * 255));
+		changed |= ImGui::SliderInt("alpha coverage", &alpha_coverage, 0, 255);
+		add_tooltip("keep the ratio of alpha above this threshold in every mip (0 : disabled)");
+		mip_settings->coverage_thresholds[3] = alpha_coverage / 255.f;
+
+		if (!changed) return;
+		set_export_mips(mip_settings);
+		config_ini->set_property_as_int("defaults", "export_mips", 1);
+		config_ini->set_property_as_string("defaults", "mip_filter", filter_names[filter]);
+		config_ini->set_property_as_int("defaults", "mip_srgb", mip_settings->srgb);
+		config_ini->set_property_as_int("defaults", "mip_alpha_coverage", alpha_coverage);
+	}
+
 	void ImagePacker::add_channel_combination(const ChannelCombination& combination)
 	{
 		channel_combinations[combination.combination_name] = combination;
@@ -119,7 +243,7 @@ namespace SuperPacker
 	
 	void ImagePacker::draw_channel(ImageChannel& channel, const float width)
 	{
-		if (ImGui::BeginChild(("channel : " + channel.full_name).c_str(), ImVec2(width, 210), true)) {
+		if (ImGui::BeginChild(("channel : " + channel.full_name).c_str(), ImVec2(width, 235), true)) {
 
 			if (ImGui::IsWindowHovered())
 			{
@@ -132,25 +256,29 @@ namespace SuperPacker
 			
 			if (ImGui::IsWindowHovered() && !dropped_files.empty())
 			{
-				channel.assigned_image = std::make_shared<Image>(dropped_files[0]);
-				update_preview();
+				set_pending_load(channel, load_image_async(dropped_files[0]));
 				dropped_files.clear();
 			}
 			
 			ImGui::PushStyleColor(ImGuiCol_Button, channel.channel_color);
 			if (ImGui::Button(channel.full_name.c_str())) {
 				if (auto path = pick_file("", formats_string)) {
-					channel.assigned_image = std::make_shared<Image>(path.value());
-					update_preview();
+					set_pending_load(channel, load_image_async(path.value()));
 				}
 			}
 			add_tooltip(channel.assigned_image ? channel.assigned_image->source_path->string() : "Choose image for the " + channel.full_name + " channel");
 			
 			ImGui::PopStyleColor();
 			ImGui::SameLine();
-			if (channel.assigned_image) {
+			if (channel.pending_load) {
+				if (ImGui::Button(("cancel##" + channel.full_name).c_str())) {
+					set_pending_load(channel, nullptr);
+				}
+				add_tooltip("Cancel loading of " + channel.pending_load->get_path().filename().string());
+			}
+			else if (channel.assigned_image) {
 				if (ImGui::Button(("remove##" + channel.full_name).c_str())) {
-					channel.assigned_image = nullptr;
+					assign_image(channel, nullptr);
 					update_preview();
 				}
 				add_tooltip("Remove image");
@@ -166,8 +294,14 @@ namespace SuperPacker
 				}
 				add_tooltip("default channel value");
 			}
-			if (channel.assigned_image) {
-				ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<size_t>(channel.assigned_image->get_texture())), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1));
+			if (channel.pending_load) {
+				// Placeholder until the image is decoded
+				ImGui::ProgressBar(channel.pending_load->get_progress(), ImVec2(100, 100),
+					channel.pending_load->get_state() == ImageLoadTask::State::Queued ? "queued" : "loading");
+				add_tooltip(channel.pending_load->get_path().filename().string());
+			}
+			else if (channel.assigned_image) {
+				ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<size_t>(channel.assigned_texture->get_texture())), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1));
 				
 				if (channel.assigned_image->source_path) add_tooltip(channel.assigned_image->source_path->filename().string());
 
@@ -201,69 +335,199 @@ namespace SuperPacker
 				add_tooltip("Choose output channel from this source");
 
 			}
+
+			char expression[256] = {};
+			channel.expression_text.copy(expression, sizeof(expression) - 1);
+			const bool invalid = !channel.expression_error.empty();
+			if (invalid) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 0.3f, 0.3f, 1));
+			if (ImGui::InputText(("##expression" + channel.short_name).c_str(), expression, sizeof(expression)))
+			{
+				set_expression(channel, expression);
+				config_ini->set_property_as_string("defaults", "expression_" + channel.short_name, channel.expression_text);
+				update_preview();
+			}
+			if (invalid) ImGui::PopStyleColor();
+			add_tooltip(channel.expression_error.empty() ? "expression over r, g, b and a, e.g. 1 - g or lerp(r, b, 0.5) (empty : use the source)" : channel.expression_error);
 		}
 		ImGui::EndChild();
 	}
 
-	void ImagePacker::update_preview()
+	void ImagePacker::assign_image(ImageChannel& channel, const std::shared_ptr<const IImage>& image)
 	{
-		const auto channel_count = channel_combinations[current_channel_combination].combination.size();
+		channel.assigned_image = image;
+		channel.assigned_proxy = nullptr;
+		channel.assigned_texture = nullptr;
+		if (!image) return;
 
-		int image_width = 0;
-		int image_height = 0;
+		// The proxy is only computed once per source, even if several channels use it
+		for (const auto& other : channels)
+		{
+			if (&other.second == &channel || other.second.assigned_image != image) continue;
+			channel.assigned_proxy = other.second.assigned_proxy;
+			channel.assigned_texture = other.second.assigned_texture;
+			return;
+		}
+
+		channel.assigned_proxy = make_proxy(image, preview_size);
+		channel.assigned_texture = std::make_shared<ImageTexture>(channel.assigned_proxy);
+	}
 
-		for (const auto& channel : channel_combinations[current_channel_combination].combination)
+	void ImagePacker::set_pending_load(ImageChannel& channel, const std::shared_ptr<ImageLoadTask>& task)
+	{
+		if (channel.pending_load && channel.pending_load != task)
 		{
-			if (channels[channel].assigned_image)
+			const auto previous = channel.pending_load;
+			channel.pending_load = nullptr;
+			if (std::ranges::none_of(channels, [&](const auto& other) { return other.second.pending_load == previous; })) previous->cancel();
+		}
+		channel.pending_load = task;
+	}
+
+	void ImagePacker::poll_pending_loads()
+	{
+		bool changed = false;
+		for (auto& channel : channels)
+		{
+			const auto task = channel.second.pending_load;
+			if (!task || !task->is_done()) continue;
+
+			channel.second.pending_load = nullptr;
+			if (task->get_state() == ImageLoadTask::State::Ready)
 			{
-				if (!image_width || !image_height) {
-					image_width = channels[channel].assigned_image->get_width();
-					image_height = channels[channel].assigned_image->get_height();
-				}
-				else if (image_width != channels[channel].assigned_image->get_width() || image_height != channels[channel].assigned_image->get_height())
-				{
-					logger_warning("wrong image dimention");
-					preview_image = nullptr;
-					return;
-				}
+				// Texture upload is deferred until the channel is drawn on the GL thread
+				assign_image(channel.second, task->get_image());
+				changed = true;
 			}
 		}
+		if (changed) update_preview();
+	}
 
-		if (image_width == 0 || image_height == 0) {
-			preview_image = nullptr;
-			return;
+	std::vector<ChannelSource> ImagePacker::gather_sources(const bool use_proxies)
+	{
+		const auto& combination = channel_combinations[current_channel_combination].combination;
+		const auto make_source = [&](const ImageChannel& image_channel)
+		{
+			ChannelSource source;
+			source.image = use_proxies ? image_channel.assigned_proxy : image_channel.assigned_image;
+			source.default_value = image_channel.default_value;
+			const auto desired_channel = channels.find(image_channel.desired_channel);
+			source.source_channel = desired_channel != channels.end() ? desired_channel->second.channel_offset : image_channel.channel_offset;
+			return source;
+		};
+
+		std::vector<ChannelSource> sources(combination.size());
+		for (const auto& channel : combination)
+		{
+			const auto& image_channel = channels[channel];
+			if (image_channel.channel_offset >= sources.size()) continue;
+
+			auto& source = sources[image_channel.channel_offset];
+			source = make_source(image_channel);
+			if (!image_channel.expression) continue;
+
+			// Expressions read the sources of every channel, even outside of the combination
+			source.expression = image_channel.expression;
+			source.inputs.resize(4);
+			for (const auto& other : channels)
+				if (other.second.channel_offset < source.inputs.size()) source.inputs[other.second.channel_offset] = make_source(other.second);
 		}
+		return sources;
+	}
 
-		if (!preview_image)	preview_image = std::make_shared<Image>(image_width, image_height, static_cast<int>(channel_count));
-		
-		for (const auto& channel : channel_combinations[current_channel_combination].combination)
+	void ImagePacker::update_preview()
+	{
+		trace_zone("update preview");
+
+		// Proxies of sources with different sizes can match : full resolution sizes are compared, as export would
+		if (!resample)
 		{
-			auto& assigned_image = channels[channel].assigned_image;
-			if (assigned_image && (preview_image->get_width() != assigned_image->get_width() || preview_image->get_height() != assigned_image->get_height()) || preview_image->get_channels() != channel_count)
+			int image_width = 0;
+			int image_height = 0;
+			bool mismatch = false;
+			const auto check_size = [&](const ChannelSource& source)
 			{
-				preview_image = std::make_shared<Image>(assigned_image->get_width(), assigned_image->get_height(), static_cast<int>(channel_count));
+				if (!source.image) return;
+				if (!image_width || !image_height)
+				{
+					image_width = source.image->get_width();
+					image_height = source.image->get_height();
+				}
+				else if (image_width != source.image->get_width() || image_height != source.image->get_height()) mismatch = true;
+			};
+			for (const auto& source : gather_sources(false))
+			{
+				check_size(source);
+				for (const auto& input : source.inputs) check_size(input);
 			}
-
-			if (assigned_image)
+			if (mismatch)
 			{
-				static_cast<Image*>(preview_image.get())->set_channel_data(
-					static_cast<Image*>(assigned_image.get())->get_channel_data(channels[channels[channel].desired_channel].channel_offset),
-					channels[channel].channel_offset
-				);
+				logger_warning("wrong image dimention");
+				preview_image = nullptr;
+				preview_texture = nullptr;
+				preview_on_cpu = true; // nothing left to compose on the GPU
+				return;
 			}
-			else
+		}
+
+		const auto sources = gather_sources(true);
+		const uint32_t changed_channels = pack_channels(sources, preview_image, resample);
+		preview_on_cpu = std::ranges::any_of(sources, [&](const ChannelSource& source)
+		{
+			return source.expression || (source.image && preview_image && (source.image->get_width() != preview_image->get_width() || source.image->get_height() != preview_image->get_height()));
+		});
+
+		if (!preview_image) preview_texture = nullptr;
+		else if (gpu_preview && !preview_on_cpu)
+		{
+			// The CPU texture is not updated while the preview is composed on the GPU
+			gpu_preview_dirty = true;
+			preview_texture = nullptr;
+		}
+		else if (!preview_texture || preview_texture->get_image() != preview_image) preview_texture = std::make_shared<ImageTexture>(preview_image, true);
+		else preview_texture->mark_channels_dirty(changed_channels);
+	}
+
+	GLuint ImagePacker::get_preview_texture()
+	{
+		if (gpu_preview && !compositor)
+		{
+			compositor = std::make_unique<PreviewCompositor>();
+			if (!compositor->is_valid())
 			{
-				std::vector<uint8_t> image_data(image_width* image_height);
-				for (int i = 0; i < image_width * image_height; ++i)
-				{
-					image_data[i] = channels[channels[channel].desired_channel].default_value;
-				}
-				static_cast<Image*>(preview_image.get())->set_channel_data(image_data, channels[channel].channel_offset);
+				logger_warning("GPU preview is not available : preview will be composed on the CPU");
+				compositor = nullptr;
+				gpu_preview = false;
+				update_preview();
 			}
-			
 		}
-		if (preview_image) static_cast<Image*>(preview_image.get())->rebuild_texture();
-		
+
+		if (!gpu_preview || preview_on_cpu) return preview_texture ? preview_texture->get_texture() : 0;
+		if (!gpu_preview_dirty) return compositor->get_texture();
+		gpu_preview_dirty = false;
+
+		const auto sources = gather_sources(true);
+		std::vector<PreviewCompositor::Channel> composition(sources.size());
+		for (size_t c = 0; c < sources.size(); ++c)
+		{
+			composition[c].source_channel = sources[c].source_channel;
+			composition[c].default_value = sources[c].default_value;
+			if (!sources[c].image) continue;
+			const auto channel = std::ranges::find_if(channels, [&](const auto& item) { return item.second.assigned_proxy == sources[c].image; });
+			if (channel != channels.end()) composition[c].texture = channel->second.assigned_texture->get_texture();
+		}
+		const GLuint texture = compositor->compose(composition, preview_image->get_width(), preview_image->get_height());
+
+		if (gpu_preview_check)
+		{
+			const int channel_count = preview_image->get_channels();
+			const auto gpu_pixels = compositor->read_pixels(channel_count);
+			const auto cpu_pixels = preview_image->gen_data_from_channels(channel_count);
+			size_t mismatches = 0;
+			for (size_t i = 0; i < std::min(gpu_pixels.size(), cpu_pixels.size()); ++i) mismatches += gpu_pixels[i] != cpu_pixels[i];
+			if (mismatches || gpu_pixels.size() != cpu_pixels.size()) logger_error("GPU preview differs from CPU pack on %zu values", mismatches);
+			else logger_validate("GPU preview matches CPU pack");
+		}
+		return texture;
 	}
 
 	std::string set_extension(const std::string& current_name, const std::string& desired_extension)
@@ -274,10 +538,10 @@ namespace SuperPacker
 	
 	void ImagePacker::save(std::string file_path)
 	{
-		int width = 0;
-		int height = 0;
-
-		if (!preview_image)
+		trace_zone("export");
+		// The preview only contains proxies : the full resolution image is only packed for export
+		const auto export_image = pack_for_format(gather_sources(false), formats[current_export_format].short_name, resample);
+		if (!export_image)
 		{
 			logger_warning("cannot export current image combination");
 			return;
@@ -285,38 +549,19 @@ namespace SuperPacker
 
 		const auto export_path = set_extension(file_path, formats[current_export_format].short_name);
 
-		auto data = static_cast<Image*>(preview_image.get())->gen_data_from_channels(preview_image->get_channels());
+		logger_log("export to %s (%d channels)", export_path.c_str(), export_image->get_channels());
 
-		logger_log("export to %s (%d channels)", export_path.c_str(), preview_image->get_channels());
-		
-		if (formats[current_export_format].short_name == "png")
-		{
-			stbi_write_png(export_path.c_str(), preview_image->get_width(), preview_image->get_height(), static_cast<int>(preview_image->get_channels()), data.data(), 0);
-		}
-		else if (formats[current_export_format].short_name == "tga")
-		{
-			stbi_write_tga(export_path.c_str(), preview_image->get_width(), preview_image->get_height(), static_cast<int>(preview_image->get_channels()), data.data());
-		}
-		else if (formats[current_export_format].short_name == "bmp")
-		{
-			stbi_write_bmp(export_path.c_str(), preview_image->get_width(), preview_image->get_height(), static_cast<int>(preview_image->get_channels()), data.data());
-		}
-		else if (formats[current_export_format].short_name == "jpg") {
-			stbi_write_jpg(export_path.c_str(), preview_image->get_width(), preview_image->get_height(), static_cast<int>(preview_image->get_channels()), data.data(), 100);
-		}
-		else
-		{
-			logger_error("unsuported format : %s", formats[current_export_format].short_name.c_str());
-		}
+		if (write_image(export_path, formats[current_export_format].short_name, *export_image)) logger_validate("exported %s", export_path.c_str());
 	}
 		
 	void ImagePacker::reset_from_source(const std::filesystem::path& source)
 	{
+		// Every channel wait for the same decoding
+		const auto task = load_image_async(source);
 		for (auto& channel : channels)
 		{
-			channel.second.assigned_image = std::make_shared<Image>(source);
+			set_pending_load(channel.second, task);
 		}
-		update_preview();
 	}
 
 	void ImagePacker::drop_file(const std::filesystem::path& path)
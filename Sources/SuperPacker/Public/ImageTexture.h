@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GL/gl3w.h"
+#include "Image.h"
+
+namespace SuperPacker
+{
+	/**
+	 * GPU copy of an image. The texture is only created and uploaded when it is drawn for the first time.
+	 * Editable textures keep their interleaved pixels on the CPU side, so that a change on a single channel only rewrites
+	 * this channel before the texture is updated in place.
+	 */
+	class ImageTexture final
+	{
+	public:
+		explicit ImageTexture(std::shared_ptr<const IImage> in_image, const bool in_editable = false)
+			: image(std::move(in_image)), editable(in_editable) {}
+
+		~ImageTexture();
+
+		ImageTexture(const ImageTexture&) = delete;
+		ImageTexture& operator=(const ImageTexture&) = delete;
+
+		/** Create or update texture if needed. Must be called from the GL thread */
+		[[nodiscard]] GLuint get_texture();
+
+		/** Image data will be uploaded again the next time the texture is requested */
+		void mark_dirty() { dirty_channels = ~0u; }
+
+		/** Only the given channels (bit c = channel c) will be rebuilt the next time the texture is requested */
+		void mark_channels_dirty(const uint32_t channel_mask) { dirty_channels |= channel_mask; }
+
+		[[nodiscard]] const std::shared_ptr<const IImage>& get_image() const { return image; }
+
+	private:
+		template <typename Type>
+		void update_pixels(const TImage<Type>& source, GLenum data_type);
+
+		std::shared_ptr<const IImage> image;
+		const bool editable;
+		std::vector<uint8_t> pixels;
+		GLuint texture_id = 0;
+		int texture_width = 0;
+		int texture_height = 0;
+		GLenum texture_format = 0;
+		uint32_t dirty_channels = ~0u;
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GL/gl3w.h"
+
+namespace SuperPacker
+{
+	/**
+	 * Compose output channels on the GPU from the source textures, into a texture owned by the compositor.
+	 * Channels are fetched texel per texel, so sources must have the size of the output.
+	 * Must be created and used from the GL thread.
+	 */
+	class PreviewCompositor final
+	{
+	public:
+		/** Content of one output channel : a component of a texture, or default_value if texture is 0 */
+		struct Channel
+		{
+			GLuint texture = 0;
+			int source_channel = 0;
+			uint8_t default_value = 0;
+		};
+
+		PreviewCompositor();
+		~PreviewCompositor();
+
+		PreviewCompositor(const PreviewCompositor&) = delete;
+		PreviewCompositor& operator=(const PreviewCompositor&) = delete;
+
+		/** False if the shader failed to compile */
+		[[nodiscard]] bool is_valid() const { return program != 0; }
+
+		/** Render channels (up to 4) into the output texture. Unused components are 0, and alpha is 1 if not assigned */
+		GLuint compose(const std::vector<Channel>& channels, int width, int height);
+
+		[[nodiscard]] GLuint get_texture() const { return texture; }
+
+		/** Read back the first channel_count components of the last composition as interleaved rows */
+		[[nodiscard]] std::vector<uint8_t> read_pixels(int channel_count) const;
+
+	private:
+		GLuint program = 0;
+		GLuint vertex_array = 0;
+		GLuint framebuffer = 0;
+		GLuint texture = 0;
+		int texture_width = 0;
+		int texture_height = 0;
+
+		GLint sources_location = -1;
+		GLint source_channels_location = -1;
+		GLint assigned_location = -1;
+		GLint default_values_location = -1;
+		GLint channel_count_location = -1;
+	};
+}
@@ -1,8 +1,12 @@
 #pragma once
 #include <string>
 #include <filesystem>
+#include <memory>
 #include <unordered_map>
 
+#include "Image.h"
+#include "Packer.h"
+#include "PreviewCompositor.h"
 #include "Types.h"
 
 class IniLoader;
@@ -40,9 +44,45 @@ namespace SuperPacker
 		
 		void draw_channel(ImageChannel& channel, const float width);
 
+		/** Compile the expression of channel. Variables are the short names of every channel */
+		void set_expression(ImageChannel& channel, const std::string& text);
+
+		/** Mip export options of the current format, saved in the config */
+		void draw_mip_settings();
+
+		/** Assign image and its preview proxy (shared with other channels using the same image) */
+		void assign_image(ImageChannel& channel, const std::shared_ptr<const IImage>& image);
+
+		/** Replace pending load of channel (previous one is cancelled if no other channel is waiting for it) */
+		void set_pending_load(ImageChannel& channel, const std::shared_ptr<ImageLoadTask>& task);
+
+		/** Assign images whose background decoding completed */
+		void poll_pending_loads();
+
+		/** Output channel sources of the current combination, from the preview proxies or from the full resolution images */
+		[[nodiscard]] std::vector<ChannelSource> gather_sources(bool use_proxies);
+
 		void update_preview();
+
+		/** Texture of the output preview, composed on the GPU if enabled. Must be called from the GL thread */
+		[[nodiscard]] GLuint get_preview_texture();
+
+		/** Size in pixels of the output preview widget. Previews are composed from proxies of this size */
+		static constexpr int preview_size = 200;
 		
-		std::shared_ptr<IImage> preview_image;
+		std::shared_ptr<Image> preview_image;
+		std::shared_ptr<ImageTexture> preview_texture;
+
+		/** With GPU preview, preview_image only references the proxies : no pixel is copied on the CPU. Expressions and resampled sources are always previewed on the CPU */
+		bool gpu_preview = true;
+		/** Compare each GPU composition with the CPU pack (debug) */
+		bool gpu_preview_check = false;
+		bool gpu_preview_dirty = false;
+		bool preview_on_cpu = false;
+		std::unique_ptr<PreviewCompositor> compositor;
+
+		/** Resampling of sources of other sizes, for the preview and the export (disabled if not set) */
+		std::optional<ResampleSettings> resample;
 
 		void save(std::string file_path);
 
@@ -4,7 +4,10 @@
 #include <vector>
 
 
+#include "Expression.h"
 #include "Image.h"
+#include "ImageLoader.h"
+#include "ImageTexture.h"
 #include "imgui.h"
 
 namespace SuperPacker
@@ -25,8 +28,14 @@ namespace SuperPacker
 		std::string short_name;
 		ImVec4 channel_color;
 		uint8_t default_value;
-		std::shared_ptr<IImage> assigned_image;
+		std::shared_ptr<const IImage> assigned_image;
+		std::shared_ptr<const IImage> assigned_proxy; // assigned_image downsampled to the preview size
+		std::shared_ptr<ImageTexture> assigned_texture;
+		std::shared_ptr<ImageLoadTask> pending_load;
 		std::string desired_channel = "";
+		std::string expression_text;                    // computes the channel from the sources of every channel if not empty
+		std::shared_ptr<const Expression> expression;   // null if expression_text is empty or invalid
+		std::string expression_error;
 	};
 
 	struct ChannelCombination
@@ -0,0 +1,387 @@
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Executor.h"
+#include "Image.h"
+#include "ImageKernels.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+#include "Packer.h"
+
+/*
+ * SuperPackerBench - measure throughput of image processing stages
+ *
+ *		SuperPackerBench [--sizes 256,1024,4096,16384] [--channels 1,4] [--threads 1,8] [--formats png,dds] [--json results.json]
+ *
+ * Synthetic images are generated from a fixed seed (noise or flat content) so runs on different builds can be compared.
+ * Each stage is run on every size, channel count, content and thread count : kernels (simd against reference loops),
+ * deinterleave, pack (channel routing of pack_channels), interleave (gen_data_from_channels), write and decode of each format.
+ * Results report MB/s of uncompressed samples, images/s and the speedup over the first thread count.
+ */
+
+namespace
+{
+	struct Options
+	{
+		std::vector<int> sizes = { 256, 1024, 4096 };
+		std::vector<int> channels = { 1, 2, 3, 4 };
+		std::vector<int> threads;
+		std::vector<std::string> contents = { "noise", "flat" };
+		std::vector<std::string> formats = { "png", "tga", "bmp", "jpg", "dds", "ktx", "hdr" };
+		std::vector<std::string> stages = { "kernels", "deinterleave", "pack", "interleave", "write", "decode" };
+		int iterations = 3;
+		std::string json_path;
+	};
+
+	Options options;
+
+	struct Result
+	{
+		std::string stage;
+		std::string variant; // sample type or file format
+		int size = 0;
+		int channels = 0;
+		std::string content;
+		size_t threads = 0;
+		double seconds = 0;
+		double bytes = 0;
+		double speedup = 1;
+	};
+
+	std::vector<Result> results;
+
+	/** Run function several times and return the best duration in seconds */
+	double measure(const std::function<void()>& function)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (int i = 0; i < options.iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	/** Store a result, with its speedup over the same measure at the first thread count */
+	void report(Result result)
+	{
+		const auto base = std::ranges::find_if(results, [&](const Result& other)
+		{
+			return other.stage == result.stage && other.variant == result.variant && other.size == result.size && other.channels == result.channels &&
+				other.content == result.content && other.threads == static_cast<size_t>(options.threads.front());
+		});
+		if (base != results.end()) result.speedup = base->seconds / result.seconds;
+
+		logger_log("%-12s %-10s %5dx%-5d %dch %-5s %2zu threads : %9.2f MB/s %9.2f images/s (x%.2f)",
+			result.stage.c_str(), result.variant.c_str(), result.size, result.size, result.channels, result.content.c_str(), result.threads,
+			result.bytes / result.seconds * 1e-6, 1.0 / result.seconds, result.speedup);
+		results.push_back(std::move(result));
+	}
+
+	template <typename Type>
+	void bench_kernels(const char* type_name, const int size, const size_t threads)
+	{
+		const size_t pixel_count = static_cast<size_t>(size) * size;
+
+		std::mt19937 random(0);
+		std::vector<Type> interleaved(pixel_count * 4);
+		for (auto& value : interleaved) value = static_cast<Type>(random() % 256);
+
+		std::vector<std::vector<Type>> planes(4, std::vector<Type>(pixel_count));
+		Type* plane_ptr[4];
+		const Type* const_plane_ptr[4];
+		for (int c = 0; c < 4; ++c) const_plane_ptr[c] = plane_ptr[c] = planes[c].data();
+
+		for (const int channels : options.channels)
+		{
+			const double bytes = static_cast<double>(pixel_count * channels * sizeof(Type));
+
+			// Reference : per channel strided loops previously used by TImage
+			const double scalar_split = measure([&] {
+				for (int c = 0; c < channels; ++c)
+					for (size_t i = 0; i < pixel_count; ++i) plane_ptr[c][i] = interleaved[i * channels + c];
+				});
+			const double simd_split = measure([&] { SuperPacker::Kernels::deinterleave(interleaved.data(), plane_ptr, channels, pixel_count); });
+
+			const double scalar_merge = measure([&] {
+				for (int c = 0; c < channels; ++c)
+					for (size_t i = 0; i < pixel_count; ++i) interleaved[i * channels + c] = const_plane_ptr[c][i];
+				});
+			const double simd_merge = measure([&] { SuperPacker::Kernels::interleave(const_plane_ptr, interleaved.data(), channels, pixel_count); });
+
+			const std::string type = type_name;
+			report({ "split_kernel", type, size, channels, "noise", threads, simd_split, bytes });
+			report({ "split_kernel", type + "_ref", size, channels, "noise", threads, scalar_split, bytes });
+			report({ "merge_kernel", type, size, channels, "noise", threads, simd_merge, bytes });
+			report({ "merge_kernel", type + "_ref", size, channels, "noise", threads, scalar_merge, bytes });
+		}
+	}
+
+	/** Deterministic image : uniform noise, or a distinct constant per channel */
+	std::shared_ptr<SuperPacker::Image> make_image(const int size, const int channels, const std::string& content)
+	{
+		const size_t pixel_count = static_cast<size_t>(size) * size;
+		auto image = std::make_shared<SuperPacker::Image>(size, size, channels);
+		std::mt19937 random(static_cast<uint32_t>(size * 4 + channels));
+		for (int c = 0; c < channels; ++c)
+		{
+			std::vector<uint8_t> plane(pixel_count, static_cast<uint8_t>(64 + c * 32));
+			if (content == "noise")
+				for (auto& value : plane) value = static_cast<uint8_t>(random());
+			image->set_channel_data(std::move(plane), c);
+		}
+		return image;
+	}
+
+	bool is_enabled(const std::string& stage)
+	{
+		return std::ranges::find(options.stages, stage) != options.stages.end();
+	}
+
+	void bench_image(const int size, const int channels, const std::string& content, const size_t threads)
+	{
+		const auto image = make_image(size, channels, content);
+		const double bytes = static_cast<double>(size) * size * channels;
+		const auto interleaved = image->gen_data_from_channels(channels);
+
+		if (is_enabled("deinterleave"))
+		{
+			std::vector<std::vector<uint8_t>> planes(channels, std::vector<uint8_t>(static_cast<size_t>(size) * size));
+			uint8_t* plane_ptr[4];
+			for (int c = 0; c < channels; ++c) plane_ptr[c] = planes[c].data();
+			const double seconds = measure([&]
+			{
+				SuperPacker::Executor::parallel_for_rows(size, static_cast<size_t>(size) * channels, [&](const int y_begin, const int y_end)
+				{
+					const size_t offset = static_cast<size_t>(y_begin) * size;
+					uint8_t* rows[4];
+					for (int c = 0; c < channels; ++c) rows[c] = plane_ptr[c] + offset;
+					SuperPacker::Kernels::deinterleave(interleaved.data() + offset * channels, rows, channels, static_cast<size_t>(y_end - y_begin) * size);
+				});
+			});
+			report({ "deinterleave", "uint8", size, channels, content, threads, seconds, bytes });
+		}
+
+		// Output channel c is routed from source channel channels - 1 - c (reversed order, so channels are swapped rather than passed through)
+		std::vector<SuperPacker::ChannelSource> sources(channels);
+		for (int c = 0; c < channels; ++c)
+		{
+			sources[c].image = image;
+			sources[c].source_channel = static_cast<uint8_t>(channels - 1 - c);
+		}
+
+		std::shared_ptr<SuperPacker::Image> packed;
+		if (is_enabled("pack"))
+		{
+			const double seconds = measure([&]
+			{
+				packed = nullptr;
+				(void)SuperPacker::pack_channels(sources, packed);
+			});
+			report({ "pack", "uint8", size, channels, content, threads, seconds, bytes });
+		}
+		else (void)SuperPacker::pack_channels(sources, packed);
+
+		if (is_enabled("interleave"))
+		{
+			const double seconds = measure([&] { (void)packed->gen_data_from_channels(channels); });
+			report({ "interleave", "uint8", size, channels, content, threads, seconds, bytes });
+		}
+
+		if (!is_enabled("write") && !is_enabled("decode")) return;
+
+		const auto directory = std::filesystem::temp_directory_path() / "superpacker_bench";
+		std::filesystem::create_directories(directory);
+		for (const auto& format : options.formats)
+		{
+			const auto path = (directory / ("bench." + format)).string();
+			const auto export_image = format == "hdr" ? SuperPacker::pack_for_format(sources, format) : packed;
+
+			// The first write also warms the file system up
+			if (!export_image || !SuperPacker::write_image(path, format, *export_image))
+			{
+				logger_warning("skip %s with %d channels : cannot be written", format.c_str(), channels);
+				continue;
+			}
+			const double write_seconds = measure([&] { (void)SuperPacker::write_image(path, format, *export_image); });
+			if (is_enabled("write")) report({ "write", format, size, channels, content, threads, write_seconds, bytes });
+
+			// Block compressed textures are not decoded by the loader
+			if (!is_enabled("decode") || format == "dds" || format == "ktx") continue;
+			bool decoded = false;
+			const double decode_seconds = measure([&]
+			{
+				if (format == "hdr") decoded = SuperPacker::HdrImage(path).is_valid();
+				else decoded = SuperPacker::Image(path).is_valid();
+			});
+			if (decoded) report({ "decode", format, size, channels, content, threads, decode_seconds, bytes });
+			else logger_warning("failed to decode %s", path.c_str());
+		}
+		std::filesystem::remove_all(directory);
+	}
+
+	std::string json_string(const std::string& text)
+	{
+		std::string result = "\"";
+		for (const char character : text)
+		{
+			if (character == '"' || character == '\\') result += '\\';
+			result += character;
+		}
+		return result + "\"";
+	}
+
+	bool write_json(const std::string& path)
+	{
+		std::ostringstream json;
+		json << "{\n\t\"instruction_set\": " << json_string(SuperPacker::Kernels::get_instruction_set()) << ",\n";
+		json << "\t\"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+		json << "\t\"iterations\": " << options.iterations << ",\n\t\"results\": [";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			json << (i ? ",\n\t\t" : "\n\t\t") << "{ \"stage\": " << json_string(result.stage) << ", \"variant\": " << json_string(result.variant)
+				<< ", \"size\": " << result.size << ", \"channels\": " << result.channels << ", \"content\": " << json_string(result.content)
+				<< ", \"threads\": " << result.threads << ", \"seconds\": " << result.seconds << ", \"mb_per_second\": " << result.bytes / result.seconds * 1e-6
+				<< ", \"images_per_second\": " << 1.0 / result.seconds << ", \"speedup\": " << result.speedup << " }";
+		}
+		json << "\n\t]\n}\n";
+
+		std::ofstream file(path, std::ios::binary);
+		file << json.str();
+		return file.good();
+	}
+
+	/** Parse a whole decimal argument in [min_value, max_value]. Return false if it is not a number or out of range */
+	bool parse_integer(const std::string_view text, int& value, const int min_value, const int max_value)
+	{
+		int parsed = 0;
+		const auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+		if (error != std::errc() || last != text.data() + text.size() || parsed < min_value || parsed > max_value) return false;
+		value = parsed;
+		return true;
+	}
+
+	std::vector<std::string> parse_list(const std::string& value)
+	{
+		std::vector<std::string> list;
+		std::stringstream stream(value);
+		for (std::string item; std::getline(stream, item, ',');) list.push_back(item);
+		return list;
+	}
+
+	/** Parse a comma separated list of integers in [min_value, max_value]. Return false if any item is invalid */
+	bool parse_list(const std::string& value, std::vector<int>& list, const int min_value, const int max_value)
+	{
+		std::vector<int> parsed;
+		for (const auto& item : parse_list(value))
+			if (!parse_integer(item, parsed.emplace_back(), min_value, max_value)) return false;
+		list = std::move(parsed);
+		return true;
+	}
+
+	void print_usage()
+	{
+		logger_log(
+			"usage : SuperPackerBench [options]\n"
+			"\t--sizes <list>       pixels per side of the square images (default : 256,1024,4096, up to 16384)\n"
+			"\t--size <pixels>      single image size\n"
+			"\t--channels <list>    channel counts in [1, 4] (default : 1,2,3,4)\n"
+			"\t--threads <list>     thread counts, 0 = all cores (default : 1,0)\n"
+			"\t--contents <list>    noise and / or flat (default : noise,flat)\n"
+			"\t--formats <list>     written and decoded formats (default : png,tga,bmp,jpg,dds,ktx,hdr)\n"
+			"\t--stages <list>      kernels, deinterleave, pack, interleave, write, decode (default : all)\n"
+			"\t--iterations <count> best of count runs (default : 3)\n"
+			"\t--json <path>        write results as json");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		bool valid = true;
+		if (arg == "--sizes" && has_value) valid = parse_list(argv[++i], options.sizes, 1, 16384);
+		else if (arg == "--size" && has_value)
+		{
+			int size = 0;
+			valid = parse_integer(argv[++i], size, 1, 16384);
+			options.sizes = { size };
+		}
+		else if (arg == "--channels" && has_value) valid = parse_list(argv[++i], options.channels, 1, 4);
+		else if (arg == "--threads" && has_value) valid = parse_list(argv[++i], options.threads, 0, std::numeric_limits<int>::max());
+		else if (arg == "--contents" && has_value) options.contents = parse_list(argv[++i]);
+		else if (arg == "--formats" && has_value) options.formats = parse_list(argv[++i]);
+		else if (arg == "--stages" && has_value) options.stages = parse_list(argv[++i]);
+		else if (arg == "--iterations" && has_value) valid = parse_integer(argv[++i], options.iterations, 1, std::numeric_limits<int>::max());
+		else if (arg == "--json" && has_value) options.json_path = argv[++i];
+		else
+		{
+			print_usage();
+			return EXIT_FAILURE;
+		}
+
+		if (!valid)
+		{
+			logger_error("invalid value for %s : %s", arg.c_str(), argv[i]);
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.threads.empty()) options.threads = { 1, static_cast<int>(std::thread::hardware_concurrency()) };
+	for (auto& threads : options.threads)
+		if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (options.sizes.empty() || options.channels.empty())
+	{
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	logger_log("best of %d iterations, %s kernels", options.iterations, SuperPacker::Kernels::get_instruction_set());
+
+	for (const int threads : options.threads)
+	{
+		SuperPacker::Executor::set_thread_count(threads);
+
+		// Kernels are single threaded : only measured once, on the largest image kept under 256MB per buffer
+		if (is_enabled("kernels") && threads == options.threads.front())
+		{
+			const int kernel_size = std::min(*std::ranges::max_element(options.sizes), 4096);
+			bench_kernels<uint8_t>("uint8", kernel_size, threads);
+			bench_kernels<uint16_t>("uint16", kernel_size, threads);
+			bench_kernels<float>("float", kernel_size, threads);
+		}
+
+		for (const int size : options.sizes)
+			for (const int channels : options.channels)
+				for (const auto& content : options.contents)
+					bench_image(size, channels, content, threads);
+	}
+
+	if (!options.json_path.empty())
+	{
+		if (!write_json(options.json_path))
+		{
+			logger_error("failed to write %s", options.json_path.c_str());
+			return EXIT_FAILURE;
+		}
+		logger_validate("results written to %s", options.json_path.c_str());
+	}
+	return EXIT_SUCCESS;
+}
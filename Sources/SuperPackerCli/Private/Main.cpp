@@ -0,0 +1,431 @@
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Batch.h"
+#include "Executor.h"
+#include "Image.h"
+#include "ImageCache.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+#include "Packer.h"
+#include "StreamPacker.h"
+#include "StripWriter.h"
+#include "TextureFile.h"
+#include "Trace.h"
+
+/*
+ * superpacker-cli - pack image channels without any window or graphic context
+ *
+ *		superpacker-cli -o out.png r=albedo.png g=mask.png:r b=128
+ *		superpacker-cli -c rgba -f tga -o out.tga -s albedo.png a=alpha.png:r
+ *		superpacker-cli --stream -o huge.png r=height.tga g=mask.png:a
+ *		superpacker-cli --png-level 3 --png-filter paeth -o out.png -s albedo.png
+ *		superpacker-cli --jpeg-quality 85 --jpeg-subsampling 444 -o preview.jpg -s albedo.png
+ *		superpacker-cli -c rg -o normal.dds r=normal.png:r g=normal.png:g
+ *		superpacker-cli -o orm.png r=ao.png g=gloss.png b=metal.png a=cavity.png -c rgb -e r="r * a" -e g="invert(g)"
+ *		superpacker-cli --mips --mip-srgb --mip-coverage a=128 -o foliage.dds -s leaves.png
+ *		superpacker-cli --trace pack.trace.json -o out.png -s albedo.png
+ *		superpacker-cli --resample lanczos --size 2048x2048 -o orm.png r=ao_1k.png g=roughness_4k.png b=metal_2k.png
+ *		superpacker-cli --batch materials.ini
+ */
+
+namespace
+{
+	const std::vector<std::string> formats = { "png", "tga", "bmp", "jpg", "dds", "ktx", "hdr" };
+
+	/** Parse a whole decimal argument in [min_value, max_value]. Return false if it is not a number or out of range */
+	template <typename Type>
+	bool parse_integer(const char* text, Type& value, const Type min_value, const Type max_value)
+	{
+		const char* end = text + std::strlen(text);
+		Type parsed = 0;
+		const auto [last, error] = std::from_chars(text, end, parsed);
+		if (error != std::errc() || last != end || parsed < min_value || parsed > max_value) return false;
+		value = parsed;
+		return true;
+	}
+
+	void print_usage()
+	{
+		logger_log(
+			"usage : superpacker-cli [options] <channel>=<source>...\n"
+			"        superpacker-cli [options] --batch <manifest>\n"
+			"\t<channel>                 r, g, b or a\n"
+			"\t<source>                  <path>[:<r|g|b|a>] or a constant value in [0, 255]\n"
+			"\t-e, --expression <c>=<e>  compute channel c from the sources of r, g, b and a (see Expression.h), e.g. \"lerp(r, 1 - g, 0.5)\"\n"
+			"\t-o, --output <path>       output file (required)\n"
+			"\t-c, --combination <name>  grayscale, rg, rgb or rgba (default : deduced from assigned channels)\n"
+			"\t-f, --format <name>       png, tga, bmp, jpg, dds, ktx or hdr (default : output extension)\n"
+			"\t-s, --source <path>       source of every unassigned channel\n"
+			"\t-b, --batch <manifest>    pack every output of an ini manifest, decoding each source once (see Batch.h)\n"
+			"\t-j, --threads <count>     number of threads (default : all cores)\n"
+			"\t--cache-budget <MB>       memory kept by the decoded image cache (default : 1024)\n"
+			"\t--stream                  read, pack and write by strips of rows (png, tga, bmp or jpg output)\n"
+			"\t--strip-rows <count>      rows per strip in stream mode (default : 64)\n"
+			"\t--png-level <0-9>         png deflate level (default : 8)\n"
+			"\t--png-filter <name>       none, sub, up, average, paeth or adaptive (default : adaptive)\n"
+			"\t--jpeg-quality <1-100>    jpeg quality (default : 90)\n"
+			"\t--jpeg-subsampling <mode> chroma subsampling : 444, 422 or 420 (default : 420)\n"
+			"\t--bc <format>             dds and ktx block format : bc1, bc3, bc4, bc5 or bc7 (default : deduced from channels)\n"
+			"\t--mips                    generate mips (implied by other --mip options) : embedded in dds and ktx, <name>_mip<N> files otherwise\n"
+			"\t--mip-filter <name>       box or kaiser (default : kaiser)\n"
+			"\t--mip-srgb                filter rgb channels in linear space\n"
+			"\t--mip-coverage <c>=<v>    keep the ratio of channel c above v (in [0, 255]) in every mip\n"
+			"\t--resample <filter>       resample sources of other sizes : nearest, bilinear, box, kaiser or lanczos (default : bilinear)\n"
+			"\t--size <w>x<h>            output size of resampled sources (implies --resample, default : largest source)\n"
+			"\t--trace <path>            write a trace of the load, pack and export stages (chrome://tracing or ui.perfetto.dev)");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string output;
+	std::string format;
+	std::string combination_name;
+	std::filesystem::path default_source;
+	std::unordered_map<int, SuperPacker::BatchChannel> arguments;
+	std::filesystem::path batch_manifest;
+	std::unordered_map<int, std::string> expressions;
+	bool stream = false;
+	std::optional<SuperPacker::MipSettings> mips;
+	const auto mip_settings = [&]() -> SuperPacker::MipSettings& { return mips ? *mips : mips.emplace(); };
+	std::optional<SuperPacker::ResampleSettings> resample;
+	const auto resample_settings = [&]() -> SuperPacker::ResampleSettings& { return resample ? *resample : resample.emplace(); };
+	int strip_rows = 64;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		if ((arg == "-o" || arg == "--output") && has_value) output = argv[++i];
+		else if ((arg == "-f" || arg == "--format") && has_value) format = argv[++i];
+		else if ((arg == "-c" || arg == "--combination") && has_value) combination_name = argv[++i];
+		else if ((arg == "-s" || arg == "--source") && has_value) default_source = argv[++i];
+		else if ((arg == "-b" || arg == "--batch") && has_value) batch_manifest = argv[++i];
+		else if ((arg == "-e" || arg == "--expression") && has_value)
+		{
+			const std::string value = argv[++i];
+			if (value.size() < 3 || value[1] != '=' || SuperPacker::get_channel_index(value.substr(0, 1)) < 0)
+			{
+				logger_error("invalid expression argument : %s", value.c_str());
+				return EXIT_FAILURE;
+			}
+			expressions[SuperPacker::get_channel_index(value.substr(0, 1))] = value.substr(2);
+		}
+		else if ((arg == "-j" || arg == "--threads") && has_value)
+		{
+			size_t thread_count = 0;
+			if (!parse_integer(argv[++i], thread_count, size_t(0), std::numeric_limits<size_t>::max()))
+			{
+				logger_error("invalid thread count : %s", argv[i]);
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			SuperPacker::Executor::set_thread_count(thread_count);
+		}
+		else if (arg == "--cache-budget" && has_value)
+		{
+			size_t budget = 0;
+			if (!parse_integer(argv[++i], budget, size_t(0), std::numeric_limits<size_t>::max() / (1024 * 1024)))
+			{
+				logger_error("invalid cache budget : %s", argv[i]);
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			SuperPacker::ImageCache::set_memory_budget(budget * 1024 * 1024);
+		}
+		else if (arg == "--stream") stream = true;
+		else if (arg == "--strip-rows" && has_value)
+		{
+			if (!parse_integer(argv[++i], strip_rows, 1, std::numeric_limits<int>::max()))
+			{
+				logger_error("invalid strip rows : %s (expected at least 1)", argv[i]);
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--png-level" && has_value)
+		{
+			int level = 0;
+			if (!parse_integer(argv[++i], level, 0, 9))
+			{
+				logger_error("invalid png level : %s (expected 0-9)", argv[i]);
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			SuperPacker::set_png_compression_level(level);
+		}
+		else if (arg == "--png-filter" && has_value)
+		{
+			SuperPacker::PngFilter filter;
+			if (!SuperPacker::parse_png_filter(argv[++i], filter))
+			{
+				logger_error("unknown png filter : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+			SuperPacker::set_png_filter(filter);
+		}
+		else if (arg == "--jpeg-quality" && has_value)
+		{
+			int quality = 0;
+			if (!parse_integer(argv[++i], quality, 1, 100))
+			{
+				logger_error("invalid jpeg quality : %s (expected 1-100)", argv[i]);
+				print_usage();
+				return EXIT_FAILURE;
+			}
+			SuperPacker::set_jpeg_quality(quality);
+		}
+		else if (arg == "--jpeg-subsampling" && has_value)
+		{
+			SuperPacker::Jpeg::Subsampling subsampling;
+			if (!SuperPacker::parse_jpeg_subsampling(argv[++i], subsampling))
+			{
+				logger_error("unknown jpeg subsampling : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+			SuperPacker::set_jpeg_subsampling(subsampling);
+		}
+		else if (arg == "--bc" && has_value)
+		{
+			SuperPacker::BlockCompression::Format block_format;
+			if (!SuperPacker::BlockCompression::parse_format(argv[++i], block_format))
+			{
+				logger_error("unknown block format : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+			SuperPacker::set_texture_block_format(block_format);
+		}
+		else if (arg == "--mips") mip_settings();
+		else if (arg == "--mip-filter" && has_value)
+		{
+			if (!SuperPacker::parse_mip_filter(argv[++i], mip_settings().filter))
+			{
+				logger_error("unknown mip filter : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--mip-srgb") mip_settings().srgb = true;
+		else if (arg == "--mip-coverage" && has_value)
+		{
+			const std::string value = argv[++i];
+			int threshold = 0;
+			if (value.size() < 3 || value[1] != '=' || SuperPacker::get_channel_index(value.substr(0, 1)) < 0 || !parse_integer(value.c_str() + 2, threshold, 0, 255))
+			{
+				logger_error("invalid mip coverage : %s", value.c_str());
+				return EXIT_FAILURE;
+			}
+			mip_settings().coverage_thresholds[SuperPacker::get_channel_index(value.substr(0, 1))] = threshold / 255.f;
+		}
+		else if (arg == "--resample" && has_value)
+		{
+			if (!SuperPacker::parse_resample_filter(argv[++i], resample_settings().filter))
+			{
+				logger_error("unknown resample filter : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--size" && has_value)
+		{
+			if (!SuperPacker::parse_resample_size(argv[++i], resample_settings()))
+			{
+				logger_error("invalid size : %s", argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--trace" && has_value) SuperPacker::Trace::set_output(argv[++i]);
+		else if (arg == "-h" || arg == "--help")
+		{
+			print_usage();
+			return EXIT_SUCCESS;
+		}
+		else if (arg.size() > 2 && arg[1] == '=' && SuperPacker::get_channel_index(arg.substr(0, 1)) >= 0)
+		{
+			if (!SuperPacker::parse_batch_channel(arg.substr(2), arguments[SuperPacker::get_channel_index(arg.substr(0, 1))]))
+			{
+				logger_error("invalid channel value : %s", arg.c_str());
+				return EXIT_FAILURE;
+			}
+		}
+		else
+		{
+			logger_error("unknown argument : %s", arg.c_str());
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!batch_manifest.empty())
+	{
+		std::vector<SuperPacker::BatchOutput> batch_outputs;
+		if (!SuperPacker::load_batch_manifest(batch_manifest, batch_outputs)) return EXIT_FAILURE;
+
+		SuperPacker::set_export_mips(mips);
+		const auto start = std::chrono::steady_clock::now();
+		const auto statistics = SuperPacker::run_batch(batch_outputs);
+
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		logger_validate("packed %zu image(s) in %.2f s (%.2f images/s), %zu source(s) decoded, at most %zu in memory", statistics.written, elapsed, statistics.written / elapsed, statistics.decoded, statistics.peak_decoded);
+		if (statistics.failed == 0) return EXIT_SUCCESS;
+		logger_error("%zu image(s) failed", statistics.failed);
+		return EXIT_FAILURE;
+	}
+
+	if (output.empty())
+	{
+		logger_error("missing output path");
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (format.empty())
+	{
+		format = std::filesystem::path(output).extension().string();
+		if (!format.empty()) format.erase(0, 1);
+	}
+	if (format == "jpeg") format = "jpg";
+	if (std::ranges::find(formats, format) == formats.end())
+	{
+		logger_error("unsuported format : %s", format.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// Deduce combination from the last assigned channel
+	if (combination_name.empty())
+	{
+		int last_channel = default_source.empty() ? 0 : 3;
+		for (const auto& argument : arguments) last_channel = std::max(last_channel, argument.first);
+		for (const auto& expression : expressions) last_channel = std::max(last_channel, expression.first);
+		combination_name = last_channel == 0 ? "grayscale" : last_channel == 1 ? "rg" : last_channel == 2 ? "rgb" : "rgba";
+	}
+	const int channel_count = SuperPacker::get_combination_channel_count(combination_name);
+	if (channel_count == 0)
+	{
+		logger_error("unknown channel combination : %s", combination_name.c_str());
+		return EXIT_FAILURE;
+	}
+
+	SuperPacker::set_export_mips(mips);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (stream)
+	{
+		if (mips) logger_warning("mips are not generated in stream mode");
+		if (resample)
+		{
+			logger_error("resampling is not supported in stream mode");
+			return EXIT_FAILURE;
+		}
+		if (!expressions.empty())
+		{
+			logger_error("expressions are not supported in stream mode");
+			return EXIT_FAILURE;
+		}
+		std::vector<SuperPacker::StreamSource> sources(channel_count);
+		for (int c = 0; c < static_cast<int>(sources.size()); ++c)
+		{
+			auto& source = sources[c];
+			source.source_channel = static_cast<uint8_t>(c);
+			source.default_value = c == 3 ? 255 : 0;
+
+			SuperPacker::BatchChannel argument;
+			if (const auto it = arguments.find(c); it != arguments.end()) argument = it->second;
+			else if (!default_source.empty()) argument.path = default_source;
+
+			if (argument.default_value >= 0) source.default_value = static_cast<uint8_t>(argument.default_value);
+			else source.path = argument.path;
+			if (argument.source_channel >= 0) source.source_channel = static_cast<uint8_t>(argument.source_channel);
+		}
+
+		logger_log("stream to %s (%d channels, %d rows per strip)", output.c_str(), static_cast<int>(sources.size()), strip_rows);
+		if (!SuperPacker::stream_pack(sources, output, format, strip_rows)) return EXIT_FAILURE;
+
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		logger_validate("packed 1 image in %.2f ms (%.2f images/s)", elapsed * 1000.0, 1.0 / elapsed);
+		return EXIT_SUCCESS;
+	}
+
+	// Each source file is only decoded once, even if it is assigned to multiple channels
+	const auto load = [&](const std::filesystem::path& path)
+	{
+		auto image = SuperPacker::ImageCache::load(path);
+		if (!image) logger_error("failed to load %s : %s", path.string().c_str(), stbi_failure_reason());
+		return image;
+	};
+
+	// Source assigned to output channel c : its argument, the default source, or a constant
+	const auto make_source = [&](const int c, SuperPacker::ChannelSource& source)
+	{
+		source.source_channel = static_cast<uint8_t>(c);
+		source.default_value = c == 3 ? 255 : 0;
+
+		SuperPacker::BatchChannel argument;
+		if (const auto it = arguments.find(c); it != arguments.end()) argument = it->second;
+		else if (!default_source.empty()) argument.path = default_source;
+
+		if (argument.default_value >= 0)
+		{
+			source.default_value = static_cast<uint8_t>(argument.default_value);
+		}
+		else if (!argument.path.empty())
+		{
+			source.image = load(argument.path);
+			if (!source.image) return false;
+			if (argument.source_channel >= 0) source.source_channel = static_cast<uint8_t>(argument.source_channel);
+		}
+		return true;
+	};
+
+	static const std::vector<std::string> variables = { "r", "g", "b", "a" };
+	std::vector<SuperPacker::ChannelSource> sources(channel_count);
+	for (int c = 0; c < static_cast<int>(sources.size()); ++c)
+	{
+		const auto expression = expressions.find(c);
+		if (expression == expressions.end())
+		{
+			if (!make_source(c, sources[c])) return EXIT_FAILURE;
+			continue;
+		}
+
+		std::string error;
+		sources[c].expression = SuperPacker::Expression::compile(expression->second, variables, error);
+		if (!sources[c].expression)
+		{
+			logger_error("invalid expression for %s : %s", variables[c].c_str(), error.c_str());
+			return EXIT_FAILURE;
+		}
+
+		// Variables read the sources assigned to each channel, even outside of the combination
+		sources[c].inputs.resize(variables.size());
+		for (int v = 0; v < static_cast<int>(variables.size()); ++v)
+			if (sources[c].expression->get_variable_mask() & 1u << v && !make_source(v, sources[c].inputs[v])) return EXIT_FAILURE;
+	}
+
+	// 16 bits and float sources keep their precision if the output format can store it
+	const auto packed_image = SuperPacker::pack_for_format(sources, format, resample);
+	if (!packed_image)
+	{
+		logger_error("cannot export current image combination");
+		return EXIT_FAILURE;
+	}
+
+	logger_log("export to %s (%d channels)", output.c_str(), packed_image->get_channels());
+	if (!SuperPacker::write_image(output, format, *packed_image)) return EXIT_FAILURE;
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const auto cache_statistics = SuperPacker::ImageCache::get_statistics();
+	logger_validate("packed 1 image in %.2f ms (%.2f images/s), %zu source(s) decoded, %zu cache hit(s)", elapsed * 1000.0, 1.0 / elapsed, cache_statistics.misses, cache_statistics.hits);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,328 @@
+#include "Batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+
+#include "Executor.h"
+#include "Image.h"
+#include "ImageWriter.h"
+#include "IniLoader.h"
+#include "Logger.h"
+#include "Packer.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	static const std::vector<std::string> channel_names = { "r", "g", "b", "a" };
+
+	/** Source file shared by the outputs reading it */
+	struct SourceNode
+	{
+		explicit SourceNode(std::filesystem::path in_path)
+			: path(std::move(in_path)) {}
+
+		const std::filesystem::path path;
+		std::mutex lock;
+		std::shared_future<std::shared_ptr<const IImage>> image;
+		bool requested = false;
+		std::atomic<size_t> consumers = 0;
+	};
+
+	/** Channels of the sources read by output (expressions read every channel of their variables) */
+	static uint32_t get_used_channels(const BatchOutput& output)
+	{
+		uint32_t mask = 0;
+		for (int c = 0; c < output.channel_count; ++c) mask |= output.expressions[c] ? output.expressions[c]->get_variable_mask() & 0xF : 1u << c;
+		return mask;
+	}
+
+	int get_channel_index(const std::string& name)
+	{
+		const auto channel = std::ranges::find(channel_names, name);
+		return channel == channel_names.end() ? -1 : static_cast<int>(channel - channel_names.begin());
+	}
+
+	int get_combination_channel_count(const std::string& name)
+	{
+		if (name == "grayscale") return 1;
+		if (name == "rg") return 2;
+		if (name == "rgb") return 3;
+		if (name == "rgba") return 4;
+		return 0;
+	}
+
+	bool parse_batch_channel(const std::string& value, BatchChannel& channel)
+	{
+		if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos)
+		{
+			channel.default_value = value.size() <= 3 ? std::stoi(value) : 256;
+			return channel.default_value <= 255;
+		}
+
+		const auto separator = value.find_last_of(':');
+		if (separator != std::string::npos && separator + 2 == value.size() && get_channel_index(value.substr(separator + 1)) >= 0)
+		{
+			channel.path = value.substr(0, separator);
+			channel.source_channel = get_channel_index(value.substr(separator + 1));
+		}
+		else
+		{
+			channel.path = value;
+		}
+		return !channel.path.empty();
+	}
+
+	bool load_batch_manifest(const std::filesystem::path& path, std::vector<BatchOutput>& outputs)
+	{
+		if (!std::filesystem::is_regular_file(path))
+		{
+			logger_error("cannot find batch manifest %s", path.string().c_str());
+			return false;
+		}
+
+		static const std::vector<std::string> formats = { "png", "tga", "bmp", "jpg", "dds", "ktx", "hdr" };
+
+		IniLoader manifest(path.string());
+		const std::filesystem::path directory = path.parent_path();
+		bool valid = true;
+
+		for (const auto& category : manifest.get_categories())
+		{
+			if (category == "defaults") continue;
+
+			// Keys of the output, or of [defaults]
+			const auto get_value = [&](const std::string& key)
+			{
+				const std::string value = manifest.get_property_as_string(category, key, "");
+				return value.empty() ? manifest.get_property_as_string("defaults", key, "") : value;
+			};
+			const auto fail = [&](const std::string& message)
+			{
+				logger_error("%s : [%s] %s", path.string().c_str(), category.c_str(), message.c_str());
+				valid = false;
+			};
+
+			BatchOutput output;
+			output.path = directory / category;
+
+			// Format of the output, of its extension, then of [defaults]
+			output.format = manifest.get_property_as_string(category, "format", "");
+			if (output.format.empty())
+			{
+				output.format = output.path.extension().string();
+				if (!output.format.empty()) output.format.erase(0, 1);
+			}
+			if (output.format.empty()) output.format = manifest.get_property_as_string("defaults", "format", "");
+			if (output.format == "jpeg") output.format = "jpg";
+			if (std::ranges::find(formats, output.format) == formats.end())
+			{
+				fail("unsupported format " + output.format);
+				continue;
+			}
+
+			// Deduce combination from the last assigned channel
+			const std::string default_source = get_value("source");
+			int last_channel = default_source.empty() ? 0 : 3;
+			for (int c = 0; c < 4; ++c)
+			{
+				const std::string value = get_value(channel_names[c]);
+				if (!value.empty())
+				{
+					if (!parse_batch_channel(value, output.channels[c])) fail("invalid channel value " + channel_names[c] + '=' + value);
+					last_channel = std::max(last_channel, c);
+				}
+				else if (!default_source.empty())
+				{
+					output.channels[c].path = default_source;
+				}
+				if (!output.channels[c].path.empty()) output.channels[c].path = directory / output.channels[c].path;
+
+				const std::string expression = get_value("expression_" + channel_names[c]);
+				if (expression.empty()) continue;
+				std::string error;
+				output.expressions[c] = Expression::compile(expression, channel_names, error);
+				if (!output.expressions[c]) fail("invalid expression for " + channel_names[c] + " : " + error);
+				last_channel = std::max(last_channel, c);
+			}
+
+			const std::string combination = get_value("combination");
+			output.channel_count = get_combination_channel_count(!combination.empty() ? combination : last_channel == 0 ? "grayscale" : last_channel == 1 ? "rg" : last_channel == 2 ? "rgb" : "rgba");
+			if (output.channel_count == 0) fail("unknown channel combination " + combination);
+
+			const std::string resample_filter = get_value("resample");
+			const std::string resample_size = get_value("size");
+			if (!resample_filter.empty() && !parse_resample_filter(resample_filter, output.resample.emplace().filter)) fail("unknown resample filter " + resample_filter);
+			if (!resample_size.empty() && !parse_resample_size(resample_size, output.resample ? *output.resample : output.resample.emplace())) fail("invalid size " + resample_size);
+
+			outputs.emplace_back(std::move(output));
+		}
+
+		if (valid && outputs.empty()) logger_warning("%s does not contain any output", path.string().c_str());
+		return valid;
+	}
+
+	BatchStatistics run_batch(const std::vector<BatchOutput>& outputs)
+	{
+		trace_zone("run batch");
+
+		// Graph : one node per distinct source file, linked to the outputs reading it
+		std::vector<std::unique_ptr<SourceNode>> nodes;
+		std::unordered_map<std::string, size_t> node_indices;
+		std::vector<std::array<size_t, 4>> channel_nodes(outputs.size());
+		std::vector<std::vector<size_t>> output_nodes(outputs.size());
+		for (size_t o = 0; o < outputs.size(); ++o)
+		{
+			const uint32_t used_channels = get_used_channels(outputs[o]);
+			for (int c = 0; c < 4; ++c)
+			{
+				channel_nodes[o][c] = SIZE_MAX;
+				const auto& channel = outputs[o].channels[c];
+				if (!(used_channels & 1u << c) || channel.default_value >= 0 || channel.path.empty()) continue;
+
+				std::error_code error;
+				auto key = std::filesystem::weakly_canonical(channel.path, error);
+				if (error) key = channel.path.lexically_normal();
+				const auto [node, inserted] = node_indices.try_emplace(key.string(), nodes.size());
+				if (inserted) nodes.emplace_back(std::make_unique<SourceNode>(channel.path));
+
+				channel_nodes[o][c] = node->second;
+				if (std::ranges::find(output_nodes[o], node->second) != output_nodes[o].end()) continue;
+				output_nodes[o].push_back(node->second);
+				nodes[node->second]->consumers++;
+			}
+		}
+
+		// Outputs sharing source files (directly or through other outputs) are grouped, so their files are released early
+		std::vector<size_t> groups(outputs.size());
+		std::iota(groups.begin(), groups.end(), 0);
+		const auto find_group = [&](size_t output)
+		{
+			while (groups[output] != output) output = groups[output] = groups[groups[output]];
+			return output;
+		};
+		std::vector<size_t> first_consumers(nodes.size(), SIZE_MAX);
+		for (size_t o = 0; o < outputs.size(); ++o)
+		{
+			for (const size_t node : output_nodes[o])
+			{
+				if (first_consumers[node] == SIZE_MAX) first_consumers[node] = o;
+				const size_t a = find_group(o);
+				const size_t b = find_group(first_consumers[node]);
+				groups[std::max(a, b)] = std::min(a, b); // groups are identified by their first output
+			}
+		}
+		std::vector<size_t> order(outputs.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::ranges::stable_sort(order, [&](const size_t a, const size_t b) { return find_group(a) < find_group(b); });
+
+		std::atomic<size_t> written = 0;
+		std::atomic<size_t> failed = 0;
+		std::atomic<size_t> decoded = 0;
+		std::atomic<size_t> resident = 0;
+		std::atomic<size_t> peak_resident = 0;
+
+		// First output reading a file decodes it, concurrent readers wait for the same result
+		const auto acquire = [&](SourceNode& node)
+		{
+			std::promise<std::shared_ptr<const IImage>> promise;
+			std::shared_future<std::shared_ptr<const IImage>> image;
+			bool decode = false;
+			{
+				std::lock_guard guard(node.lock);
+				if (!node.requested)
+				{
+					node.requested = true;
+					node.image = promise.get_future().share();
+					decode = true;
+				}
+				image = node.image;
+			}
+
+			if (decode)
+			{
+				std::shared_ptr<const IImage> decoded_image = load_image(node.path);
+				if (!decoded_image->is_valid())
+				{
+					logger_error("failed to load %s : %s", node.path.string().c_str(), stbi_failure_reason());
+					decoded_image = nullptr;
+				}
+				else
+				{
+					decoded++;
+					const size_t count = ++resident;
+					size_t peak = peak_resident.load();
+					while (peak < count && !peak_resident.compare_exchange_weak(peak, count)) {}
+				}
+				promise.set_value(decoded_image);
+			}
+			return image.get();
+		};
+
+		// Last output reading a file releases it
+		const auto release = [&](SourceNode& node)
+		{
+			if (node.consumers.fetch_sub(1) != 1) return;
+			std::lock_guard guard(node.lock);
+			if (node.image.valid() && node.image.get()) resident--;
+			node.image = {};
+		};
+
+		const auto run_output = [&](const size_t o)
+		{
+			trace_zone("batch output");
+			const BatchOutput& output = outputs[o];
+			bool success = true;
+			{
+				std::array<std::shared_ptr<const IImage>, 4> images;
+				for (int c = 0; c < 4; ++c)
+					if (channel_nodes[o][c] != SIZE_MAX && !(images[c] = acquire(*nodes[channel_nodes[o][c]]))) success = false;
+
+				const auto make_source = [&](const int c, ChannelSource& source)
+				{
+					const auto& channel = output.channels[c];
+					source.image = images[c];
+					source.source_channel = static_cast<uint8_t>(channel.source_channel >= 0 ? channel.source_channel : c);
+					source.default_value = static_cast<uint8_t>(channel.default_value >= 0 ? channel.default_value : c == 3 ? 255 : 0);
+				};
+
+				std::vector<ChannelSource> sources(output.channel_count);
+				for (int c = 0; c < output.channel_count; ++c)
+				{
+					if (!output.expressions[c])
+					{
+						make_source(c, sources[c]);
+						continue;
+					}
+					sources[c].expression = output.expressions[c];
+					sources[c].inputs.resize(channel_names.size());
+					for (int v = 0; v < static_cast<int>(channel_names.size()); ++v)
+						if (output.expressions[c]->get_variable_mask() & 1u << v) make_source(v, sources[c].inputs[v]);
+				}
+
+				if (success)
+				{
+					const auto packed_image = pack_for_format(sources, output.format, output.resample);
+					if (!packed_image) logger_error("cannot pack %s : sources have different sizes or no source is assigned", output.path.string().c_str());
+
+					std::error_code error;
+					if (output.path.has_parent_path()) std::filesystem::create_directories(output.path.parent_path(), error);
+					success = packed_image && write_image(output.path.string(), output.format, *packed_image);
+				}
+			}
+
+			for (const size_t node : output_nodes[o]) release(*nodes[node]);
+			(success ? written : failed)++;
+		};
+
+		Executor::parallel_for(order.size(), 1, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i) run_output(order[i]);
+		});
+
+		return { written.load(), failed.load(), decoded.load(), peak_resident.load() };
+	}
+}
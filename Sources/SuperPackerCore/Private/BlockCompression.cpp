@@ -0,0 +1,478 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Executor.h"
+#include "Trace.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BLOCK_COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace SuperPacker::BlockCompression
+{
+	/** Pixels of a 4x4 block, as one plane of 16 values per channel */
+	struct Block
+	{
+		alignas(16) float values[4][16];
+	};
+
+	/** Palette entries (up to 16), with one value per channel */
+	typedef float Palette[16][4];
+
+	/*
+	 * Palette search
+	 */
+
+#if BLOCK_COMPRESSION_SSE2
+	/** Nearest palette entry of each pixel, over channels [channel_begin, channel_begin + channel_count), 4 pixels at once. Return the total squared error */
+	static float find_indices(const Block& block, const Palette& palette, const int entry_count, const int channel_begin, const int channel_count, uint8_t* indices)
+	{
+		__m128 total_error = _mm_setzero_ps();
+		for (int group = 0; group < 16; group += 4)
+		{
+			__m128 pixels[4];
+			for (int c = 0; c < channel_count; ++c) pixels[c] = _mm_load_ps(block.values[channel_begin + c] + group);
+
+			__m128 best_error = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i best_index = _mm_setzero_si128();
+			for (int e = 0; e < entry_count; ++e)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int c = 0; c < channel_count; ++c)
+				{
+					const __m128 difference = _mm_sub_ps(pixels[c], _mm_set1_ps(palette[e][c]));
+					error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+				}
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best_error));
+				best_error = _mm_min_ps(error, best_error);
+				best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)), _mm_andnot_si128(closer, best_index));
+			}
+			total_error = _mm_add_ps(total_error, best_error);
+
+			alignas(16) int32_t group_indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(group_indices), best_index);
+			for (int i = 0; i < 4; ++i) indices[group + i] = static_cast<uint8_t>(group_indices[i]);
+		}
+
+		alignas(16) float errors[4];
+		_mm_store_ps(errors, total_error);
+		return errors[0] + errors[1] + errors[2] + errors[3];
+	}
+#else
+	/** Nearest palette entry of each pixel, over channels [channel_begin, channel_begin + channel_count). Return the total squared error */
+	static float find_indices(const Block& block, const Palette& palette, const int entry_count, const int channel_begin, const int channel_count, uint8_t* indices)
+	{
+		float total_error = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			float best_error = std::numeric_limits<float>::max();
+			for (int e = 0; e < entry_count; ++e)
+			{
+				float error = 0;
+				for (int c = 0; c < channel_count; ++c)
+				{
+					const float difference = block.values[channel_begin + c][i] - palette[e][c];
+					error += difference * difference;
+				}
+				if (error < best_error)
+				{
+					best_error = error;
+					indices[i] = static_cast<uint8_t>(e);
+				}
+			}
+			total_error += best_error;
+		}
+		return total_error;
+	}
+#endif
+
+	/*
+	 * Endpoint fitting
+	 */
+
+	/** Endpoints at the extremes of the block along its principal axis (power iteration over the covariance matrix) */
+	static void fit_principal_axis(const Block& block, const int channel_begin, const int channel_count, float* endpoint_0, float* endpoint_1)
+	{
+		float mean[4] = {};
+		float axis[4] = {};
+		for (int c = 0; c < channel_count; ++c)
+		{
+			const float* values = block.values[channel_begin + c];
+			const auto [min, max] = std::minmax_element(values, values + 16);
+			for (int i = 0; i < 16; ++i) mean[c] += values[i] / 16.0f;
+			axis[c] = *max - *min;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+			for (int a = 0; a < channel_count; ++a)
+				for (int b = 0; b < channel_count; ++b)
+					covariance[a][b] += (block.values[channel_begin + a][i] - mean[a]) * (block.values[channel_begin + b][i] - mean[b]);
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (int a = 0; a < channel_count; ++a)
+			{
+				for (int b = 0; b < channel_count; ++b) next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+			if (length <= 0) break;
+			for (int c = 0; c < channel_count; ++c) axis[c] = next[c] / length;
+		}
+
+		float squared_length = 0;
+		for (int c = 0; c < channel_count; ++c) squared_length += axis[c] * axis[c];
+
+		float min_t = 0;
+		float max_t = 0;
+		if (squared_length > 0)
+		{
+			min_t = std::numeric_limits<float>::max();
+			max_t = std::numeric_limits<float>::lowest();
+			for (int i = 0; i < 16; ++i)
+			{
+				float t = 0;
+				for (int c = 0; c < channel_count; ++c) t += (block.values[channel_begin + c][i] - mean[c]) * axis[c];
+				min_t = std::min(min_t, t / squared_length);
+				max_t = std::max(max_t, t / squared_length);
+			}
+		}
+
+		for (int c = 0; c < channel_count; ++c)
+		{
+			endpoint_0[c] = std::clamp(mean[c] + min_t * axis[c], 0.0f, 255.0f);
+			endpoint_1[c] = std::clamp(mean[c] + max_t * axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	/**
+	 * Endpoints minimizing the squared error of the block once each pixel is reconstructed as
+	 * lerp(endpoint_0, endpoint_1, weights[indices[i]]). Return false if the system is degenerate.
+	 */
+	static bool refine_endpoints(const Block& block, const int channel_begin, const int channel_count, const uint8_t* indices, const float* weights, float* endpoint_0, float* endpoint_1)
+	{
+		float a = 0, b = 0, c = 0;
+		float x[4] = {};
+		float y[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			const float t = weights[indices[i]];
+			a += (1 - t) * (1 - t);
+			b += (1 - t) * t;
+			c += t * t;
+			for (int k = 0; k < channel_count; ++k)
+			{
+				x[k] += (1 - t) * block.values[channel_begin + k][i];
+				y[k] += t * block.values[channel_begin + k][i];
+			}
+		}
+
+		const float determinant = a * c - b * b;
+		if (std::abs(determinant) < 1e-6f) return false;
+		for (int k = 0; k < channel_count; ++k)
+		{
+			endpoint_0[k] = std::clamp((c * x[k] - b * y[k]) / determinant, 0.0f, 255.0f);
+			endpoint_1[k] = std::clamp((a * y[k] - b * x[k]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	/*
+	 * Block encoders
+	 */
+
+	static uint16_t to_565(const float* color)
+	{
+		const auto quantize = [](const float value, const int max) { return static_cast<uint16_t>(std::lround(value * max / 255.0f)); };
+		return static_cast<uint16_t>(quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 | quantize(color[2], 31));
+	}
+
+	static void from_565(const uint16_t color, float* output)
+	{
+		const int r = color >> 11 & 31;
+		const int g = color >> 5 & 63;
+		const int b = color & 31;
+		output[0] = static_cast<float>(r << 3 | r >> 2);
+		output[1] = static_cast<float>(g << 2 | g >> 4);
+		output[2] = static_cast<float>(b << 3 | b >> 2);
+	}
+
+	/** Opaque 4 colors mode (color_0 > color_1), which is also the only mode of the color block of BC3 */
+	static void encode_bc1(const Block& block, uint8_t* output)
+	{
+		static constexpr float weights[4] = { 0, 1, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		float endpoint_0[4], endpoint_1[4];
+		fit_principal_axis(block, 0, 3, endpoint_0, endpoint_1);
+
+		float best_error = std::numeric_limits<float>::max();
+		uint16_t best_colors[2] = {};
+		uint8_t best_indices[16] = {};
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			uint16_t color_0 = to_565(endpoint_1);
+			uint16_t color_1 = to_565(endpoint_0);
+			if (color_0 < color_1) std::swap(color_0, color_1);
+
+			Palette palette;
+			from_565(color_0, palette[0]);
+			from_565(color_1, palette[1]);
+			for (int c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			uint8_t indices[16];
+			// Identical colors fall back to the 3 colors mode, where only the first entry is valid
+			const float error = color_0 == color_1 ? find_indices(block, palette, 1, 0, 3, indices) : find_indices(block, palette, 4, 0, 3, indices);
+			if (error < best_error)
+			{
+				best_error = error;
+				best_colors[0] = color_0;
+				best_colors[1] = color_1;
+				std::copy_n(indices, 16, best_indices);
+			}
+			if (error == 0 || color_0 == color_1 || !refine_endpoints(block, 0, 3, indices, weights, endpoint_1, endpoint_0)) break;
+		}
+
+		uint32_t packed_indices = 0;
+		for (int i = 0; i < 16; ++i) packed_indices |= static_cast<uint32_t>(best_indices[i]) << (i * 2);
+		for (int i = 0; i < 2; ++i)
+		{
+			output[i * 2] = static_cast<uint8_t>(best_colors[i]);
+			output[i * 2 + 1] = static_cast<uint8_t>(best_colors[i] >> 8);
+		}
+		for (int i = 0; i < 4; ++i) output[4 + i] = static_cast<uint8_t>(packed_indices >> (i * 8));
+	}
+
+	/** Single channel block in 8 values mode (value_0 > value_1). Also used for the alpha of BC3 and both channels of BC5 */
+	static void encode_bc4(const Block& block, const int channel, uint8_t* output)
+	{
+		static constexpr float weights[8] = { 0, 1, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7 };
+
+		const float* values = block.values[channel];
+		float endpoint_0 = *std::max_element(values, values + 16);
+		float endpoint_1 = *std::min_element(values, values + 16);
+
+		float best_error = std::numeric_limits<float>::max();
+		uint8_t best_values[2] = {};
+		uint8_t best_indices[16] = {};
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			auto value_0 = static_cast<uint8_t>(std::lround(endpoint_0));
+			auto value_1 = static_cast<uint8_t>(std::lround(endpoint_1));
+			if (value_0 < value_1) std::swap(value_0, value_1);
+
+			Palette palette;
+			palette[0][0] = value_0;
+			palette[1][0] = value_1;
+			for (int i = 1; i < 7; ++i) palette[i + 1][0] = static_cast<float>(((7 - i) * value_0 + i * value_1) / 7);
+
+			uint8_t indices[16];
+			// Identical values fall back to the 6 values mode, where the first entry is still value_0
+			const float error = find_indices(block, palette, value_0 == value_1 ? 1 : 8, channel, 1, indices);
+			if (error < best_error)
+			{
+				best_error = error;
+				best_values[0] = value_0;
+				best_values[1] = value_1;
+				std::copy_n(indices, 16, best_indices);
+			}
+			if (error == 0 || value_0 == value_1 || !refine_endpoints(block, channel, 1, indices, weights, &endpoint_0, &endpoint_1)) break;
+		}
+
+		uint64_t packed_indices = 0;
+		for (int i = 0; i < 16; ++i) packed_indices |= static_cast<uint64_t>(best_indices[i]) << (i * 3);
+		output[0] = best_values[0];
+		output[1] = best_values[1];
+		for (int i = 0; i < 6; ++i) output[2 + i] = static_cast<uint8_t>(packed_indices >> (i * 8));
+	}
+
+	/** Mode 6 : a single subset of rgba endpoints with 7 bits per channel and a shared low bit each, and 16 interpolated colors */
+	static void encode_bc7(const Block& block, uint8_t* output)
+	{
+		static constexpr int interpolation[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		static const auto weights = []
+		{
+			std::array<float, 16> values{};
+			for (int i = 0; i < 16; ++i) values[i] = static_cast<float>(interpolation[i]) / 64.0f;
+			return values;
+		}();
+
+		float endpoints[2][4];
+		fit_principal_axis(block, 0, 4, endpoints[0], endpoints[1]);
+
+		// Opaque blocks keep the low bits set, so that alpha decodes to exactly 255
+		const bool opaque = *std::min_element(block.values[3], block.values[3] + 16) >= 255.0f;
+
+		float best_error = std::numeric_limits<float>::max();
+		int best_quantized[2][4] = {};
+		int best_bits[2] = {};
+		uint8_t best_indices[16] = {};
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			// Each endpoint is 7 bits per channel and a low bit shared by its channels
+			int quantized[2][4];
+			int bits[2];
+			int decoded[2][4];
+			for (int e = 0; e < 2; ++e)
+			{
+				float best_endpoint_error = std::numeric_limits<float>::max();
+				for (int bit = opaque ? 1 : 0; bit < 2; ++bit)
+				{
+					float error = 0;
+					int candidate[4];
+					for (int c = 0; c < 4; ++c)
+					{
+						candidate[c] = std::clamp(static_cast<int>(std::lround((endpoints[e][c] - bit) / 2)), 0, 127);
+						const float difference = static_cast<float>(candidate[c] * 2 + bit) - endpoints[e][c];
+						error += difference * difference;
+					}
+					if (error >= best_endpoint_error) continue;
+					best_endpoint_error = error;
+					bits[e] = bit;
+					for (int c = 0; c < 4; ++c)
+					{
+						quantized[e][c] = candidate[c];
+						decoded[e][c] = candidate[c] * 2 + bit;
+					}
+				}
+			}
+
+			Palette palette;
+			for (int i = 0; i < 16; ++i)
+				for (int c = 0; c < 4; ++c)
+					palette[i][c] = static_cast<float>(((64 - interpolation[i]) * decoded[0][c] + interpolation[i] * decoded[1][c] + 32) >> 6);
+
+			uint8_t indices[16];
+			const float error = find_indices(block, palette, 16, 0, 4, indices);
+			if (error < best_error)
+			{
+				best_error = error;
+				std::copy_n(&quantized[0][0], 8, &best_quantized[0][0]);
+				std::copy_n(bits, 2, best_bits);
+				std::copy_n(indices, 16, best_indices);
+			}
+			if (error == 0 || !refine_endpoints(block, 0, 4, indices, weights.data(), endpoints[0], endpoints[1])) break;
+		}
+
+		// The most significant bit of the first index is implicit (0) : swap endpoints if needed
+		if (best_indices[0] >= 8)
+		{
+			for (int c = 0; c < 4; ++c) std::swap(best_quantized[0][c], best_quantized[1][c]);
+			std::swap(best_bits[0], best_bits[1]);
+			for (auto& index : best_indices) index = static_cast<uint8_t>(15 - index);
+		}
+
+		uint64_t bits[2] = {};
+		int position = 0;
+		const auto write = [&](const uint64_t value, const int count)
+		{
+			for (int i = 0; i < count; ++i, ++position) bits[position / 64] |= (value >> i & 1) << (position % 64);
+		};
+		write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			write(best_quantized[0][c], 7);
+			write(best_quantized[1][c], 7);
+		}
+		write(best_bits[0], 1);
+		write(best_bits[1], 1);
+		for (int i = 0; i < 16; ++i) write(best_indices[i], i ? 4 : 3);
+
+		for (int i = 0; i < 16; ++i) output[i] = static_cast<uint8_t>(bits[i / 8] >> (i % 8 * 8));
+	}
+
+	size_t get_block_size(const Format format)
+	{
+		return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+	}
+
+	Format get_default_format(const int channel_count)
+	{
+		switch (channel_count)
+		{
+		case 1: return Format::BC4;
+		case 2: return Format::BC5;
+		case 3: return Format::BC1;
+		default: return Format::BC3;
+		}
+	}
+
+	bool parse_format(const std::string& name, Format& format)
+	{
+		static constexpr std::pair<const char*, Format> names[] = {
+			{ "bc1", Format::BC1 }, { "bc3", Format::BC3 }, { "bc4", Format::BC4 }, { "bc5", Format::BC5 }, { "bc7", Format::BC7 },
+		};
+		for (const auto& [format_name, value] : names)
+		{
+			if (name != format_name) continue;
+			format = value;
+			return true;
+		}
+		return false;
+	}
+
+	std::vector<uint8_t> compress(const ChannelView* views, const int channel_count, const Format format)
+	{
+		trace_zone("compress blocks");
+		const int width = views[0].width;
+		const int height = views[0].height;
+		const int blocks_x = (width + 3) / 4;
+		const int blocks_y = (height + 3) / 4;
+		const size_t block_size = get_block_size(format);
+
+		std::vector<uint8_t> output(static_cast<size_t>(blocks_x) * blocks_y * block_size);
+		Executor::parallel_for(blocks_y, 1, [&](const size_t begin, const size_t end)
+		{
+			Block block;
+			for (size_t block_y = begin; block_y < end; ++block_y)
+			{
+				for (int block_x = 0; block_x < blocks_x; ++block_x)
+				{
+					for (int c = 0; c < 4; ++c)
+					{
+						for (int i = 0; i < 16; ++i)
+						{
+							const int x = std::min(block_x * 4 + i % 4, width - 1);
+							const int y = std::min(static_cast<int>(block_y) * 4 + i / 4, height - 1);
+							block.values[c][i] = c < channel_count ? views[c].at(x, y) : c == 3 ? 255.0f : 0.0f;
+						}
+					}
+
+					uint8_t* destination = output.data() + (block_y * blocks_x + block_x) * block_size;
+					switch (format)
+					{
+					case Format::BC1:
+						encode_bc1(block, destination);
+						break;
+					case Format::BC3:
+						encode_bc4(block, 3, destination);
+						encode_bc1(block, destination + 8);
+						break;
+					case Format::BC4:
+						encode_bc4(block, 0, destination);
+						break;
+					case Format::BC5:
+						encode_bc4(block, 0, destination);
+						encode_bc4(block, 1, destination + 8);
+						break;
+					case Format::BC7:
+						encode_bc7(block, destination);
+						break;
+					}
+				}
+			}
+		});
+		return output;
+	}
+}
@@ -0,0 +1,1050 @@
+#include "Deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <queue>
+
+#include "Executor.h"
+
+namespace SuperPacker::Deflate
+{
+	static constexpr int window_size = 32768;
+	static constexpr int min_match = 3;
+	static constexpr int max_match = 258;
+
+	static constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static constexpr uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	/** Code lengths of the fixed Huffman codes (RFC 1951 3.2.6) */
+	static std::array<uint8_t, 320> fixed_code_lengths()
+	{
+		std::array<uint8_t, 320> lengths{};
+		for (int i = 0; i < 288; ++i) lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+		for (int i = 288; i < 320; ++i) lengths[i] = 5;
+		return lengths;
+	}
+
+	static uint32_t reverse_bits(uint32_t code, const int length)
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < length; ++i, code >>= 1) result = result << 1 | (code & 1);
+		return result;
+	}
+
+	/** Canonical Huffman codes from code lengths, bit reversed to be written LSB first */
+	static void build_codes(const uint8_t* lengths, const int count, uint16_t* codes)
+	{
+		int length_count[16] = {};
+		for (int i = 0; i < count; ++i) length_count[lengths[i]]++;
+		length_count[0] = 0;
+
+		uint32_t next_code[16] = {};
+		uint32_t code = 0;
+		for (int bits = 1; bits < 16; ++bits)
+		{
+			code = (code + length_count[bits - 1]) << 1;
+			next_code[bits] = code;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			if (lengths[i]) codes[i] = static_cast<uint16_t>(reverse_bits(next_code[lengths[i]]++, lengths[i]));
+		}
+	}
+
+	uint32_t adler32(const uint8_t* data, size_t size, const uint32_t adler)
+	{
+		uint32_t a = adler & 0xFFFF;
+		uint32_t b = adler >> 16;
+		while (size)
+		{
+			// Largest block that cannot overflow before the modulo
+			const size_t block = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < block; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += block;
+			size -= block;
+		}
+		return b << 16 | a;
+	}
+
+	uint32_t adler32_combine(const uint32_t adler1, const uint32_t adler2, const size_t size2)
+	{
+		// Same as zlib : the sums of the first part are shifted by the length of the second one
+		constexpr uint64_t base = 65521;
+		const uint64_t remainder = size2 % base;
+		const uint64_t a1 = adler1 & 0xFFFF;
+		const uint64_t b1 = adler1 >> 16;
+		const uint64_t a2 = adler2 & 0xFFFF;
+		const uint64_t b2 = adler2 >> 16;
+
+		const uint64_t a = (a1 + a2 + base - 1) % base;
+		const uint64_t b = (b1 + b2 + remainder * a1 + base - remainder) % base;
+		return static_cast<uint32_t>(b << 16 | a);
+	}
+
+	uint32_t crc32(const uint8_t* data, const size_t size, uint32_t crc)
+	{
+		static const auto table = []
+		{
+			std::array<uint32_t, 256> values{};
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				values[n] = c;
+			}
+			return values;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	/*
+	 * Encoder
+	 */
+
+	/** Length code (0-28) of each match length */
+	static const auto length_codes = []
+	{
+		std::array<uint8_t, max_match + 1> codes{};
+		for (int length = min_match; length <= max_match; ++length)
+			codes[length] = static_cast<uint8_t>(std::upper_bound(std::begin(length_base), std::end(length_base), length) - std::begin(length_base) - 1);
+		return codes;
+	}();
+
+	/** Distance code (0-29) of each match distance */
+	static const auto distance_codes = []
+	{
+		std::array<uint8_t, window_size + 1> codes{};
+		for (int distance = 1; distance <= window_size; ++distance)
+			codes[distance] = static_cast<uint8_t>(std::upper_bound(std::begin(distance_base), std::end(distance_base), distance) - std::begin(distance_base) - 1);
+		return codes;
+	}();
+
+	/** Number of identical bytes at the start of a and b, up to max_length */
+	static int match_length(const uint8_t* a, const uint8_t* b, const int max_length)
+	{
+		int length = 0;
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			for (; length + 8 <= max_length; length += 8)
+			{
+				uint64_t x, y;
+				memcpy(&x, a + length, 8);
+				memcpy(&y, b + length, 8);
+				if (x != y) return length + (std::countr_zero(x ^ y) >> 3);
+			}
+		}
+		while (length < max_length && a[length] == b[length]) ++length;
+		return length;
+	}
+
+	/**
+	 * Huffman code lengths limited to max_length bits. Symbols with a frequency of 0 get no code, except that
+	 * at least two codes are always assigned so that the code is complete.
+	 */
+	static void build_lengths(const uint32_t* frequencies, const int count, const int max_length, uint8_t* lengths)
+	{
+		struct Node
+		{
+			uint64_t weight;
+			int parent;
+		};
+		using Entry = std::pair<uint64_t, int>;
+
+		std::vector<uint32_t> weights(frequencies, frequencies + count);
+		auto used = std::ranges::count_if(weights, [](const uint32_t weight) { return weight != 0; });
+		for (int i = 0; i < count && used < 2; ++i)
+		{
+			if (!weights[i])
+			{
+				weights[i] = 1;
+				++used;
+			}
+		}
+
+		while (true)
+		{
+			std::vector<Node> nodes;
+			std::vector<int> leaves(count, -1);
+			std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+			for (int i = 0; i < count; ++i)
+			{
+				if (!weights[i]) continue;
+				leaves[i] = static_cast<int>(nodes.size());
+				queue.emplace(weights[i], leaves[i]);
+				nodes.push_back({ weights[i], -1 });
+			}
+
+			std::fill_n(lengths, count, 0);
+			while (queue.size() > 1)
+			{
+				const auto [weight_a, a] = queue.top();
+				queue.pop();
+				const auto [weight_b, b] = queue.top();
+				queue.pop();
+				nodes[a].parent = nodes[b].parent = static_cast<int>(nodes.size());
+				queue.emplace(weight_a + weight_b, static_cast<int>(nodes.size()));
+				nodes.push_back({ weight_a + weight_b, -1 });
+			}
+
+			// Parents are always created after their children
+			std::vector<int> depths(nodes.size(), 0);
+			for (int n = static_cast<int>(nodes.size()) - 2; n >= 0; --n) depths[n] = depths[nodes[n].parent] + 1;
+
+			int longest = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				if (leaves[i] < 0) continue;
+				lengths[i] = static_cast<uint8_t>(std::min(depths[leaves[i]], 255));
+				longest = std::max(longest, depths[leaves[i]]);
+			}
+			if (longest <= max_length) return;
+
+			// Flatten the distribution until the tree is short enough
+			for (auto& weight : weights)
+				if (weight) weight = (weight + 1) / 2;
+		}
+	}
+
+	/** Huffman codes of a dynamic block, and its header */
+	struct DynamicCodes
+	{
+		/** Run length encoded code length : symbol 0-18, and the value of its extra bits */
+		struct LengthSymbol
+		{
+			uint8_t symbol;
+			uint8_t extra;
+		};
+
+		std::array<uint8_t, 286> literal_lengths{};
+		std::array<uint16_t, 286> literal_codes{};
+		std::array<uint8_t, 30> distance_lengths{};
+		std::array<uint16_t, 30> distance_codes{};
+		int literal_count = 257;
+		int distance_count = 1;
+
+		std::vector<LengthSymbol> length_symbols;
+		std::array<uint8_t, 19> length_code_lengths{};
+		std::array<uint16_t, 19> length_codes{};
+		int length_code_count = 4;
+
+		/** Bits used by the header after the block type */
+		uint64_t header_bits = 0;
+
+		static constexpr uint8_t length_code_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		static constexpr uint8_t length_symbol_extra[19] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7 };
+
+		DynamicCodes(const std::array<uint32_t, 286>& literal_frequencies, const std::array<uint32_t, 30>& distance_frequencies)
+		{
+			build_lengths(literal_frequencies.data(), 286, 15, literal_lengths.data());
+			build_lengths(distance_frequencies.data(), 30, 15, distance_lengths.data());
+			build_codes(literal_lengths.data(), 286, literal_codes.data());
+			build_codes(distance_lengths.data(), 30, distance_codes.data());
+
+			while (literal_count < 286 && std::any_of(literal_lengths.begin() + literal_count, literal_lengths.end(), [](const uint8_t length) { return length != 0; })) ++literal_count;
+			while (distance_count < 30 && std::any_of(distance_lengths.begin() + distance_count, distance_lengths.end(), [](const uint8_t length) { return length != 0; })) ++distance_count;
+
+			// Literal and distance code lengths are encoded as a single sequence (RFC 1951 3.2.7)
+			std::vector<uint8_t> lengths(literal_lengths.begin(), literal_lengths.begin() + literal_count);
+			lengths.insert(lengths.end(), distance_lengths.begin(), distance_lengths.begin() + distance_count);
+			std::array<uint32_t, 19> frequencies{};
+			for (size_t i = 0; i < lengths.size();)
+			{
+				size_t run = 1;
+				while (i + run < lengths.size() && lengths[i + run] == lengths[i]) ++run;
+
+				if (lengths[i] == 0 && run >= 11)
+				{
+					run = std::min<size_t>(run, 138);
+					length_symbols.push_back({ 18, static_cast<uint8_t>(run - 11) });
+				}
+				else if (lengths[i] == 0 && run >= 3)
+				{
+					length_symbols.push_back({ 17, static_cast<uint8_t>(run - 3) });
+				}
+				else if (lengths[i] != 0 && run >= 4)
+				{
+					// The length itself, then 3 to 6 repetitions of it
+					run = 1 + std::min<size_t>(run - 1, 6);
+					length_symbols.push_back({ lengths[i], 0 });
+					length_symbols.push_back({ 16, static_cast<uint8_t>(run - 4) });
+				}
+				else
+				{
+					run = 1;
+					length_symbols.push_back({ lengths[i], 0 });
+				}
+				i += run;
+			}
+			for (const auto& symbol : length_symbols) frequencies[symbol.symbol]++;
+
+			build_lengths(frequencies.data(), 19, 7, length_code_lengths.data());
+			build_codes(length_code_lengths.data(), 19, length_codes.data());
+			length_code_count = 19;
+			while (length_code_count > 4 && length_code_lengths[length_code_order[length_code_count - 1]] == 0) --length_code_count;
+
+			header_bits = 5 + 5 + 4 + 3 * length_code_count;
+			for (const auto& symbol : length_symbols) header_bits += length_code_lengths[symbol.symbol] + length_symbol_extra[symbol.symbol];
+		}
+	};
+
+	/** Compression settings of each level (zlib's configuration table, with longer chains on lazy levels so that sizes decrease with the level) */
+	struct LevelSettings
+	{
+		int good_length;     // only test a quarter of the chain when looking for a longer match than one this long (lazy levels)
+		int max_lazy;        // try a longer match at the next byte if the current one is shorter than this (lazy levels)
+		int nice_length;     // stop searching once a match is this long
+		int max_chain;       // candidates tested for each match
+		bool lazy;
+	};
+
+	static constexpr LevelSettings level_settings[10] = {
+		{ 0, 0, 0, 0, false }, { 4, 4, 8, 4, false }, { 4, 6, 32, 8, false }, { 4, 8, 32, 16, false }, { 16, 16, 32, 64, true },
+		{ 16, 16, 32, 128, true }, { 16, 16, 64, 192, true }, { 16, 32, 128, 256, true }, { 32, 128, 258, 1024, true }, { 32, 258, 258, 4096, true },
+	};
+
+	/** Matches of min_match bytes further than this cost more than their literals (dropped by lazy levels, like zlib) */
+	static constexpr int too_far = 4096;
+
+	/** Raw deflate stream. Each call to compress() encodes pending bytes with the cheapest of stored, fixed or dynamic blocks */
+	class Compressor
+	{
+	public:
+		static constexpr int hash_bits = 15;
+		static constexpr size_t block_size = 128 * 1024;
+
+		explicit Compressor(const int in_level)
+			: level(std::clamp(in_level, 0, 9)), settings(level_settings[level]), head(1 << hash_bits, -1), previous(window_size, 0)
+		{
+			static const auto lengths = fixed_code_lengths();
+			build_codes(lengths.data(), 288, fixed_literal_codes.data());
+			build_codes(lengths.data() + 288, 32, fixed_distance_codes.data());
+			fixed_lengths = lengths;
+		}
+
+		/** Append input to the window. Pending bytes are only compressed by compress() */
+		void append(const uint8_t* data, const size_t size)
+		{
+			window.insert(window.end(), data, data + size);
+		}
+
+		/**
+		 * Append input a block at a time and compress every full block, so the window never holds more than the history and one block.
+		 * Enough lookahead is kept so that matches are not cut at block boundaries
+		 */
+		void write(const uint8_t* data, const size_t size, std::vector<uint8_t>& output)
+		{
+			constexpr size_t lookahead_size = block_size + max_match;
+			for (size_t offset = 0; offset < size;)
+			{
+				const size_t count = std::min(size - offset, lookahead_size - std::min(get_pending_size(), lookahead_size - 1));
+				append(data + offset, count);
+				offset += count;
+				if (get_pending_size() >= lookahead_size) compress(block_size, false, output);
+			}
+		}
+
+		/** Start the stream after the given history, which can be referenced by the first matches */
+		void set_dictionary(const uint8_t* dictionary, const size_t size)
+		{
+			window.insert(window.begin(), dictionary, dictionary + size);
+			position = size;
+			if (level == 0) return;
+			for (size_t i = 0; i < size && i + min_match <= window.size(); ++i) insert(i);
+		}
+
+		[[nodiscard]] size_t get_pending_size() const { return window.size() - position; }
+		[[nodiscard]] int get_level() const { return level; }
+
+		/** Compress pending bytes up to end (index in the pending bytes) */
+		void compress(const size_t pending_end, const bool final, std::vector<uint8_t>& output)
+		{
+			const size_t begin = position;
+			const size_t end = position + pending_end;
+			if (level == 0)
+			{
+				write_stored_blocks(output, begin, end, final);
+				position = end;
+			}
+			else
+			{
+				parse(end);
+				write_cheapest_block(output, begin, final);
+			}
+
+			// Only keep the history needed by the next matches
+			if (position > static_cast<size_t>(window_size) * 2)
+			{
+				const size_t discarded = position - window_size;
+				window.erase(window.begin(), window.begin() + static_cast<ptrdiff_t>(discarded));
+				window_start += static_cast<int64_t>(discarded);
+				position -= discarded;
+
+				// Heads are window indices : slide them, and drop positions that left the window
+				for (auto& entry : head) entry = entry >= static_cast<int64_t>(discarded) ? entry - static_cast<int32_t>(discarded) : -1;
+			}
+		}
+
+		/** Align output on a byte boundary with an empty stored block */
+		void sync_flush(std::vector<uint8_t>& output)
+		{
+			write_bits(output, 0, 3);
+			align(output);
+			write_bits(output, 0x0000, 16);
+			write_bits(output, 0xFFFF, 16);
+			write_bytes(output);
+		}
+
+		void align(std::vector<uint8_t>& output)
+		{
+			if (bit_count % 8) write_bits(output, 0, 8 - bit_count % 8);
+			write_bytes(output);
+		}
+
+	private:
+		/** Literal if distance is 0 */
+		struct Symbol
+		{
+			uint16_t length_or_literal;
+			uint16_t distance;
+		};
+
+		static uint32_t hash(const uint8_t* data)
+		{
+			return (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16) * 2654435761u >> (32 - hash_bits);
+		}
+
+		/** Append count bits (at most 16) : bits are written to output 32 at a time */
+		void write_bits(std::vector<uint8_t>& output, const uint32_t value, const int count)
+		{
+			bit_buffer |= static_cast<uint64_t>(value) << bit_count;
+			bit_count += count;
+			if (bit_count < 32) return;
+
+			const uint8_t bytes[4] = { static_cast<uint8_t>(bit_buffer), static_cast<uint8_t>(bit_buffer >> 8), static_cast<uint8_t>(bit_buffer >> 16), static_cast<uint8_t>(bit_buffer >> 24) };
+			output.insert(output.end(), bytes, bytes + 4);
+			bit_buffer >>= 32;
+			bit_count -= 32;
+		}
+
+		/** Write the complete bytes of the bit buffer */
+		void write_bytes(std::vector<uint8_t>& output)
+		{
+			for (; bit_count >= 8; bit_count -= 8, bit_buffer >>= 8) output.push_back(static_cast<uint8_t>(bit_buffer));
+		}
+
+		/** Register window[index] in the hash chains */
+		void insert(const size_t index)
+		{
+			insert(index, hash(window.data() + index));
+		}
+
+		void insert(const size_t index, const uint32_t key)
+		{
+			const int64_t gap = head[key] >= 0 ? static_cast<int64_t>(index) - head[key] : 0;
+			previous[(window_start + static_cast<int64_t>(index)) & (window_size - 1)] = static_cast<uint16_t>(gap > 0 && gap <= window_size ? gap : 0);
+			head[key] = static_cast<int32_t>(index);
+		}
+
+		/** Find the longest match for window[index], longer than previous_length, and register it in the hash chains. Return 0 if there is no such match */
+		int search(const size_t index, int& distance, const int previous_length = 0)
+		{
+			const size_t available = window.size() - index;
+			if (available < static_cast<size_t>(min_match)) return 0;
+
+			const uint8_t* current = window.data() + index;
+			const int max_length = static_cast<int>(std::min<size_t>(available, max_match));
+			const int nice_length = std::min(settings.nice_length, max_length);
+			int best_length = std::max(previous_length, min_match - 1);
+			int chain = previous_length >= settings.good_length ? settings.max_chain >> 2 : settings.max_chain;
+			if (best_length >= max_length) return 0;
+
+			// Candidates are rejected on their first two bytes and the two bytes ending the best match (like zlib)
+			const auto load_pair = [](const uint8_t* data) { uint16_t pair; memcpy(&pair, data, 2); return pair; };
+			const uint16_t start_pair = load_pair(current);
+			uint16_t end_pair = load_pair(current + best_length - 1);
+
+			const auto current_index = static_cast<int64_t>(index);
+			const uint32_t key = hash(current);
+			int64_t next = -1;
+			for (int64_t candidate = head[key]; candidate >= 0 && current_index - candidate <= window_size && chain-- > 0; candidate = next)
+			{
+				if (candidate >= current_index) break;
+				const uint16_t gap = previous[(window_start + candidate) & (window_size - 1)];
+				next = gap ? candidate - gap : -1;
+				const uint8_t* match = window.data() + candidate;
+				if (load_pair(match + best_length - 1) != end_pair || load_pair(match) != start_pair) continue;
+
+				const int length = match_length(match, current, max_length);
+				if (length > best_length)
+				{
+					best_length = length;
+					distance = static_cast<int>(current_index - candidate);
+					if (length >= nice_length) break;
+					end_pair = load_pair(current + best_length - 1);
+				}
+			}
+			insert(index, key);
+			if (best_length <= previous_length || (settings.lazy && best_length == min_match && distance > too_far)) return 0;
+			return best_length >= min_match ? best_length : 0;
+		}
+
+		/** Register bytes (begin, end) of a match, that were not searched */
+		void insert_range(const size_t begin, const size_t end)
+		{
+			const size_t last = std::min(end, window.size() - (min_match - 1));
+			for (size_t k = begin; k < last; ++k) insert(k);
+		}
+
+		/** Turn pending bytes [position, end) into literals and matches */
+		void parse(const size_t end)
+		{
+			symbols.clear();
+			size_t i = position;
+			int length = 0;
+			int distance = 0;
+			bool searched = false; // the match of i was already found while evaluating the previous byte
+			while (i < end)
+			{
+				if (!searched) length = search(i, distance);
+				searched = false;
+
+				// Lazy evaluation : emit a literal if the next byte starts a longer match
+				if (length && settings.lazy && length < settings.max_lazy && i + 1 < end)
+				{
+					int next_distance = 0;
+					const int next_length = search(i + 1, next_distance, length);
+					if (next_length > length)
+					{
+						symbols.push_back({ window[i], 0 });
+						++i;
+						length = next_length;
+						distance = next_distance;
+						searched = true;
+						continue;
+					}
+					symbols.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+					insert_range(i + 2, i + length);
+					i += length;
+					continue;
+				}
+
+				if (length)
+				{
+					symbols.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+					// Fast levels skip the inner bytes of long matches
+					if (settings.lazy || length <= settings.max_lazy) insert_range(i + 1, i + length);
+					i += length;
+				}
+				else
+				{
+					symbols.push_back({ window[i], 0 });
+					++i;
+				}
+			}
+			position = i;
+		}
+
+		void write_cheapest_block(std::vector<uint8_t>& output, const size_t begin, const bool final)
+		{
+			std::array<uint32_t, 286> literal_frequencies{};
+			std::array<uint32_t, 30> distance_frequencies{};
+			uint64_t extra_bits = 0;
+			for (const auto& symbol : symbols)
+			{
+				if (!symbol.distance)
+				{
+					literal_frequencies[symbol.length_or_literal]++;
+					continue;
+				}
+				const int length_code = length_codes[symbol.length_or_literal];
+				const int distance_code = distance_codes[symbol.distance];
+				literal_frequencies[257 + length_code]++;
+				distance_frequencies[distance_code]++;
+				extra_bits += length_extra[length_code] + distance_extra[distance_code];
+			}
+			literal_frequencies[256] = 1;
+
+			const DynamicCodes dynamic(literal_frequencies, distance_frequencies);
+			uint64_t fixed_bits = extra_bits;
+			uint64_t dynamic_bits = extra_bits + dynamic.header_bits;
+			for (int i = 0; i < 286; ++i)
+			{
+				fixed_bits += static_cast<uint64_t>(literal_frequencies[i]) * fixed_lengths[i];
+				dynamic_bits += static_cast<uint64_t>(literal_frequencies[i]) * dynamic.literal_lengths[i];
+			}
+			for (int i = 0; i < 30; ++i)
+			{
+				fixed_bits += static_cast<uint64_t>(distance_frequencies[i]) * 5;
+				dynamic_bits += static_cast<uint64_t>(distance_frequencies[i]) * dynamic.distance_lengths[i];
+			}
+			const size_t size = position - begin;
+			const uint64_t stored_bits = (size + 5 * (size / 65535 + 1)) * 8 + 7;
+
+			if (stored_bits < fixed_bits && stored_bits < dynamic_bits) write_stored_blocks(output, begin, position, final);
+			else if (fixed_bits <= dynamic_bits) write_block(output, final, fixed_literal_codes.data(), fixed_lengths.data(), fixed_distance_codes.data(), fixed_lengths.data() + 288, nullptr);
+			else write_block(output, final, dynamic.literal_codes.data(), dynamic.literal_lengths.data(), dynamic.distance_codes.data(), dynamic.distance_lengths.data(), &dynamic);
+		}
+
+		/** Write symbols as a fixed (dynamic = null) or dynamic Huffman block */
+		void write_block(std::vector<uint8_t>& output, const bool final, const uint16_t* literal_codes, const uint8_t* literal_lengths, const uint16_t* distance_codes_table, const uint8_t* distance_lengths, const DynamicCodes* dynamic)
+		{
+			write_bits(output, final ? 1 : 0, 1);
+			write_bits(output, dynamic ? 2 : 1, 2);
+			if (dynamic)
+			{
+				write_bits(output, dynamic->literal_count - 257, 5);
+				write_bits(output, dynamic->distance_count - 1, 5);
+				write_bits(output, dynamic->length_code_count - 4, 4);
+				for (int i = 0; i < dynamic->length_code_count; ++i) write_bits(output, dynamic->length_code_lengths[DynamicCodes::length_code_order[i]], 3);
+				for (const auto& symbol : dynamic->length_symbols)
+				{
+					write_bits(output, dynamic->length_codes[symbol.symbol], dynamic->length_code_lengths[symbol.symbol]);
+					write_bits(output, symbol.extra, DynamicCodes::length_symbol_extra[symbol.symbol]);
+				}
+			}
+
+			for (const auto& symbol : symbols)
+			{
+				if (!symbol.distance)
+				{
+					write_bits(output, literal_codes[symbol.length_or_literal], literal_lengths[symbol.length_or_literal]);
+					continue;
+				}
+				const int length_code = length_codes[symbol.length_or_literal];
+				write_bits(output, literal_codes[257 + length_code], literal_lengths[257 + length_code]);
+				write_bits(output, symbol.length_or_literal - length_base[length_code], length_extra[length_code]);
+
+				const int distance_code = distance_codes[symbol.distance];
+				write_bits(output, distance_codes_table[distance_code], distance_lengths[distance_code]);
+				write_bits(output, symbol.distance - distance_base[distance_code], distance_extra[distance_code]);
+			}
+			write_bits(output, literal_codes[256], literal_lengths[256]);
+		}
+
+		void write_stored_blocks(std::vector<uint8_t>& output, const size_t begin, const size_t end, const bool final)
+		{
+			size_t offset = begin;
+			do
+			{
+				const size_t size = std::min<size_t>(end - offset, 65535);
+				const bool last = final && offset + size == end;
+				write_bits(output, last ? 1 : 0, 1);
+				write_bits(output, 0, 2);
+				align(output);
+				write_bits(output, static_cast<uint32_t>(size), 16);
+				write_bits(output, static_cast<uint32_t>(~size & 0xFFFF), 16);
+				write_bytes(output);
+				output.insert(output.end(), window.begin() + static_cast<ptrdiff_t>(offset), window.begin() + static_cast<ptrdiff_t>(offset + size));
+				offset += size;
+			} while (offset < end);
+		}
+
+		const int level;
+		const LevelSettings settings;
+
+		std::vector<uint8_t> window;  // history followed by pending input
+		int64_t window_start = 0;     // stream offset of window[0]
+		size_t position = 0;          // index of the first pending byte in window
+		std::vector<int32_t> head;     // last window index of each hash
+		std::vector<uint16_t> previous; // distance to the previous position of the same hash (0 : none), by stream offset modulo window_size
+		std::vector<Symbol> symbols;
+
+		uint64_t bit_buffer = 0;
+		int bit_count = 0;
+
+		std::array<uint16_t, 288> fixed_literal_codes{};
+		std::array<uint16_t, 32> fixed_distance_codes{};
+		std::array<uint8_t, 320> fixed_lengths{};
+	};
+
+	struct ZlibEncoder::Internal
+	{
+		Internal(const int level, const size_t in_chunk_size)
+			: compressor(level), chunk_size(in_chunk_size) {}
+
+		void write_header(std::vector<uint8_t>& output)
+		{
+			if (header_written) return;
+			header_written = true;
+			static constexpr uint8_t flags[4] = { 0x01, 0x5E, 0x9C, 0xDA };
+			const int level = compressor.get_level();
+			output.push_back(0x78);
+			output.push_back(flags[level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3]);
+		}
+
+		/**
+		 * Compress size pending bytes as independent chunks on every thread. Each chunk references the 32KB before it,
+		 * and ends with a sync flush so that chunks can simply be concatenated.
+		 */
+		void compress_chunks(const size_t size, const bool final, std::vector<uint8_t>& output)
+		{
+			const size_t chunk_count = std::max<size_t>(1, (size + chunk_size - 1) / chunk_size);
+			std::vector<std::vector<uint8_t>> compressed(chunk_count);
+			std::vector<uint32_t> checksums(chunk_count);
+			std::vector<size_t> sizes(chunk_count);
+
+			Executor::parallel_for(chunk_count, 1, [&](const size_t begin, const size_t end)
+			{
+				for (size_t c = begin; c < end; ++c)
+				{
+					const size_t chunk_begin = dictionary_size + c * chunk_size;
+					const size_t chunk_end = std::min(chunk_begin + chunk_size, dictionary_size + size);
+					const size_t history = std::min<size_t>(chunk_begin, window_size);
+					const bool last = final && c + 1 == chunk_count;
+
+					// The dictionary is hashed with the first bytes of the chunk following it
+					Compressor chunk(compressor.get_level());
+					const size_t first_size = std::min<size_t>(chunk_end - chunk_begin, max_match);
+					chunk.append(pending.data() + chunk_begin, first_size);
+					chunk.set_dictionary(pending.data() + chunk_begin - history, history);
+					chunk.write(pending.data() + chunk_begin + first_size, chunk_end - chunk_begin - first_size, compressed[c]);
+					chunk.compress(chunk.get_pending_size(), last, compressed[c]);
+					if (last) chunk.align(compressed[c]);
+					else chunk.sync_flush(compressed[c]);
+
+					sizes[c] = chunk_end - chunk_begin;
+					checksums[c] = adler32(pending.data() + chunk_begin, sizes[c]);
+				}
+			});
+
+			for (size_t c = 0; c < chunk_count; ++c)
+			{
+				output.insert(output.end(), compressed[c].begin(), compressed[c].end());
+				adler = adler32_combine(adler, checksums[c], sizes[c]);
+			}
+
+			// Only keep the history needed by the next chunks
+			const size_t processed = dictionary_size + size;
+			const size_t kept = std::min<size_t>(processed, window_size);
+			pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(processed - kept));
+			dictionary_size = kept;
+		}
+
+		Compressor compressor;
+		const size_t chunk_size;
+		bool header_written = false;
+		uint32_t adler = 1;
+
+		std::vector<uint8_t> pending; // history of the next chunk followed by input not compressed yet
+		size_t dictionary_size = 0;
+	};
+
+	ZlibEncoder::ZlibEncoder(const int level, const size_t chunk_size)
+		: internal(std::make_unique<Internal>(level, chunk_size)) {}
+
+	ZlibEncoder::~ZlibEncoder() = default;
+
+	void ZlibEncoder::write(const uint8_t* data, const size_t size, std::vector<uint8_t>& output)
+	{
+		internal->write_header(output);
+		if (internal->chunk_size)
+		{
+			internal->pending.insert(internal->pending.end(), data, data + size);
+			// Wait for a chunk per thread
+			const size_t batch_size = internal->chunk_size * Executor::get_thread_count();
+			while (internal->pending.size() - internal->dictionary_size >= batch_size) internal->compress_chunks(batch_size, false, output);
+			return;
+		}
+
+		internal->adler = adler32(data, size, internal->adler);
+		internal->compressor.write(data, size, output);
+	}
+
+	void ZlibEncoder::flush(std::vector<uint8_t>& output)
+	{
+		internal->write_header(output);
+		if (internal->chunk_size)
+		{
+			// Chunks already end on a byte boundary
+			if (internal->pending.size() > internal->dictionary_size) internal->compress_chunks(internal->pending.size() - internal->dictionary_size, false, output);
+			return;
+		}
+
+		if (internal->compressor.get_pending_size()) internal->compressor.compress(internal->compressor.get_pending_size(), false, output);
+		internal->compressor.sync_flush(output);
+	}
+
+	void ZlibEncoder::finish(std::vector<uint8_t>& output)
+	{
+		internal->write_header(output);
+		if (internal->chunk_size)
+		{
+			internal->compress_chunks(internal->pending.size() - internal->dictionary_size, true, output);
+		}
+		else
+		{
+			internal->compressor.compress(internal->compressor.get_pending_size(), true, output);
+			internal->compressor.align(output);
+		}
+		for (int shift = 24; shift >= 0; shift -= 8) output.push_back(static_cast<uint8_t>(internal->adler >> shift));
+	}
+
+	/*
+	 * Decoder
+	 */
+
+	struct ZlibDecoder::Internal
+	{
+		/** Lookup table indexed by the next max_length bits : symbol | code length << 16 */
+		struct HuffmanTable
+		{
+			std::vector<uint32_t> entries;
+			int max_length = 0;
+
+			bool build(const uint8_t* lengths, const int count)
+			{
+				max_length = 0;
+				for (int i = 0; i < count; ++i) max_length = std::max<int>(max_length, lengths[i]);
+				if (max_length == 0) max_length = 1;
+
+				std::vector<uint16_t> codes(count);
+				build_codes(lengths, count, codes.data());
+				entries.assign(static_cast<size_t>(1) << max_length, 0);
+				for (int i = 0; i < count; ++i)
+				{
+					if (!lengths[i]) continue;
+					for (uint32_t code = codes[i]; code < entries.size(); code += 1u << lengths[i]) entries[code] = static_cast<uint32_t>(i) | static_cast<uint32_t>(lengths[i]) << 16;
+				}
+				return true;
+			}
+		};
+
+		explicit Internal(std::function<size_t(uint8_t*, size_t)> in_read)
+			: read_input(std::move(in_read)), window(window_size) {}
+
+		bool refill(const int count)
+		{
+			while (bit_count < count)
+			{
+				if (input_position == input_size)
+				{
+					input_size = read_input(input.data(), input.size());
+					input_position = 0;
+					if (input_size == 0) return false;
+				}
+				bit_buffer |= static_cast<uint64_t>(input[input_position++]) << bit_count;
+				bit_count += 8;
+			}
+			return true;
+		}
+
+		bool read_bits(const int count, uint32_t& value)
+		{
+			if (!refill(count)) return false;
+			value = static_cast<uint32_t>(bit_buffer & ((1ull << count) - 1));
+			bit_buffer >>= count;
+			bit_count -= count;
+			return true;
+		}
+
+		bool decode(const HuffmanTable& table, uint32_t& symbol)
+		{
+			// The end of the stream can be closer than max_length bits
+			refill(table.max_length);
+			const uint32_t entry = table.entries[bit_buffer & ((1ull << table.max_length) - 1)];
+			const int length = static_cast<int>(entry >> 16);
+			if (length == 0 || length > bit_count) return false;
+			symbol = entry & 0xFFFF;
+			bit_buffer >>= length;
+			bit_count -= length;
+			return true;
+		}
+
+		bool read_dynamic_tables()
+		{
+			uint32_t literal_count, distance_count, code_length_count;
+			if (!read_bits(5, literal_count) || !read_bits(5, distance_count) || !read_bits(4, code_length_count)) return false;
+			literal_count += 257;
+			distance_count += 1;
+			code_length_count += 4;
+
+			static constexpr uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			uint8_t code_length_lengths[19] = {};
+			for (uint32_t i = 0; i < code_length_count; ++i)
+			{
+				uint32_t value;
+				if (!read_bits(3, value)) return false;
+				code_length_lengths[order[i]] = static_cast<uint8_t>(value);
+			}
+			HuffmanTable code_length_table;
+			code_length_table.build(code_length_lengths, 19);
+
+			uint8_t lengths[320] = {};
+			for (uint32_t i = 0; i < literal_count + distance_count;)
+			{
+				uint32_t symbol;
+				if (!decode(code_length_table, symbol)) return false;
+				if (symbol < 16)
+				{
+					lengths[i++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				uint32_t repeat;
+				uint8_t value = 0;
+				if (symbol == 16)
+				{
+					if (i == 0 || !read_bits(2, repeat)) return false;
+					value = lengths[i - 1];
+					repeat += 3;
+				}
+				else if (symbol == 17)
+				{
+					if (!read_bits(3, repeat)) return false;
+					repeat += 3;
+				}
+				else
+				{
+					if (!read_bits(7, repeat)) return false;
+					repeat += 11;
+				}
+				if (i + repeat > literal_count + distance_count) return false;
+				while (repeat--) lengths[i++] = value;
+			}
+			literal_table.build(lengths, static_cast<int>(literal_count));
+			distance_table.build(lengths + literal_count, static_cast<int>(distance_count));
+			return true;
+		}
+
+		bool start_block()
+		{
+			if (final_block) return false;
+			uint32_t final, type;
+			if (!read_bits(1, final) || !read_bits(2, type)) return false;
+			final_block = final != 0;
+
+			if (type == 0)
+			{
+				// Stored block : skip to the next byte boundary
+				bit_buffer >>= bit_count % 8;
+				bit_count -= bit_count % 8;
+				uint32_t length, inverted_length;
+				if (!read_bits(16, length) || !read_bits(16, inverted_length) || (length ^ 0xFFFF) != inverted_length) return false;
+				stored_remaining = length;
+				block_type = 0;
+			}
+			else if (type == 1)
+			{
+				static const auto lengths = fixed_code_lengths();
+				literal_table.build(lengths.data(), 288);
+				distance_table.build(lengths.data() + 288, 32);
+				block_type = 1;
+			}
+			else if (type == 2)
+			{
+				if (!read_dynamic_tables()) return false;
+				block_type = 2;
+			}
+			else return false;
+			return true;
+		}
+
+		void emit(const uint8_t value, uint8_t*& output)
+		{
+			window[window_position++ & (window_size - 1)] = value;
+			*output++ = value;
+		}
+
+		bool read(uint8_t* output, size_t size)
+		{
+			if (!header_read)
+			{
+				uint32_t cmf, flags;
+				if (!read_bits(8, cmf) || !read_bits(8, flags) || (cmf & 0x0F) != 8 || (cmf << 8 | flags) % 31 != 0 || flags & 0x20) return false;
+				header_read = true;
+			}
+
+			while (size)
+			{
+				if (copy_remaining)
+				{
+					const size_t count = std::min<size_t>(copy_remaining, size);
+					for (size_t i = 0; i < count; ++i) emit(window[(window_position - copy_distance) & (window_size - 1)], output);
+					copy_remaining -= static_cast<uint32_t>(count);
+					size -= count;
+					continue;
+				}
+
+				if (block_type < 0 && !start_block()) return false;
+
+				if (block_type == 0)
+				{
+					uint32_t value;
+					while (size && stored_remaining && read_bits(8, value))
+					{
+						emit(static_cast<uint8_t>(value), output);
+						--size;
+						--stored_remaining;
+					}
+					if (!stored_remaining) block_type = -1;
+					else if (size) return false;
+					continue;
+				}
+
+				uint32_t symbol;
+				if (!decode(literal_table, symbol)) return false;
+				if (symbol < 256)
+				{
+					emit(static_cast<uint8_t>(symbol), output);
+					--size;
+				}
+				else if (symbol == 256)
+				{
+					block_type = -1;
+				}
+				else
+				{
+					const uint32_t length_code = symbol - 257;
+					uint32_t length_bits, distance_code, distance_bits;
+					if (length_code >= 29 || !read_bits(length_extra[length_code], length_bits)) return false;
+					if (!decode(distance_table, distance_code) || distance_code >= 30 || !read_bits(distance_extra[distance_code], distance_bits)) return false;
+					copy_remaining = length_base[length_code] + length_bits;
+					copy_distance = distance_base[distance_code] + distance_bits;
+					if (copy_distance > window_position) return false;
+				}
+			}
+			return true;
+		}
+
+		std::function<size_t(uint8_t*, size_t)> read_input;
+		std::array<uint8_t, 65536> input{};
+		size_t input_size = 0;
+		size_t input_position = 0;
+		uint64_t bit_buffer = 0;
+		int bit_count = 0;
+
+		bool header_read = false;
+		bool final_block = false;
+		int block_type = -1;
+		uint32_t stored_remaining = 0;
+		uint32_t copy_remaining = 0;
+		uint32_t copy_distance = 0;
+
+		HuffmanTable literal_table;
+		HuffmanTable distance_table;
+		std::vector<uint8_t> window;
+		uint64_t window_position = 0;
+	};
+
+	ZlibDecoder::ZlibDecoder(std::function<size_t(uint8_t* buffer, size_t size)> read)
+		: internal(std::make_unique<Internal>(std::move(read))) {}
+
+	ZlibDecoder::~ZlibDecoder() = default;
+
+	bool ZlibDecoder::read(uint8_t* output, const size_t size)
+	{
+		return internal->read(output, size);
+	}
+}
@@ -0,0 +1,235 @@
+#include "Executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+namespace SuperPacker::Executor
+{
+	/** Range of tiles [begin, end) packed in 64 bits, so that owner and thieves can update it with a single CAS */
+	static uint64_t make_range(const uint32_t begin, const uint32_t end) { return static_cast<uint64_t>(end) << 32 | begin; }
+	static uint32_t range_begin(const uint64_t range) { return static_cast<uint32_t>(range); }
+	static uint32_t range_end(const uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+
+	struct Batch
+	{
+		Batch(const size_t in_count, const size_t in_tile_size, const size_t slot_count, const std::function<void(size_t, size_t)>& in_function)
+			: function(in_function), count(in_count), tile_size(in_tile_size), ranges(slot_count)
+		{
+			const size_t tile_count = (count + tile_size - 1) / tile_size;
+			remaining_tiles = tile_count;
+			for (size_t i = 0; i < slot_count; ++i)
+			{
+				ranges[i] = make_range(static_cast<uint32_t>(tile_count * i / slot_count), static_cast<uint32_t>(tile_count * (i + 1) / slot_count));
+			}
+		}
+
+		/** Take next tile from the front of our own range */
+		bool pop(const size_t slot, uint32_t& tile)
+		{
+			auto& range = ranges[slot];
+			uint64_t current = range.load();
+			while (range_begin(current) < range_end(current))
+			{
+				if (range.compare_exchange_weak(current, make_range(range_begin(current) + 1, range_end(current))))
+				{
+					tile = range_begin(current);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/** Take last tile from the end of another range */
+		bool steal(const size_t slot, uint32_t& tile)
+		{
+			auto& range = ranges[slot];
+			uint64_t current = range.load();
+			while (range_begin(current) < range_end(current))
+			{
+				if (range.compare_exchange_weak(current, make_range(range_begin(current), range_end(current) - 1)))
+				{
+					tile = range_end(current) - 1;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void run_tile(const uint32_t tile)
+		{
+			const size_t begin = tile * tile_size;
+			function(begin, std::min(begin + tile_size, count));
+			if (remaining_tiles.fetch_sub(1) == 1) remaining_tiles.notify_all();
+		}
+
+		/** Process own slot, then steal from the others until every range is empty */
+		void execute(const size_t slot)
+		{
+			uint32_t tile;
+			while (pop(slot, tile)) run_tile(tile);
+			for (size_t i = 1; i < ranges.size(); ++i)
+			{
+				const size_t victim = (slot + i) % ranges.size();
+				while (steal(victim, tile)) run_tile(tile);
+			}
+		}
+
+		[[nodiscard]] bool has_work() const
+		{
+			for (const auto& range : ranges)
+			{
+				const uint64_t current = range.load();
+				if (range_begin(current) < range_end(current)) return true;
+			}
+			return false;
+		}
+
+		const std::function<void(size_t, size_t)>& function;
+		const size_t count;
+		const size_t tile_size;
+		std::vector<std::atomic<uint64_t>> ranges;
+		std::atomic<size_t> remaining_tiles;
+	};
+
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(const size_t thread_count)
+		{
+			for (size_t i = 1; i < thread_count; ++i) workers.emplace_back(&ThreadPool::worker_loop, this, static_cast<uint8_t>(i - 1));
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(batch_lock);
+				stop = true;
+			}
+			batch_condition.notify_all();
+			for (auto& worker : workers) worker.join();
+		}
+
+		[[nodiscard]] size_t get_thread_count() const { return workers.size() + 1; }
+
+		void run(const std::shared_ptr<Batch>& batch)
+		{
+			{
+				std::lock_guard<std::mutex> lock(batch_lock);
+				batches.push_back(batch);
+			}
+			batch_condition.notify_all();
+
+			batch->execute(0);
+
+			// Wait for tiles still running on other workers
+			size_t remaining;
+			while ((remaining = batch->remaining_tiles.load()) != 0) batch->remaining_tiles.wait(remaining);
+
+			std::lock_guard<std::mutex> lock(batch_lock);
+			batches.erase(std::ranges::find(batches, batch));
+		}
+
+	private:
+
+		void worker_loop(const uint8_t worker_id)
+		{
+			current_worker_id = worker_id;
+			while (true)
+			{
+				std::shared_ptr<Batch> batch;
+				{
+					std::unique_lock<std::mutex> lock(batch_lock);
+					batch_condition.wait(lock, [&]
+					{
+						if (stop) return true;
+						const auto it = std::ranges::find_if(batches, [](const auto& item) { return item->has_work(); });
+						if (it != batches.end()) batch = *it;
+						return batch != nullptr;
+					});
+					if (stop) return;
+				}
+				batch->execute((worker_id + 1) % batch->ranges.size());
+			}
+		}
+
+		std::vector<std::thread> workers;
+		std::vector<std::shared_ptr<Batch>> batches;
+		std::mutex batch_lock;
+		std::condition_variable batch_condition;
+		bool stop = false;
+
+	public:
+		static thread_local uint8_t current_worker_id;
+	};
+
+	thread_local uint8_t ThreadPool::current_worker_id = 255;
+
+	static std::mutex pool_lock;
+	static std::shared_ptr<ThreadPool> pool;
+
+	static std::shared_ptr<ThreadPool> get_pool()
+	{
+		std::lock_guard<std::mutex> lock(pool_lock);
+		if (!pool)
+		{
+			const size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+			pool = std::make_shared<ThreadPool>(thread_count);
+			logger::set_get_worker_func(&get_worker_id);
+		}
+		return pool;
+	}
+
+	void set_thread_count(size_t thread_count)
+	{
+		if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+		thread_count = std::min<size_t>(thread_count, 255);
+
+		std::lock_guard<std::mutex> lock(pool_lock);
+		if (pool && pool->get_thread_count() == thread_count) return;
+		// Loops still running on the previous pool keep it alive until they complete
+		pool = std::make_shared<ThreadPool>(thread_count);
+		logger::set_get_worker_func(&get_worker_id);
+	}
+
+	size_t get_thread_count()
+	{
+		return get_pool()->get_thread_count();
+	}
+
+	uint8_t get_worker_id()
+	{
+		return ThreadPool::current_worker_id;
+	}
+
+	void parallel_for(const size_t count, size_t tile_size, const std::function<void(size_t begin, size_t end)>& function)
+	{
+		if (count == 0) return;
+		tile_size = std::max<size_t>(tile_size, 1);
+
+		const auto thread_pool = get_pool();
+		if (thread_pool->get_thread_count() == 1 || count <= tile_size)
+		{
+			function(0, count);
+			return;
+		}
+
+		thread_pool->run(std::make_shared<Batch>(count, tile_size, thread_pool->get_thread_count(), function));
+	}
+
+	void parallel_for_rows(const int height, const size_t row_bytes, const std::function<void(int y_begin, int y_end)>& function)
+	{
+		if (height <= 0) return;
+		const size_t band_rows = std::max<size_t>(1, (64 * 1024) / std::max<size_t>(row_bytes, 1));
+		parallel_for(static_cast<size_t>(height), band_rows, [&](const size_t begin, const size_t end)
+		{
+			function(static_cast<int>(begin), static_cast<int>(end));
+		});
+	}
+}
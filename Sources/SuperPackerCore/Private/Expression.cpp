@@ -0,0 +1,304 @@
+#include "Expression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define EXPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace SuperPacker
+{
+	/** Registers are resolved through a fixed table on evaluation */
+	static constexpr int max_registers = 64;
+
+	/** Result of a sub expression : a constant (folded at compile time) or a register */
+	struct Operand
+	{
+		bool constant = true;
+		float value = 0;
+		uint16_t reg = 0;
+	};
+
+	/** Recursive descent parser emitting the instructions of an expression while parsing */
+	class ExpressionParser
+	{
+	public:
+		ExpressionParser(Expression& in_expression, const std::vector<std::string>& in_variables)
+			: expression(in_expression), variables(in_variables) {}
+
+		bool parse(std::string& error)
+		{
+			expression.variable_count = static_cast<int>(variables.size());
+			expression.register_count = expression.variable_count;
+
+			const Operand result = parse_sum();
+			if (failed.empty() && position != text().size()) fail("unexpected '" + text().substr(position, 1) + "'");
+			if (failed.empty()) expression.result = materialize(result);
+			if (failed.empty() && expression.register_count > max_registers) fail("expression is too complex");
+
+			error = failed;
+			return failed.empty();
+		}
+
+		typedef Expression::Operation Operation;
+
+		/** Scalar evaluation of an operation, for constant folding and remaining samples */
+		static float fold(const Operation operation, const float a, const float b, const float c)
+		{
+			switch (operation)
+			{
+			case Operation::Add: return a + b;
+			case Operation::Subtract: return a - b;
+			case Operation::Multiply: return a * b;
+			case Operation::Divide: return a / b;
+			case Operation::Min: return std::min(a, b);
+			case Operation::Max: return std::max(a, b);
+			case Operation::Abs: return std::abs(a);
+			case Operation::Lerp: return a + (b - a) * c;
+			case Operation::Threshold: return a >= b ? 1.f : 0.f;
+			}
+			return 0;
+		}
+
+	private:
+		const std::string& text() const { return expression.text; }
+
+		void fail(const std::string& message)
+		{
+			if (failed.empty()) failed = message + " (at " + std::to_string(position + 1) + ")";
+		}
+
+		void skip_spaces()
+		{
+			while (position < text().size() && std::isspace(static_cast<unsigned char>(text()[position]))) ++position;
+		}
+
+		bool accept(const char character)
+		{
+			skip_spaces();
+			if (position >= text().size() || text()[position] != character) return false;
+			++position;
+			return true;
+		}
+
+		void expect(const char character)
+		{
+			if (!accept(character)) fail(std::string("expected '") + character + "'");
+		}
+
+		/** Register holding operand. Constants get their own register, shared by identical values */
+		uint16_t materialize(const Operand& operand)
+		{
+			if (!operand.constant) return operand.reg;
+			for (const auto& constant : expression.constants)
+				if (constant.value == operand.value) return constant.output;
+			const auto reg = static_cast<uint16_t>(expression.register_count++);
+			expression.constants.push_back({ reg, operand.value });
+			return reg;
+		}
+
+		Operand emit(const Operation operation, const Operand& a, const Operand& b = {}, const Operand& c = {})
+		{
+			if (a.constant && b.constant && c.constant) return { true, fold(operation, a.value, b.value, c.value) };
+
+			// Identities of scale / bias with constants
+			if (operation == Operation::Multiply && ((a.constant && a.value == 1) || (b.constant && b.value == 1))) return a.constant ? b : a;
+			if ((operation == Operation::Add || operation == Operation::Subtract) && b.constant && b.value == 0) return a;
+			if (operation == Operation::Add && a.constant && a.value == 0) return b;
+
+			// Unused inputs point to the first one
+			const uint16_t first = materialize(a);
+			const uint16_t second = operation == Operation::Abs ? first : materialize(b);
+			const uint16_t third = operation == Operation::Lerp ? materialize(c) : first;
+			const uint16_t inputs[3] = { first, second, third };
+			const auto output = static_cast<uint16_t>(expression.register_count++);
+			expression.instructions.push_back({ operation, output, { inputs[0], inputs[1], inputs[2] } });
+			return { false, 0, output };
+		}
+
+		std::vector<Operand> parse_arguments(const std::string& name, const size_t count)
+		{
+			std::vector<Operand> arguments;
+			expect('(');
+			if (!accept(')'))
+			{
+				do arguments.push_back(parse_sum());
+				while (failed.empty() && accept(','));
+				expect(')');
+			}
+			if (failed.empty() && arguments.size() != count) fail(name + " expects " + std::to_string(count) + " argument(s)");
+			arguments.resize(count);
+			return arguments;
+		}
+
+		Operand parse_call(const std::string& name)
+		{
+			const auto argument_count = [&]() -> size_t
+			{
+				if (name == "saturate" || name == "abs" || name == "invert") return 1;
+				if (name == "min" || name == "max" || name == "threshold") return 2;
+				if (name == "clamp" || name == "lerp") return 3;
+				if (name == "remap") return 5;
+				return 0;
+			}();
+			if (argument_count == 0)
+			{
+				fail("unknown function " + name);
+				return {};
+			}
+
+			const auto args = parse_arguments(name, argument_count);
+			if (name == "saturate") return emit(Operation::Min, emit(Operation::Max, args[0], { true, 0 }), { true, 1 });
+			if (name == "abs") return emit(Operation::Abs, args[0]);
+			if (name == "invert") return emit(Operation::Subtract, { true, 1 }, args[0]);
+			if (name == "min") return emit(Operation::Min, args[0], args[1]);
+			if (name == "max") return emit(Operation::Max, args[0], args[1]);
+			if (name == "threshold") return emit(Operation::Threshold, args[0], args[1]);
+			if (name == "clamp") return emit(Operation::Min, emit(Operation::Max, args[0], args[1]), args[2]);
+			if (name == "lerp") return emit(Operation::Lerp, args[0], args[1], args[2]);
+
+			// remap : out_low + (x - in_low) * (out_high - out_low) / (in_high - in_low)
+			const Operand scale = emit(Operation::Divide, emit(Operation::Subtract, args[4], args[3]), emit(Operation::Subtract, args[2], args[1]));
+			return emit(Operation::Add, emit(Operation::Multiply, emit(Operation::Subtract, args[0], args[1]), scale), args[3]);
+		}
+
+		Operand parse_primary()
+		{
+			skip_spaces();
+			if (position >= text().size())
+			{
+				fail("unexpected end of expression");
+				return {};
+			}
+
+			const char character = text()[position];
+			if (accept('('))
+			{
+				const Operand operand = parse_sum();
+				expect(')');
+				return operand;
+			}
+
+			if (std::isdigit(static_cast<unsigned char>(character)) || character == '.')
+			{
+				char* end = nullptr;
+				const float value = std::strtof(text().c_str() + position, &end);
+				position = end - text().c_str();
+				return { true, value };
+			}
+
+			if (std::isalpha(static_cast<unsigned char>(character)) || character == '_')
+			{
+				const size_t begin = position;
+				while (position < text().size() && (std::isalnum(static_cast<unsigned char>(text()[position])) || text()[position] == '_')) ++position;
+				const std::string name = text().substr(begin, position - begin);
+
+				skip_spaces();
+				if (position < text().size() && text()[position] == '(') return parse_call(name);
+
+				const auto variable = std::ranges::find(variables, name);
+				if (variable == variables.end())
+				{
+					position = begin;
+					fail("unknown variable " + name);
+					return {};
+				}
+				const auto index = static_cast<uint16_t>(variable - variables.begin());
+				if (index < 32) expression.variable_mask |= 1u << index;
+				return { false, 0, index };
+			}
+
+			fail(std::string("unexpected '") + character + "'");
+			return {};
+		}
+
+		Operand parse_unary()
+		{
+			if (accept('-')) return emit(Operation::Subtract, { true, 0 }, parse_unary());
+			if (accept('+')) return parse_unary();
+			return parse_primary();
+		}
+
+		Operand parse_product()
+		{
+			Operand operand = parse_unary();
+			while (failed.empty())
+			{
+				if (accept('*')) operand = emit(Operation::Multiply, operand, parse_unary());
+				else if (accept('/')) operand = emit(Operation::Divide, operand, parse_unary());
+				else break;
+			}
+			return operand;
+		}
+
+		Operand parse_sum()
+		{
+			Operand operand = parse_product();
+			while (failed.empty())
+			{
+				if (accept('+')) operand = emit(Operation::Add, operand, parse_product());
+				else if (accept('-')) operand = emit(Operation::Subtract, operand, parse_product());
+				else break;
+			}
+			return operand;
+		}
+
+		Expression& expression;
+		const std::vector<std::string>& variables;
+		size_t position = 0;
+		std::string failed;
+	};
+
+	std::shared_ptr<const Expression> Expression::compile(const std::string& text, const std::vector<std::string>& variables, std::string& error)
+	{
+		std::shared_ptr<Expression> expression(new Expression());
+		expression->text = text;
+		if (!ExpressionParser(*expression, variables).parse(error)) return nullptr;
+		return expression;
+	}
+
+	const float* Expression::evaluate(const float* const* variables, float* scratch, const size_t count) const
+	{
+		float* registers[max_registers];
+		for (int r = 0; r < register_count; ++r) registers[r] = r < variable_count ? const_cast<float*>(variables[r]) : scratch + static_cast<size_t>(r - variable_count) * max_batch;
+
+		for (const auto& constant : constants) std::fill_n(registers[constant.output], count, constant.value);
+
+		for (const auto& instruction : instructions)
+		{
+			float* output = registers[instruction.output];
+			const float* a = registers[instruction.inputs[0]];
+			const float* b = registers[instruction.inputs[1]];
+			const float* c = registers[instruction.inputs[2]];
+
+			size_t i = 0;
+#if EXPRESSION_SSE2
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x = _mm_loadu_ps(a + i);
+				__m128 value;
+				switch (instruction.operation)
+				{
+				case Operation::Add: value = _mm_add_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Subtract: value = _mm_sub_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Multiply: value = _mm_mul_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Divide: value = _mm_div_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Min: value = _mm_min_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Max: value = _mm_max_ps(x, _mm_loadu_ps(b + i)); break;
+				case Operation::Abs: value = _mm_andnot_ps(_mm_set1_ps(-0.f), x); break;
+				case Operation::Lerp: value = _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), x), _mm_loadu_ps(c + i))); break;
+				case Operation::Threshold: value = _mm_and_ps(_mm_cmpge_ps(x, _mm_loadu_ps(b + i)), _mm_set1_ps(1.f)); break;
+				default: value = x; break;
+				}
+				_mm_storeu_ps(output + i, value);
+			}
+#endif
+			for (; i < count; ++i) output[i] = ExpressionParser::fold(instruction.operation, a[i], b[i], c[i]);
+		}
+		return registers[result];
+	}
+}
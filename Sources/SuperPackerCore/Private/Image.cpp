@@ -0,0 +1,77 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Image.h"
+#include "RawImage.h"
+
+namespace SuperPacker
+{
+	const stbi_io_callbacks StbFileReader::callbacks = { &StbFileReader::read, &StbFileReader::skip, &StbFileReader::eof };
+
+	int StbFileReader::read(void* user, char* data, const int size)
+	{
+		auto* reader = static_cast<StbFileReader*>(user);
+		if (reader->progress && reader->progress->cancelled) return 0;
+
+		const size_t count = std::min(static_cast<size_t>(size), reader->file.get_size() - reader->position);
+		memcpy(data, reader->file.get_data() + reader->position, count);
+		reader->position += count;
+		// Keep the last 10% for conversion once the file is decoded
+		if (reader->progress) reader->progress->progress.store(0.9f * static_cast<float>(reader->position) / static_cast<float>(reader->file.get_size()), std::memory_order_relaxed);
+		return static_cast<int>(count);
+	}
+
+	void StbFileReader::skip(void* user, const int n)
+	{
+		auto* reader = static_cast<StbFileReader*>(user);
+		reader->position = std::clamp<ptrdiff_t>(static_cast<ptrdiff_t>(reader->position) + n, 0, static_cast<ptrdiff_t>(reader->file.get_size()));
+	}
+
+	int StbFileReader::eof(void* user)
+	{
+		auto* reader = static_cast<StbFileReader*>(user);
+		return reader->position >= reader->file.get_size() || (reader->progress && reader->progress->cancelled);
+	}
+
+	bool map_raw_channels(const MappedFile& file, const std::filesystem::path& path, TChannelView<uint8_t> (&views)[4], int& width, int& height, int& channels)
+	{
+		const auto layout = parse_raw_image_header(file.get_data(), file.get_size(), path);
+		if (!layout || layout->rle || layout->data_offset + static_cast<uint64_t>(layout->row_size) * layout->height > file.get_size()) return false;
+
+		// Bottom-up files are referenced from their last row with a negative row stride
+		const auto row_size = static_cast<ptrdiff_t>(layout->row_size);
+		const uint8_t* first_row = file.get_data() + layout->data_offset + (layout->top_down ? 0 : (layout->height - 1) * row_size);
+		const ptrdiff_t row_stride = layout->top_down ? row_size : -row_size;
+
+		// Byte offset of red, green, blue and alpha in each pixel (-1 = missing)
+		static constexpr int offsets[4][4] = { { 0, 0, 0, -1 }, { 0, 0, 0, 1 }, { 2, 1, 0, -1 }, { 2, 1, 0, 3 } };
+		const int pixel_size = layout->get_pixel_size();
+		for (int c = 0; c < 4; ++c)
+		{
+			const int offset = offsets[pixel_size - 1][c];
+			views[c] = offset < 0 ? TChannelView<uint8_t>{} : TChannelView<uint8_t>{ first_row + offset, pixel_size, row_stride, layout->width, layout->height };
+		}
+
+		width = layout->width;
+		height = layout->height;
+		channels = pixel_size;
+		return true;
+	}
+
+	std::shared_ptr<IImage> load_image(const std::filesystem::path& path, LoadProgress* progress)
+	{
+		const auto file = MappedFile::open(path);
+
+		// Only the header is read to find the sample type
+		const int header_size = file ? static_cast<int>(std::min<size_t>(file->get_size(), std::numeric_limits<int>::max())) : 0;
+		const bool is_hdr = file && stbi_is_hdr_from_memory(file->get_data(), header_size);
+		const bool is_16_bit = file && !is_hdr && stbi_is_16_bit_from_memory(file->get_data(), header_size);
+
+		if (is_hdr) return std::make_shared<HdrImage>(file, path, progress);
+		if (is_16_bit) return std::make_shared<Image16>(file, path, progress);
+		return std::make_shared<Image>(file, path, progress);
+	}
+}
@@ -0,0 +1,153 @@
+#include "ImageCache.h"
+
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Logger.h"
+#include "Trace.h"
+
+namespace SuperPacker::ImageCache
+{
+	struct CacheEntry
+	{
+		std::shared_future<std::shared_ptr<const IImage>> image;
+		std::filesystem::path path;
+		size_t memory_size = 0;
+		std::list<std::string>::iterator lru_position;
+		uint64_t generation = 0; // identifies the load that owns the entry
+	};
+
+	static std::mutex cache_lock;
+	static std::unordered_map<std::string, CacheEntry> entries;
+	static std::unordered_map<std::string, std::string> path_keys; // canonical path -> current key
+	static std::list<std::string> lru_keys; // most recently used first
+	static size_t memory_budget = 1024ull * 1024 * 1024;
+	static Statistics statistics;
+	static uint64_t next_generation = 0;
+
+	static void erase_entry(const std::string& key)
+	{
+		const auto entry = entries.find(key);
+		if (entry == entries.end()) return;
+		statistics.memory_size -= entry->second.memory_size;
+		lru_keys.erase(entry->second.lru_position);
+		entries.erase(entry);
+	}
+
+	/** Release least recently used images until the budget is respected (the most recent one is always kept) */
+	static void evict()
+	{
+		while (statistics.memory_size > memory_budget && lru_keys.size() > 1)
+		{
+			const std::string key = lru_keys.back();
+			const auto& entry = entries[key];
+			if (entry.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) break;
+			if (path_keys[entry.path.string()] == key) path_keys.erase(entry.path.string());
+			erase_entry(key);
+			statistics.evictions++;
+		}
+	}
+
+	std::shared_ptr<const IImage> load(const std::filesystem::path& path, LoadProgress* progress)
+	{
+		trace_zone("load image");
+		std::error_code error;
+		auto canonical_path = std::filesystem::canonical(path, error);
+		if (error) canonical_path = path;
+		const auto file_size = std::filesystem::file_size(canonical_path, error);
+		const auto write_time = std::filesystem::last_write_time(canonical_path, error);
+		const std::string key = canonical_path.string() + '|' + std::to_string(file_size) + '|' + std::to_string(write_time.time_since_epoch().count());
+
+		std::promise<std::shared_ptr<const IImage>> promise;
+		uint64_t generation;
+		{
+			std::unique_lock<std::mutex> lock(cache_lock);
+			for (auto entry = entries.find(key); entry != entries.end(); entry = entries.find(key))
+			{
+				lru_keys.splice(lru_keys.begin(), lru_keys, entry->second.lru_position);
+
+				// Wait if the image is still being decoded by another thread
+				const auto cached_image = entry->second.image;
+				const uint64_t cached_generation = entry->second.generation;
+				lock.unlock();
+				auto image = cached_image.get();
+				lock.lock();
+				if (image)
+				{
+					statistics.hits++;
+					lock.unlock();
+					if (progress) progress->progress = 1.f;
+					return image;
+				}
+
+				// The other load failed or was cancelled : wait for a retry started meanwhile, or decode again (counted as a miss)
+				const auto retry = entries.find(key);
+				if (retry == entries.end() || retry->second.generation == cached_generation) break;
+			}
+			statistics.misses++;
+
+			// The file changed on disk : forget the previous version
+			if (const auto previous = path_keys.find(canonical_path.string()); previous != path_keys.end() && previous->second != key) erase_entry(previous->second);
+			path_keys[canonical_path.string()] = key;
+
+			erase_entry(key);
+			generation = ++next_generation;
+			lru_keys.push_front(key);
+			auto& entry = entries[key];
+			entry.image = promise.get_future().share();
+			entry.path = canonical_path;
+			entry.lru_position = lru_keys.begin();
+			entry.generation = generation;
+			statistics.image_count = entries.size();
+		}
+
+		std::shared_ptr<const IImage> image = load_image(canonical_path, progress);
+		if (!image->is_valid()) image = nullptr;
+		promise.set_value(image);
+
+		std::lock_guard<std::mutex> lock(cache_lock);
+		if (const auto entry = entries.find(key); entry != entries.end() && entry->second.generation == generation)
+		{
+			if (image)
+			{
+				entry->second.memory_size = image->get_memory_size();
+				statistics.memory_size += entry->second.memory_size;
+				evict();
+			}
+			else
+			{
+				// Failed or cancelled loads are not cached
+				erase_entry(key);
+			}
+		}
+		statistics.image_count = entries.size();
+		return image;
+	}
+
+	void set_memory_budget(const size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(cache_lock);
+		memory_budget = bytes;
+		evict();
+		statistics.image_count = entries.size();
+	}
+
+	Statistics get_statistics()
+	{
+		std::lock_guard<std::mutex> lock(cache_lock);
+		return statistics;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(cache_lock);
+		entries.clear();
+		path_keys.clear();
+		lru_keys.clear();
+		statistics.memory_size = 0;
+		statistics.image_count = 0;
+	}
+}
@@ -0,0 +1,739 @@
+#include "ImageKernels.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define KERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define KERNELS_AVX2 1
+#define KERNELS_SSSE3 1
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#define KERNELS_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace SuperPacker::Kernels
+{
+	/*
+	 * Scalar fallback (also used for the remaining pixels of vectorized kernels)
+	 */
+
+	template <typename Type, int Channels>
+	static void deinterleave_scalar(const Type* source, Type* const* planes, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			for (int c = 0; c < Channels; ++c)
+				planes[c][i] = source[i * Channels + c];
+	}
+
+	template <typename Type, int Channels>
+	static void interleave_scalar(const Type* const* planes, Type* destination, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			for (int c = 0; c < Channels; ++c)
+				destination[i * Channels + c] = planes[c][i];
+	}
+
+	/*
+	 * Vectorized kernels : each one returns the number of processed pixels
+	 */
+
+	template <typename Type, int Channels>
+	static size_t deinterleave_simd(const Type*, Type* const*, size_t) { return 0; }
+
+	template <typename Type, int Channels>
+	static size_t interleave_simd(const Type* const*, Type*, size_t) { return 0; }
+
+#if KERNELS_SSE2
+
+	template <>
+	size_t deinterleave_simd<uint8_t, 2>(const uint8_t* source, uint8_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+#if KERNELS_AVX2
+		const __m256i mask_256 = _mm256_set1_epi16(0x00FF);
+		for (; i + 32 <= pixel_count; i += 32)
+		{
+			const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 2));
+			const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 2 + 32));
+			const __m256i c0 = _mm256_packus_epi16(_mm256_and_si256(v0, mask_256), _mm256_and_si256(v1, mask_256));
+			const __m256i c1 = _mm256_packus_epi16(_mm256_srli_epi16(v0, 8), _mm256_srli_epi16(v1, 8));
+			// packus works in 128 bits lanes : restore pixel order
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(planes[0] + i), _mm256_permute4x64_epi64(c0, 0xD8));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(planes[1] + i), _mm256_permute4x64_epi64(c1, 0xD8));
+		}
+#endif
+		const __m128i mask = _mm_set1_epi16(0x00FF);
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2 + 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), _mm_packus_epi16(_mm_and_si128(v0, mask), _mm_and_si128(v1, mask)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8)));
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint8_t, 2>(const uint8_t* const* planes, uint8_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+#if KERNELS_AVX2
+		for (; i + 32 <= pixel_count; i += 32)
+		{
+			const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[0] + i));
+			const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[1] + i));
+			const __m256i lo = _mm256_unpacklo_epi8(c0, c1);
+			const __m256i hi = _mm256_unpackhi_epi8(c0, c1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 2 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+#endif
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2), _mm_unpacklo_epi8(c0, c1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2 + 16), _mm_unpackhi_epi8(c0, c1));
+		}
+		return i;
+	}
+
+#if KERNELS_SSSE3
+	/** Byte shuffle masks between 16 / Bytes RGB pixels (3 registers) and 16 / Bytes values of each plane */
+	template <int Bytes>
+	struct RgbShuffleMasks
+	{
+		RgbShuffleMasks()
+		{
+			for (int reg = 0; reg < 3; ++reg)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					uint8_t split_mask[16];
+					uint8_t merge_mask[16];
+					for (int byte = 0; byte < 16; ++byte)
+					{
+						// plane c value -> interleaved value (value * 3 + c)
+						const int interleaved = (byte / Bytes * 3 + c) * Bytes + byte % Bytes;
+						split_mask[byte] = interleaved / 16 == reg ? static_cast<uint8_t>(interleaved % 16) : 0x80;
+						// interleaved value (reg * 16 + byte) -> plane value
+						const int index = (reg * 16 + byte) / Bytes;
+						merge_mask[byte] = index % 3 == c ? static_cast<uint8_t>(index / 3 * Bytes + byte % Bytes) : 0x80;
+					}
+					split[reg][c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(split_mask));
+					merge[reg][c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(merge_mask));
+				}
+			}
+		}
+
+		__m128i split[3][3];
+		__m128i merge[3][3];
+	};
+
+	static const RgbShuffleMasks<1> rgb8_masks;
+	static const RgbShuffleMasks<2> rgb16_masks;
+
+	template <>
+	size_t deinterleave_simd<uint8_t, 3>(const uint8_t* source, uint8_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i v[3] = {
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 16)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 32))
+			};
+			for (int c = 0; c < 3; ++c)
+			{
+				const __m128i plane = _mm_or_si128(_mm_or_si128(
+					_mm_shuffle_epi8(v[0], rgb8_masks.split[0][c]),
+					_mm_shuffle_epi8(v[1], rgb8_masks.split[1][c])),
+					_mm_shuffle_epi8(v[2], rgb8_masks.split[2][c]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[c] + i), plane);
+			}
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint8_t, 3>(const uint8_t* const* planes, uint8_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i p[3] = {
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i))
+			};
+			for (int reg = 0; reg < 3; ++reg)
+			{
+				const __m128i pixels = _mm_or_si128(_mm_or_si128(
+					_mm_shuffle_epi8(p[0], rgb8_masks.merge[reg][0]),
+					_mm_shuffle_epi8(p[1], rgb8_masks.merge[reg][1])),
+					_mm_shuffle_epi8(p[2], rgb8_masks.merge[reg][2]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 3 + reg * 16), pixels);
+			}
+		}
+		return i;
+	}
+#else
+	/** Join 4 registers of 12 packed bytes (and 4 zero bytes) into 3 full registers */
+	static void store_packed_rgb(uint8_t* destination, const __m128i c0, const __m128i c1, const __m128i c2, const __m128i c3)
+	{
+		__m128i* output = reinterpret_cast<__m128i*>(destination);
+		_mm_storeu_si128(output, _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+		_mm_storeu_si128(output + 1, _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+		_mm_storeu_si128(output + 2, _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+	}
+
+	template <>
+	size_t deinterleave_simd<uint8_t, 3>(const uint8_t* source, uint8_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 32));
+			// Without byte shuffles : each round interleaves the three registers, the fourth one leaves every plane in its own register
+			for (int round = 0; round < 4; ++round)
+			{
+				const __m128i next_a = _mm_unpacklo_epi8(a, _mm_unpackhi_epi64(b, b));
+				const __m128i next_b = _mm_unpacklo_epi8(_mm_unpackhi_epi64(a, a), c);
+				const __m128i next_c = _mm_unpacklo_epi8(b, _mm_unpackhi_epi64(c, c));
+				a = next_a;
+				b = next_b;
+				c = next_c;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), b);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[2] + i), c);
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint8_t, 3>(const uint8_t* const* planes, uint8_t* destination, size_t pixel_count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i pixel_masks[4] = { _mm_setr_epi32(0xFFFFFF, 0, 0, 0), _mm_setr_epi32(0, 0xFFFFFF, 0, 0), _mm_setr_epi32(0, 0, 0xFFFFFF, 0), _mm_setr_epi32(0, 0, 0, 0xFFFFFF) };
+		// rgb0 pixels -> 12 packed bytes
+		const auto pack = [&](const __m128i pixels)
+		{
+			return _mm_or_si128(_mm_or_si128(_mm_and_si128(pixels, pixel_masks[0]), _mm_srli_si128(_mm_and_si128(pixels, pixel_masks[1]), 1)),
+				_mm_or_si128(_mm_srli_si128(_mm_and_si128(pixels, pixel_masks[2]), 2), _mm_srli_si128(_mm_and_si128(pixels, pixel_masks[3]), 3)));
+		};
+
+		size_t i = 0;
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+			const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+			const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+			const __m128i b0_lo = _mm_unpacklo_epi8(b, zero);
+			const __m128i b0_hi = _mm_unpackhi_epi8(b, zero);
+			store_packed_rgb(destination + i * 3,
+				pack(_mm_unpacklo_epi16(rg_lo, b0_lo)), pack(_mm_unpackhi_epi16(rg_lo, b0_lo)),
+				pack(_mm_unpacklo_epi16(rg_hi, b0_hi)), pack(_mm_unpackhi_epi16(rg_hi, b0_hi)));
+		}
+		return i;
+	}
+#endif
+
+	template <>
+	size_t deinterleave_simd<uint8_t, 4>(const uint8_t* source, uint8_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+#if KERNELS_AVX2
+		const __m256i mask_256 = _mm256_set1_epi32(0xFF);
+		// packs work in 128 bits lanes : restore the order of the 4 pixels groups
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		for (; i + 32 <= pixel_count; i += 32)
+		{
+			__m256i v[4];
+			for (int k = 0; k < 4; ++k) v[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4 + k * 32));
+			for (int c = 0; c < 4; ++c)
+			{
+				const __m256i p0 = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(v[0], c * 8), mask_256), _mm256_and_si256(_mm256_srli_epi32(v[1], c * 8), mask_256));
+				const __m256i p1 = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(v[2], c * 8), mask_256), _mm256_and_si256(_mm256_srli_epi32(v[3], c * 8), mask_256));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(planes[c] + i), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(p0, p1), order));
+			}
+		}
+#endif
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			__m128i v[4];
+			for (int k = 0; k < 4; ++k) v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4 + k * 16));
+			for (int c = 0; c < 4; ++c)
+			{
+				const __m128i p0 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[0], c * 8), mask), _mm_and_si128(_mm_srli_epi32(v[1], c * 8), mask));
+				const __m128i p1 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[2], c * 8), mask), _mm_and_si128(_mm_srli_epi32(v[3], c * 8), mask));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[c] + i), _mm_packus_epi16(p0, p1));
+			}
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint8_t, 4>(const uint8_t* const* planes, uint8_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+#if KERNELS_AVX2
+		for (; i + 32 <= pixel_count; i += 32)
+		{
+			const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[0] + i));
+			const __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[1] + i));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[2] + i));
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes[3] + i));
+			const __m256i rg_lo = _mm256_unpacklo_epi8(r, g);
+			const __m256i rg_hi = _mm256_unpackhi_epi8(r, g);
+			const __m256i ba_lo = _mm256_unpacklo_epi8(b, a);
+			const __m256i ba_hi = _mm256_unpackhi_epi8(b, a);
+			const __m256i px_0 = _mm256_unpacklo_epi16(rg_lo, ba_lo);
+			const __m256i px_1 = _mm256_unpackhi_epi16(rg_lo, ba_lo);
+			const __m256i px_2 = _mm256_unpacklo_epi16(rg_hi, ba_hi);
+			const __m256i px_3 = _mm256_unpackhi_epi16(rg_hi, ba_hi);
+			__m256i* output = reinterpret_cast<__m256i*>(destination + i * 4);
+			_mm256_storeu_si256(output, _mm256_permute2x128_si256(px_0, px_1, 0x20));
+			_mm256_storeu_si256(output + 1, _mm256_permute2x128_si256(px_2, px_3, 0x20));
+			_mm256_storeu_si256(output + 2, _mm256_permute2x128_si256(px_0, px_1, 0x31));
+			_mm256_storeu_si256(output + 3, _mm256_permute2x128_si256(px_2, px_3, 0x31));
+		}
+#endif
+		for (; i + 16 <= pixel_count; i += 16)
+		{
+			const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+			const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+			const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+			const __m128i ba_lo = _mm_unpacklo_epi8(b, a);
+			const __m128i ba_hi = _mm_unpackhi_epi8(b, a);
+			__m128i* output = reinterpret_cast<__m128i*>(destination + i * 4);
+			_mm_storeu_si128(output, _mm_unpacklo_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128(output + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128(output + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+			_mm_storeu_si128(output + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+		}
+		return i;
+	}
+
+	template <>
+	size_t deinterleave_simd<uint16_t, 2>(const uint16_t* source, uint16_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2 + 8));
+			// packs saturates signed values : sign extend each 16 bits value so that its bits are kept unchanged
+			const __m128i c0 = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16));
+			const __m128i c1 = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), c0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), c1);
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint16_t, 2>(const uint16_t* const* planes, uint16_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2), _mm_unpacklo_epi16(c0, c1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2 + 8), _mm_unpackhi_epi16(c0, c1));
+		}
+		return i;
+	}
+
+#if KERNELS_SSSE3
+	template <>
+	size_t deinterleave_simd<uint16_t, 3>(const uint16_t* source, uint16_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i v[3] = {
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 8)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 16))
+			};
+			for (int c = 0; c < 3; ++c)
+			{
+				const __m128i plane = _mm_or_si128(_mm_or_si128(
+					_mm_shuffle_epi8(v[0], rgb16_masks.split[0][c]),
+					_mm_shuffle_epi8(v[1], rgb16_masks.split[1][c])),
+					_mm_shuffle_epi8(v[2], rgb16_masks.split[2][c]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[c] + i), plane);
+			}
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint16_t, 3>(const uint16_t* const* planes, uint16_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i p[3] = {
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i))
+			};
+			for (int reg = 0; reg < 3; ++reg)
+			{
+				const __m128i pixels = _mm_or_si128(_mm_or_si128(
+					_mm_shuffle_epi8(p[0], rgb16_masks.merge[reg][0]),
+					_mm_shuffle_epi8(p[1], rgb16_masks.merge[reg][1])),
+					_mm_shuffle_epi8(p[2], rgb16_masks.merge[reg][2]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 3 + reg * 8), pixels);
+			}
+		}
+		return i;
+	}
+#else
+	template <>
+	size_t deinterleave_simd<uint16_t, 3>(const uint16_t* source, uint16_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 8));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 16));
+			// Same rounds as 8 bits samples : three rounds for 8 values per register
+			for (int round = 0; round < 3; ++round)
+			{
+				const __m128i next_a = _mm_unpacklo_epi16(a, _mm_unpackhi_epi64(b, b));
+				const __m128i next_b = _mm_unpacklo_epi16(_mm_unpackhi_epi64(a, a), c);
+				const __m128i next_c = _mm_unpacklo_epi16(b, _mm_unpackhi_epi64(c, c));
+				a = next_a;
+				b = next_b;
+				c = next_c;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), b);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[2] + i), c);
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint16_t, 3>(const uint16_t* const* planes, uint16_t* destination, size_t pixel_count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		// 2 rgb0 pixels -> 12 packed bytes
+		const auto pack = [](const __m128i pixels) { return _mm_or_si128(_mm_move_epi64(pixels), _mm_slli_si128(_mm_srli_si128(pixels, 8), 6)); };
+
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+			const __m128i rg_lo = _mm_unpacklo_epi16(r, g);
+			const __m128i rg_hi = _mm_unpackhi_epi16(r, g);
+			const __m128i b0_lo = _mm_unpacklo_epi16(b, zero);
+			const __m128i b0_hi = _mm_unpackhi_epi16(b, zero);
+			store_packed_rgb(reinterpret_cast<uint8_t*>(destination + i * 3),
+				pack(_mm_unpacklo_epi32(rg_lo, b0_lo)), pack(_mm_unpackhi_epi32(rg_lo, b0_lo)),
+				pack(_mm_unpacklo_epi32(rg_hi, b0_hi)), pack(_mm_unpackhi_epi32(rg_hi, b0_hi)));
+		}
+		return i;
+	}
+#endif
+
+	template <>
+	size_t deinterleave_simd<uint16_t, 4>(const uint16_t* source, uint16_t* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4 + 8));
+			const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4 + 16));
+			const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4 + 24));
+			// 8x8 transpose of 16 bits values, 4 output rows are kept
+			const __m128i t0 = _mm_unpacklo_epi16(v0, v1); // r0 r2 g0 g2 b0 b2 a0 a2
+			const __m128i t1 = _mm_unpackhi_epi16(v0, v1); // r1 r3 g1 g3 b1 b3 a1 a3
+			const __m128i t2 = _mm_unpacklo_epi16(v2, v3);
+			const __m128i t3 = _mm_unpackhi_epi16(v2, v3);
+			const __m128i rg_lo = _mm_unpacklo_epi16(t0, t1); // r0 r1 r2 r3 g0 g1 g2 g3
+			const __m128i ba_lo = _mm_unpackhi_epi16(t0, t1);
+			const __m128i rg_hi = _mm_unpacklo_epi16(t2, t3);
+			const __m128i ba_hi = _mm_unpackhi_epi16(t2, t3);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), _mm_unpacklo_epi64(rg_lo, rg_hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), _mm_unpackhi_epi64(rg_lo, rg_hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[2] + i), _mm_unpacklo_epi64(ba_lo, ba_hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(planes[3] + i), _mm_unpackhi_epi64(ba_lo, ba_hi));
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<uint16_t, 4>(const uint16_t* const* planes, uint16_t* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= pixel_count; i += 8)
+		{
+			const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+			const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+			const __m128i rg_lo = _mm_unpacklo_epi16(r, g);
+			const __m128i rg_hi = _mm_unpackhi_epi16(r, g);
+			const __m128i ba_lo = _mm_unpacklo_epi16(b, a);
+			const __m128i ba_hi = _mm_unpackhi_epi16(b, a);
+			__m128i* output = reinterpret_cast<__m128i*>(destination + i * 4);
+			_mm_storeu_si128(output, _mm_unpacklo_epi32(rg_lo, ba_lo));
+			_mm_storeu_si128(output + 1, _mm_unpackhi_epi32(rg_lo, ba_lo));
+			_mm_storeu_si128(output + 2, _mm_unpacklo_epi32(rg_hi, ba_hi));
+			_mm_storeu_si128(output + 3, _mm_unpackhi_epi32(rg_hi, ba_hi));
+		}
+		return i;
+	}
+
+	template <>
+	size_t deinterleave_simd<float, 2>(const float* source, float* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			const __m128 v0 = _mm_loadu_ps(source + i * 2);
+			const __m128 v1 = _mm_loadu_ps(source + i * 2 + 4);
+			_mm_storeu_ps(planes[0] + i, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(planes[1] + i, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<float, 2>(const float* const* planes, float* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			const __m128 c0 = _mm_loadu_ps(planes[0] + i);
+			const __m128 c1 = _mm_loadu_ps(planes[1] + i);
+			_mm_storeu_ps(destination + i * 2, _mm_unpacklo_ps(c0, c1));
+			_mm_storeu_ps(destination + i * 2 + 4, _mm_unpackhi_ps(c0, c1));
+		}
+		return i;
+	}
+
+	template <>
+	size_t deinterleave_simd<float, 3>(const float* source, float* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			// r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+			const __m128 v0 = _mm_loadu_ps(source + i * 3);
+			const __m128 v1 = _mm_loadu_ps(source + i * 3 + 4);
+			const __m128 v2 = _mm_loadu_ps(source + i * 3 + 8);
+			const __m128 r23 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2));
+			const __m128 g01 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1));
+			const __m128 g23 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3));
+			const __m128 b01 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2));
+			_mm_storeu_ps(planes[0] + i, _mm_shuffle_ps(v0, r23, _MM_SHUFFLE(2, 0, 3, 0)));
+			_mm_storeu_ps(planes[1] + i, _mm_shuffle_ps(g01, g23, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(planes[2] + i, _mm_shuffle_ps(b01, v2, _MM_SHUFFLE(3, 0, 2, 0)));
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<float, 3>(const float* const* planes, float* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			const __m128 r = _mm_loadu_ps(planes[0] + i);
+			const __m128 g = _mm_loadu_ps(planes[1] + i);
+			const __m128 b = _mm_loadu_ps(planes[2] + i);
+			const __m128 rg_lo = _mm_unpacklo_ps(r, g); // r0 g0 r1 g1
+			const __m128 rg_hi = _mm_unpackhi_ps(r, g); // r2 g2 r3 g3
+			const __m128 b0_r1 = _mm_shuffle_ps(b, rg_lo, _MM_SHUFFLE(2, 2, 0, 0));
+			const __m128 g1_b1 = _mm_shuffle_ps(rg_lo, b, _MM_SHUFFLE(1, 1, 3, 3));
+			const __m128 b2_r3 = _mm_shuffle_ps(b, rg_hi, _MM_SHUFFLE(2, 2, 2, 2));
+			const __m128 g3_b3 = _mm_shuffle_ps(rg_hi, b, _MM_SHUFFLE(3, 3, 3, 3));
+			_mm_storeu_ps(destination + i * 3, _mm_shuffle_ps(rg_lo, b0_r1, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(destination + i * 3 + 4, _mm_shuffle_ps(g1_b1, rg_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+			_mm_storeu_ps(destination + i * 3 + 8, _mm_shuffle_ps(b2_r3, g3_b3, _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+		return i;
+	}
+
+	template <>
+	size_t deinterleave_simd<float, 4>(const float* source, float* const* planes, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			__m128 v0 = _mm_loadu_ps(source + i * 4);
+			__m128 v1 = _mm_loadu_ps(source + i * 4 + 4);
+			__m128 v2 = _mm_loadu_ps(source + i * 4 + 8);
+			__m128 v3 = _mm_loadu_ps(source + i * 4 + 12);
+			_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+			_mm_storeu_ps(planes[0] + i, v0);
+			_mm_storeu_ps(planes[1] + i, v1);
+			_mm_storeu_ps(planes[2] + i, v2);
+			_mm_storeu_ps(planes[3] + i, v3);
+		}
+		return i;
+	}
+
+	template <>
+	size_t interleave_simd<float, 4>(const float* const* planes, float* destination, size_t pixel_count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= pixel_count; i += 4)
+		{
+			__m128 r = _mm_loadu_ps(planes[0] + i);
+			__m128 g = _mm_loadu_ps(planes[1] + i);
+			__m128 b = _mm_loadu_ps(planes[2] + i);
+			__m128 a = _mm_loadu_ps(planes[3] + i);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			_mm_storeu_ps(destination + i * 4, r);
+			_mm_storeu_ps(destination + i * 4 + 4, g);
+			_mm_storeu_ps(destination + i * 4 + 8, b);
+			_mm_storeu_ps(destination + i * 4 + 12, a);
+		}
+		return i;
+	}
+
+#endif
+
+	template <typename Type, int Channels>
+	static void deinterleave_channels(const Type* source, Type* const* planes, size_t pixel_count)
+	{
+		deinterleave_scalar<Type, Channels>(source, planes, deinterleave_simd<Type, Channels>(source, planes, pixel_count), pixel_count);
+	}
+
+	template <typename Type, int Channels>
+	static void interleave_channels(const Type* const* planes, Type* destination, size_t pixel_count)
+	{
+		interleave_scalar<Type, Channels>(planes, destination, interleave_simd<Type, Channels>(planes, destination, pixel_count), pixel_count);
+	}
+
+	template <typename Type>
+	void deinterleave(const Type* source, Type* const* planes, int channel_count, size_t pixel_count)
+	{
+		switch (channel_count)
+		{
+		case 1: memcpy(planes[0], source, pixel_count * sizeof(Type)); break;
+		case 2: deinterleave_channels<Type, 2>(source, planes, pixel_count); break;
+		case 3: deinterleave_channels<Type, 3>(source, planes, pixel_count); break;
+		case 4: deinterleave_channels<Type, 4>(source, planes, pixel_count); break;
+		default: break;
+		}
+	}
+
+	template <typename Type>
+	void interleave(const Type* const* planes, Type* destination, int channel_count, size_t pixel_count)
+	{
+		switch (channel_count)
+		{
+		case 1: memcpy(destination, planes[0], pixel_count * sizeof(Type)); break;
+		case 2: interleave_channels<Type, 2>(planes, destination, pixel_count); break;
+		case 3: interleave_channels<Type, 3>(planes, destination, pixel_count); break;
+		case 4: interleave_channels<Type, 4>(planes, destination, pixel_count); break;
+		default: break;
+		}
+	}
+
+	void accumulate(float* output, const float* input, const float weight, const size_t count)
+	{
+		size_t i = 0;
+#if KERNELS_AVX2
+		const __m256 weights_256 = _mm256_set1_ps(weight);
+		for (; i + 8 <= count; i += 8) _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_loadu_ps(output + i), _mm256_mul_ps(_mm256_loadu_ps(input + i), weights_256)));
+#endif
+#if KERNELS_SSE2
+		const __m128 weights = _mm_set1_ps(weight);
+		for (; i + 4 <= count; i += 4) _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(input + i), weights)));
+#endif
+		for (; i < count; ++i) output[i] += input[i] * weight;
+	}
+
+	void filter_taps(float* output, const float* input, const int* first, const float* weights, const int tap_count, const size_t count)
+	{
+		size_t i = 0;
+		if (tap_count % 4 == 0)
+		{
+			// Products of 4 taps per pixel are summed in one register per pixel, then the registers of 4 pixels are reduced together
+#if KERNELS_AVX2
+			for (; i + 8 <= count; i += 8)
+			{
+				// Lanes of each register hold pixels j and j + 4
+				__m256 sums[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+				for (int k = 0; k < tap_count; k += 4)
+				{
+					for (size_t j = 0; j < 4; ++j)
+					{
+						const __m256 values = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(input + first[i + j] + k)), _mm_loadu_ps(input + first[i + j + 4] + k), 1);
+						const __m256 taps = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(weights + (i + j) * tap_count + k)), _mm_loadu_ps(weights + (i + j + 4) * tap_count + k), 1);
+						sums[j] = _mm256_add_ps(sums[j], _mm256_mul_ps(values, taps));
+					}
+				}
+				_mm256_storeu_ps(output + i, _mm256_hadd_ps(_mm256_hadd_ps(sums[0], sums[1]), _mm256_hadd_ps(sums[2], sums[3])));
+			}
+#endif
+#if KERNELS_SSE2
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 sums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+				for (int k = 0; k < tap_count; k += 4)
+					for (size_t j = 0; j < 4; ++j)
+						sums[j] = _mm_add_ps(sums[j], _mm_mul_ps(_mm_loadu_ps(input + first[i + j] + k), _mm_loadu_ps(weights + (i + j) * tap_count + k)));
+				_MM_TRANSPOSE4_PS(sums[0], sums[1], sums[2], sums[3]);
+				_mm_storeu_ps(output + i, _mm_add_ps(_mm_add_ps(sums[0], sums[1]), _mm_add_ps(sums[2], sums[3])));
+			}
+#endif
+		}
+
+		for (; i < count; ++i)
+		{
+			const float* values = input + first[i];
+			const float* taps = weights + i * tap_count;
+			float sum = 0;
+			for (int k = 0; k < tap_count; ++k) sum += values[k] * taps[k];
+			output[i] = sum;
+		}
+	}
+
+	const char* get_instruction_set()
+	{
+#if KERNELS_AVX2
+		return "AVX2";
+#elif KERNELS_SSSE3
+		return "SSSE3";
+#elif KERNELS_SSE2
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+
+	template void deinterleave<uint8_t>(const uint8_t*, uint8_t* const*, int, size_t);
+	template void deinterleave<uint16_t>(const uint16_t*, uint16_t* const*, int, size_t);
+	template void deinterleave<float>(const float*, float* const*, int, size_t);
+	template void interleave<uint8_t>(const uint8_t* const*, uint8_t*, int, size_t);
+	template void interleave<uint16_t>(const uint16_t* const*, uint16_t*, int, size_t);
+	template void interleave<float>(const float* const*, float*, int, size_t);
+}
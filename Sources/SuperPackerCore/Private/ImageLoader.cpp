@@ -0,0 +1,117 @@
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "ImageCache.h"
+#include "Logger.h"
+
+namespace SuperPacker
+{
+	std::shared_ptr<const IImage> ImageLoadTask::get_image() const
+	{
+		std::lock_guard<std::mutex> lock(result_lock);
+		return image;
+	}
+
+	std::string ImageLoadTask::get_error() const
+	{
+		std::lock_guard<std::mutex> lock(result_lock);
+		return error;
+	}
+
+	void execute_load_task(ImageLoadTask& task)
+	{
+		if (task.load_progress.cancelled)
+		{
+			task.state = ImageLoadTask::State::Cancelled;
+			return;
+		}
+		task.state = ImageLoadTask::State::Decoding;
+
+		auto image = ImageCache::load(task.path, &task.load_progress);
+
+		std::lock_guard<std::mutex> lock(task.result_lock);
+		if (task.load_progress.cancelled)
+		{
+			task.state = ImageLoadTask::State::Cancelled;
+		}
+		else if (!image)
+		{
+			task.error = stbi_failure_reason() ? stbi_failure_reason() : "unknown error";
+			task.state = ImageLoadTask::State::Failed;
+		}
+		else
+		{
+			task.image = image;
+			task.state = ImageLoadTask::State::Ready;
+		}
+	}
+
+	/** Decoding threads : a few of them so that a huge file doesn't block the following ones */
+	class LoaderThreads final
+	{
+	public:
+		LoaderThreads()
+		{
+			const size_t thread_count = std::clamp<size_t>(std::thread::hardware_concurrency() / 4, 1, 4);
+			for (size_t i = 0; i < thread_count; ++i) threads.emplace_back(&LoaderThreads::thread_loop, this);
+		}
+
+		~LoaderThreads()
+		{
+			{
+				std::lock_guard<std::mutex> lock(queue_lock);
+				stop = true;
+				for (const auto& task : queue) task->cancel();
+			}
+			queue_condition.notify_all();
+			for (auto& thread : threads) thread.join();
+		}
+
+		void push(const std::shared_ptr<ImageLoadTask>& task)
+		{
+			{
+				std::lock_guard<std::mutex> lock(queue_lock);
+				queue.push_back(task);
+			}
+			queue_condition.notify_one();
+		}
+
+	private:
+		void thread_loop()
+		{
+			while (true)
+			{
+				std::shared_ptr<ImageLoadTask> task;
+				{
+					std::unique_lock<std::mutex> lock(queue_lock);
+					queue_condition.wait(lock, [&] { return stop || !queue.empty(); });
+					if (stop) return;
+					task = queue.front();
+					queue.pop_front();
+				}
+				execute_load_task(*task);
+				if (task->get_state() == ImageLoadTask::State::Failed) logger_error("failed to load %s : %s", task->get_path().string().c_str(), task->get_error().c_str());
+			}
+		}
+
+		std::vector<std::thread> threads;
+		std::deque<std::shared_ptr<ImageLoadTask>> queue;
+		std::mutex queue_lock;
+		std::condition_variable queue_condition;
+		bool stop = false;
+	};
+
+	std::shared_ptr<ImageLoadTask> load_image_async(const std::filesystem::path& path)
+	{
+		static LoaderThreads loader_threads;
+
+		auto task = std::make_shared<ImageLoadTask>(path);
+		loader_threads.push(task);
+		return task;
+	}
+}
@@ -0,0 +1,164 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include "Executor.h"
+#include "Logger.h"
+#include "Mipmap.h"
+#include "OutputFile.h"
+#include "StripWriter.h"
+#include "TextureFile.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	static std::mutex export_mips_lock;
+	static std::optional<MipSettings> export_mips;
+
+	/** Name of the trace zone of each strip encoder */
+	static const char* get_encode_zone(const std::string& format)
+	{
+		if (format == "png") return "encode png";
+		if (format == "tga") return "encode tga";
+		if (format == "bmp") return "encode bmp";
+		if (format == "jpg") return "encode jpg";
+		return "encode";
+	}
+
+	/** Interleave and encode the image by strips of rows, so that no full interleaved copy of the image is allocated */
+	template <typename Type>
+	static bool write_strips(const std::string& file_path, const std::string& format, const TImage<Type>& image)
+	{
+		trace_zone(get_encode_zone(format));
+		constexpr int strip_rows = 64;
+		const int width = image.get_width();
+		const int height = image.get_height();
+		const int channels = image.get_channels();
+
+		const auto writer = open_strip_writer(file_path, format, width, height, channels, sizeof(Type));
+		if (!writer) return false;
+
+		TChannelView<Type> views[4];
+		for (int c = 0; c < channels; ++c) views[c] = image.get_channel_view(c);
+
+		std::vector<Type> strip(static_cast<size_t>(width) * channels * strip_rows);
+		for (int y = 0; y < height; y += strip_rows)
+		{
+			const int row_count = std::min(strip_rows, height - y);
+			Executor::parallel_for_rows(row_count, static_cast<size_t>(width) * channels * sizeof(Type), [&](const int y_begin, const int y_end)
+			{
+				interleave_views(views, channels, strip.data() + static_cast<size_t>(y_begin) * width * channels, y + y_begin, y + y_end);
+			});
+			if (!writer->write_rows(strip.data(), row_count)) return false;
+		}
+		return writer->finish();
+	}
+
+	/** Block compress the image and its mips in a single dds or ktx file */
+	static bool write_texture(const std::string& file_path, const std::string& format, const Image& image, const std::vector<std::shared_ptr<IImage>>& mips)
+	{
+		trace_zone("encode texture");
+		const int channels = image.get_channels();
+		const auto block_format = get_texture_block_format().value_or(BlockCompression::get_default_format(channels));
+
+		std::vector<TextureLevel> levels;
+		for (size_t i = 0; i <= mips.size(); ++i)
+		{
+			const auto& level = i == 0 ? image : static_cast<const Image&>(*mips[i - 1]);
+			ChannelView views[4];
+			for (int c = 0; c < channels; ++c) views[c] = level.get_channel_view(c);
+			levels.push_back({ level.get_width(), level.get_height(), BlockCompression::compress(views, channels, block_format) });
+		}
+		return write_texture_file(file_path, format, block_format, levels);
+	}
+
+	/** Write a single level in a file */
+	static bool write_level(const std::string& file_path, const std::string& format, const IImage& image)
+	{
+		int result = 0;
+		if (auto* ldr_image = dynamic_cast<const Image*>(&image))
+		{
+			if (can_write_strips(format, 1))
+			{
+				result = write_strips(file_path, format, *ldr_image);
+			}
+			else
+			{
+				logger_error("unsuported format for 8 bits images : %s", format.c_str());
+				return false;
+			}
+		}
+		else if (auto* image_16 = dynamic_cast<const Image16*>(&image))
+		{
+			if (format != "png")
+			{
+				logger_error("unsuported format for 16 bits images : %s", format.c_str());
+				return false;
+			}
+			result = write_strips(file_path, format, *image_16);
+		}
+		else if (auto* hdr_image = dynamic_cast<const HdrImage*>(&image))
+		{
+			if (format != "hdr")
+			{
+				logger_error("unsuported format for float images : %s", format.c_str());
+				return false;
+			}
+			trace_zone("encode hdr");
+			const auto file = OutputFile::create(file_path);
+			result = file && stbi_write_hdr_to_func(OutputFile::stb_write, file.get(), image.get_width(), image.get_height(), image.get_channels(), hdr_image->gen_data_from_channels(image.get_channels()).data()) && file->commit();
+		}
+
+		if (!result) logger_error("failed to write %s", file_path.c_str());
+		return result != 0;
+	}
+
+	void set_export_mips(const std::optional<MipSettings>& settings)
+	{
+		std::lock_guard lock(export_mips_lock);
+		export_mips = settings;
+	}
+
+	std::optional<MipSettings> get_export_mips()
+	{
+		std::lock_guard lock(export_mips_lock);
+		return export_mips;
+	}
+
+	std::string get_mip_path(const std::string& file_path, const int level)
+	{
+		std::filesystem::path path(file_path);
+		return path.replace_filename(path.stem().string() + "_mip" + std::to_string(level) + path.extension().string()).string();
+	}
+
+	bool write_image(const std::string& file_path, const std::string& format, const IImage& image)
+	{
+		const auto* ldr_image = dynamic_cast<const Image*>(&image);
+		if (is_texture_format(format) && !ldr_image)
+		{
+			logger_error("unsuported format for 16 bits and float images : %s", format.c_str());
+			return false;
+		}
+
+		const auto mip_settings = get_export_mips();
+		const auto mips = mip_settings ? generate_mips(image, *mip_settings) : std::vector<std::shared_ptr<IImage>>();
+
+		if (is_texture_format(format))
+		{
+			if (write_texture(file_path, format, *ldr_image, mips)) return true;
+			logger_error("failed to write %s", file_path.c_str());
+			return false;
+		}
+
+		if (!write_level(file_path, format, image)) return false;
+		for (size_t i = 0; i < mips.size(); ++i)
+			if (!write_level(get_mip_path(file_path, static_cast<int>(i + 1)), format, *mips[i])) return false;
+		return true;
+	}
+}
@@ -0,0 +1,320 @@
+#include "IniLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "Logger.h"
+#include "OutputFile.h"
+
+static bool is_space(const char chr)
+{
+	return chr == ' ' || chr == '\t' || chr == '\r' || chr == '\v' || chr == '\f';
+}
+
+static std::string_view trim(std::string_view text)
+{
+	while (!text.empty() && is_space(text.front())) text.remove_prefix(1);
+	while (!text.empty() && is_space(text.back())) text.remove_suffix(1);
+	return text;
+}
+
+/** Value of a property line, without its trailing comment (a ';' or '#' following a space, outside of quotes) */
+static std::string_view strip_comment(const std::string_view value)
+{
+	bool quoted = false;
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		if (value[i] == '"') quoted = !quoted;
+		else if (!quoted && (value[i] == ';' || value[i] == '#') && i > 0 && is_space(value[i - 1])) return trim(value.substr(0, i));
+	}
+	return value;
+}
+
+/** Whole text as a number, or default_value if it is empty, invalid or out of range */
+template<typename Number>
+static Number parse_number(const std::string_view text, const Number default_value)
+{
+	Number value{};
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return error == std::errc() && end == text.data() + text.size() ? value : default_value;
+}
+
+IniLoader::IniLoader(const std::string file_path)
+	: source_file(file_path) {
+	link_or_create();
+}
+
+IniLoader::~IniLoader() {
+	{
+		std::lock_guard guard(lock);
+		stopping = true;
+	}
+	modified.notify_all();
+	if (saver.joinable()) saver.join();
+	save_content(false);
+}
+
+const std::string IniLoader::get_property_as_string(const std::string& categoryName, const std::string& propertyName, const std::string& defaultValue) {
+	const std::string props = get_property(categoryName, propertyName);
+	if (props.empty()) return defaultValue;
+
+	// Text between the first and the last quote, or the whole value if it is not quoted
+	const size_t first = props.find('"');
+	const size_t last = props.rfind('"');
+	if (first == std::string::npos) return props;
+	if (last == first) return defaultValue;
+	return props.substr(first + 1, last - first - 1);
+}
+
+int IniLoader::get_property_as_int(const std::string& categoryName, const std::string& propertyName, const int& defaultValue)
+{
+	return parse_number(get_property(categoryName, propertyName), defaultValue);
+}
+
+double IniLoader::get_property_as_double(const std::string& categoryName, const std::string& propertyName, const double& defaultValue)
+{
+	return parse_number(get_property(categoryName, propertyName), defaultValue);
+}
+
+bool IniLoader::get_property_as_double(const std::string& categoryName, const std::string& propertyName, const bool& defaultValue)
+{
+	const std::string props = get_property(categoryName, propertyName);
+	if (props == "true") return true;
+	if (props == "false") return false;
+	return defaultValue;
+}
+
+std::vector<std::string> IniLoader::get_categories() const
+{
+	std::lock_guard guard(lock);
+	return category_names;
+}
+
+void IniLoader::save()
+{
+	save_content(true);
+}
+
+const std::string IniLoader::get_property(const std::string& categoryName, const std::string& propertyName) const
+{
+	std::lock_guard guard(lock);
+	const auto category = ini_categories.find(categoryName);
+	if (category == ini_categories.end()) return "";
+	const auto property = category->second.properties.find(propertyName);
+	if (property == category->second.properties.end()) return "";
+	return std::string(property->second.value());
+}
+
+void IniLoader::set_property(const std::string& categoryName, const std::string& propertyName, const std::string& propertyValue)
+{
+	if (propertyValue.empty())
+	{
+		clear_property(categoryName, propertyName);
+		return;
+	}
+
+	{
+		std::lock_guard guard(lock);
+		auto category = ini_categories.find(categoryName);
+		if (category == ini_categories.end())
+		{
+			// New categories are appended to the file, separated by an empty line
+			if (!lines.empty() && !trim(lines.back().text).empty()) insert_line(lines.end(), "");
+			category = ini_categories.emplace(categoryName, IniCategory{ insert_line(lines.end(), '[' + categoryName + ']'), {} }).first;
+			category_names.push_back(categoryName);
+		}
+
+		auto& properties = category->second.properties;
+		const auto property = properties.find(propertyName);
+		if (property == properties.end())
+		{
+			// New properties follow the last line of their category
+			const LineIterator line = insert_line(std::next(category->second.last_line), propertyName + '=' + propertyValue);
+			category->second.last_line = line;
+			properties.emplace(propertyName, IniProperty{ line, propertyName.size() + 1, propertyValue.size() });
+		}
+		else
+		{
+			if (property->second.value() == propertyValue) return;
+
+			// Only the value is replaced : spacing and trailing comments of the line are kept
+			IniProperty& value = property->second;
+			const std::string_view text = value.line->text;
+			set_line(*value.line, std::string(text.substr(0, value.value_offset)).append(propertyValue).append(text.substr(value.value_offset + value.value_size)));
+			value.value_size = propertyValue.size();
+		}
+
+		++modification_count;
+		last_modification = std::chrono::steady_clock::now();
+		if (!saver.joinable()) saver = std::thread(&IniLoader::run_saver, this);
+	}
+	modified.notify_all();
+}
+
+void IniLoader::clear_property(const std::string& categoryName, const std::string& propertyName)
+{
+	{
+		std::lock_guard guard(lock);
+		const auto category = ini_categories.find(categoryName);
+		if (category == ini_categories.end()) return;
+		const auto property = category->second.properties.find(propertyName);
+		if (property == category->second.properties.end()) return;
+
+		const LineIterator line = property->second.line;
+		if (category->second.last_line == line) category->second.last_line = std::prev(line);
+		lines.erase(line);
+		category->second.properties.erase(property);
+
+		++modification_count;
+		last_modification = std::chrono::steady_clock::now();
+		if (!saver.joinable()) saver = std::thread(&IniLoader::run_saver, this);
+	}
+	modified.notify_all();
+}
+
+void IniLoader::link_or_create()
+{
+	const std::filesystem::path path(source_file);
+	if (!std::filesystem::exists(path))
+	{
+		std::error_code error;
+		if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+		return;
+	}
+
+	std::ifstream fs(path, std::ios::binary);
+	std::stringstream buffer;
+	buffer << fs.rdbuf();
+	content = std::move(buffer).str();
+	parse();
+}
+
+void IniLoader::parse()
+{
+	IniCategory* current_category = nullptr;
+
+	const std::string_view text(content);
+	const size_t first_end = text.find('\n');
+	if (first_end != std::string_view::npos && first_end > 0 && text[first_end - 1] == '\r') line_ending = "\r\n";
+
+	for (size_t begin = 0; begin < text.size();)
+	{
+		size_t end = text.find('\n', begin);
+		if (end == std::string_view::npos) end = text.size();
+		std::string_view line_text = text.substr(begin, end - begin);
+		begin = end + 1;
+
+		// Line endings are written back by write_content
+		if (line_ending.size() == 2 && !line_text.empty() && line_text.back() == '\r') line_text.remove_suffix(1);
+
+		const LineIterator line = lines.insert(lines.end(), IniLine{ line_text, {} });
+		const std::string_view line_content = trim(line_text);
+
+		// Empty lines and comments are kept as they are
+		if (line_content.empty() || line_content.front() == ';' || line_content.front() == '#') continue;
+
+		if (line_content.front() == '[')
+		{
+			const size_t close = line_content.find(']');
+			if (close != std::string_view::npos)
+			{
+				// Repeated categories are merged : new properties go to the last occurrence
+				const auto [category, inserted] = ini_categories.try_emplace(std::string(trim(line_content.substr(1, close - 1))), IniCategory{ line, {} });
+				if (inserted) category_names.push_back(category->first);
+				current_category = &category->second;
+				current_category->last_line = line;
+				continue;
+			}
+		}
+
+		if (!current_category) continue;
+		current_category->last_line = line;
+
+		const size_t separator = line_text.find('=');
+		if (separator == std::string_view::npos) continue;
+
+		const std::string_view name = trim(line_text.substr(0, separator));
+		const std::string_view value = strip_comment(trim(line_text.substr(separator + 1)));
+		if (name.empty() || value.empty()) continue;
+
+		// First occurrence of a property wins
+		current_category->properties.try_emplace(std::string(name), IniProperty{ line, static_cast<size_t>(value.data() - line_text.data()), value.size() });
+	}
+}
+
+void IniLoader::set_line(IniLine& line, std::string text)
+{
+	line.modified_text = std::move(text);
+	line.text = line.modified_text;
+}
+
+IniLoader::LineIterator IniLoader::insert_line(const LineIterator position, std::string text)
+{
+	const LineIterator line = lines.emplace(position);
+	set_line(*line, std::move(text));
+	return line;
+}
+
+std::string IniLoader::write_content() const
+{
+	size_t size = 0;
+	for (const auto& line : lines) size += line.text.size() + line_ending.size();
+
+	std::string output;
+	output.reserve(size);
+	for (const auto& line : lines) output.append(line.text).append(line_ending);
+	return output;
+}
+
+void IniLoader::save_content(const bool force)
+{
+	std::lock_guard save_guard(save_lock);
+
+	std::unique_lock guard(lock);
+	if (!force && saved_count == modification_count) return;
+	const uint64_t saved_modification = modification_count;
+	const std::string output = write_content();
+	guard.unlock();
+
+	auto file = SuperPacker::OutputFile::create(source_file, output.size());
+	if (!file || !file->write(output.data(), output.size()) || !file->commit())
+	{
+		logger_error("failed to save %s", source_file.c_str());
+		return;
+	}
+
+	guard.lock();
+	saved_count = std::max(saved_count, saved_modification);
+}
+
+void IniLoader::run_saver()
+{
+	std::unique_lock guard(lock);
+	while (!stopping)
+	{
+		if (saved_count == modification_count)
+		{
+			modified.wait(guard);
+			continue;
+		}
+
+		// Each modification postpones the save
+		const auto deadline = last_modification + save_delay;
+		if (std::chrono::steady_clock::now() < deadline)
+		{
+			modified.wait_until(guard, deadline);
+			continue;
+		}
+
+		guard.unlock();
+		save_content(false);
+		guard.lock();
+
+		// Retry failed saves after another delay
+		if (saved_count != modification_count) last_modification = std::chrono::steady_clock::now();
+	}
+}
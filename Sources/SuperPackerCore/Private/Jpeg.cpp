@@ -0,0 +1,454 @@
+#include "Jpeg.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Executor.h"
+
+namespace SuperPacker::Jpeg
+{
+	/** Natural (row major) index of each coefficient in zigzag order */
+	static const auto zigzag = []
+	{
+		std::array<uint8_t, 64> order{};
+		int index = 0;
+		for (int diagonal = 0; diagonal < 15; ++diagonal)
+		{
+			for (int i = 0; i <= diagonal; ++i)
+			{
+				// Even diagonals go up, odd ones go down
+				const int row = diagonal % 2 ? i : diagonal - i;
+				const int column = diagonal - row;
+				if (row < 8 && column < 8) order[index++] = static_cast<uint8_t>(row * 8 + column);
+			}
+		}
+		return order;
+	}();
+
+	/** Quantization tables of the JPEG specification (Annex K.1), in natural order */
+	static constexpr uint8_t luma_quantization[64] = {
+		16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+	};
+	static constexpr uint8_t chroma_quantization[64] = {
+		17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	};
+
+	/** Huffman tables of the JPEG specification (Annex K.3) : number of codes of each length, then symbols */
+	static constexpr uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+	static constexpr uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+	static constexpr uint8_t dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+	static constexpr uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+	static constexpr uint8_t ac_luma_values[162] = {
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+		0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+		0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+		0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+		0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+		0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+		0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+		0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+		0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+		0xf9, 0xfa,
+	};
+
+	static constexpr uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+	static constexpr uint8_t ac_chroma_values[162] = {
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+		0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+		0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+		0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+		0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+		0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+		0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+		0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+		0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+		0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+		0xf9, 0xfa,
+	};
+
+	/** Codes of a Huffman table, indexed by symbol */
+	struct HuffmanCodes
+	{
+		HuffmanCodes(const uint8_t* bits, const uint8_t* values)
+		{
+			uint16_t code = 0;
+			int index = 0;
+			for (int length = 1; length <= 16; ++length, code <<= 1)
+			{
+				for (int i = 0; i < bits[length - 1]; ++i, ++code, ++index)
+				{
+					codes[values[index]] = code;
+					lengths[values[index]] = static_cast<uint8_t>(length);
+				}
+			}
+		}
+
+		std::array<uint16_t, 256> codes{};
+		std::array<uint8_t, 256> lengths{};
+	};
+
+	/** Entropy coded bytes of a restart interval. 0xFF bytes are followed by a 0 to not be read as markers */
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& in_output) : output(in_output) {}
+
+		void write(const uint32_t value, const int count)
+		{
+			bit_buffer = bit_buffer << count | (value & ((1u << count) - 1));
+			bit_count += count;
+			while (bit_count >= 8)
+			{
+				const auto byte = static_cast<uint8_t>(bit_buffer >> (bit_count - 8));
+				output.push_back(byte);
+				if (byte == 0xFF) output.push_back(0);
+				bit_count -= 8;
+			}
+		}
+
+		/** Pad the last byte with 1 bits */
+		void flush()
+		{
+			if (bit_count) write(0x7F, 8 - bit_count);
+		}
+
+	private:
+		std::vector<uint8_t>& output;
+		uint32_t bit_buffer = 0;
+		int bit_count = 0;
+	};
+
+	/** Scaled forward DCT (Arai, Agui, Nakajima), in place on rows then on columns. Outputs are scaled by aan_scales */
+	static void forward_dct(float* data, const int stride, const int step)
+	{
+		for (int i = 0; i < 8; ++i, data += stride)
+		{
+			float& d0 = data[0];
+			float& d1 = data[step];
+			float& d2 = data[step * 2];
+			float& d3 = data[step * 3];
+			float& d4 = data[step * 4];
+			float& d5 = data[step * 5];
+			float& d6 = data[step * 6];
+			float& d7 = data[step * 7];
+
+			const float tmp0 = d0 + d7;
+			const float tmp7 = d0 - d7;
+			const float tmp1 = d1 + d6;
+			const float tmp6 = d1 - d6;
+			const float tmp2 = d2 + d5;
+			const float tmp5 = d2 - d5;
+			const float tmp3 = d3 + d4;
+			const float tmp4 = d3 - d4;
+
+			// Even part
+			float tmp10 = tmp0 + tmp3;
+			const float tmp13 = tmp0 - tmp3;
+			float tmp11 = tmp1 + tmp2;
+			float tmp12 = tmp1 - tmp2;
+			d0 = tmp10 + tmp11;
+			d4 = tmp10 - tmp11;
+			const float z1 = (tmp12 + tmp13) * 0.707106781f;
+			d2 = tmp13 + z1;
+			d6 = tmp13 - z1;
+
+			// Odd part
+			tmp10 = tmp4 + tmp5;
+			tmp11 = tmp5 + tmp6;
+			tmp12 = tmp6 + tmp7;
+			const float z5 = (tmp10 - tmp12) * 0.382683433f;
+			const float z2 = 0.541196100f * tmp10 + z5;
+			const float z4 = 1.306562965f * tmp12 + z5;
+			const float z3 = tmp11 * 0.707106781f;
+			const float z11 = tmp7 + z3;
+			const float z13 = tmp7 - z3;
+			d5 = z13 + z2;
+			d3 = z13 - z2;
+			d1 = z11 + z4;
+			d7 = z11 - z4;
+		}
+	}
+
+	struct Encoder::Internal
+	{
+		Internal(const int in_width, const int in_height, const int in_channels, const int quality, const Subsampling subsampling)
+			: width(in_width), height(in_height), channels(in_channels), color(in_channels >= 3),
+			  horizontal_factor(color && subsampling != Subsampling::S444 ? 2 : 1), vertical_factor(color && subsampling == Subsampling::S420 ? 2 : 1),
+			  dc_luma(dc_luma_bits, dc_values), ac_luma(ac_luma_bits, ac_luma_values), dc_chroma(dc_chroma_bits, dc_values), ac_chroma(ac_chroma_bits, ac_chroma_values)
+		{
+			// Same quality scaling as libjpeg
+			const int clamped_quality = std::clamp(quality, 1, 100);
+			const int scale = clamped_quality < 50 ? 5000 / clamped_quality : 200 - clamped_quality * 2;
+			const auto build_table = [&](const uint8_t* base, uint8_t* table, float* scales)
+			{
+				for (int i = 0; i < 64; ++i)
+				{
+					table[i] = static_cast<uint8_t>(std::clamp((base[i] * scale + 50) / 100, 1, 255));
+					scales[i] = 1.0f / (table[i] * aan_scales[i / 8] * aan_scales[i % 8] * 8.0f);
+				}
+			};
+			build_table(luma_quantization, luma_table.data(), luma_scales.data());
+			build_table(chroma_quantization, chroma_table.data(), chroma_scales.data());
+		}
+
+		[[nodiscard]] int mcu_width() const { return 8 * horizontal_factor; }
+		[[nodiscard]] int mcu_height() const { return 8 * vertical_factor; }
+
+		/** Encode rows [0, row_count) of rows as a restart interval. Missing rows and columns repeat the last ones */
+		void encode_interval(const uint8_t* rows, const int row_count, std::vector<uint8_t>& output) const
+		{
+			BitWriter writer(output);
+			int dc_predictions[3] = {};
+			const int mcu_w = mcu_width();
+			const int mcu_h = mcu_height();
+			const size_t row_size = static_cast<size_t>(width) * channels;
+
+			// Level shifted Y, Cb and Cr of every pixel of the MCU
+			std::vector<float> planes[3];
+			for (auto& plane : planes) plane.resize(static_cast<size_t>(mcu_w) * mcu_h);
+			float block[64];
+
+			for (int mcu_x = 0; mcu_x < width; mcu_x += mcu_w)
+			{
+				for (int y = 0; y < mcu_h; ++y)
+				{
+					const uint8_t* row = rows + std::min(y, row_count - 1) * row_size;
+					for (int x = 0; x < mcu_w; ++x)
+					{
+						const uint8_t* pixel = row + static_cast<size_t>(std::min(mcu_x + x, width - 1)) * channels;
+						const size_t index = static_cast<size_t>(y) * mcu_w + x;
+						if (!color)
+						{
+							planes[0][index] = pixel[0] - 128.0f;
+							continue;
+						}
+						const float r = pixel[0];
+						const float g = pixel[1];
+						const float b = pixel[2];
+						planes[0][index] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+						planes[1][index] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+						planes[2][index] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+					}
+				}
+
+				for (int block_y = 0; block_y < vertical_factor; ++block_y)
+				{
+					for (int block_x = 0; block_x < horizontal_factor; ++block_x)
+					{
+						for (int i = 0; i < 64; ++i) block[i] = planes[0][static_cast<size_t>(block_y * 8 + i / 8) * mcu_w + block_x * 8 + i % 8];
+						encode_block(block, luma_scales.data(), dc_predictions[0], dc_luma, ac_luma, writer);
+					}
+				}
+
+				// Chroma blocks average the pixels they cover
+				for (int c = 1; color && c < 3; ++c)
+				{
+					const float weight = 1.0f / static_cast<float>(horizontal_factor * vertical_factor);
+					for (int i = 0; i < 64; ++i)
+					{
+						float sum = 0;
+						for (int sy = 0; sy < vertical_factor; ++sy)
+							for (int sx = 0; sx < horizontal_factor; ++sx)
+								sum += planes[c][static_cast<size_t>((i / 8) * vertical_factor + sy) * mcu_w + (i % 8) * horizontal_factor + sx];
+						block[i] = sum * weight;
+					}
+					encode_block(block, chroma_scales.data(), dc_predictions[c], dc_chroma, ac_chroma, writer);
+				}
+			}
+			writer.flush();
+		}
+
+		static void encode_block(float* block, const float* scales, int& dc_prediction, const HuffmanCodes& dc_codes, const HuffmanCodes& ac_codes, BitWriter& writer)
+		{
+			forward_dct(block, 8, 1);
+			forward_dct(block, 1, 8);
+
+			int coefficients[64];
+			for (int i = 0; i < 64; ++i) coefficients[i] = static_cast<int>(std::lround(block[zigzag[i]] * scales[zigzag[i]]));
+
+			const int difference = coefficients[0] - dc_prediction;
+			dc_prediction = coefficients[0];
+			write_coefficient(difference, 0, dc_codes, writer);
+
+			int zero_run = 0;
+			for (int i = 1; i < 64; ++i)
+			{
+				if (coefficients[i] == 0)
+				{
+					++zero_run;
+					continue;
+				}
+				for (; zero_run >= 16; zero_run -= 16) writer.write(ac_codes.codes[0xF0], ac_codes.lengths[0xF0]);
+				write_coefficient(coefficients[i], zero_run, ac_codes, writer);
+				zero_run = 0;
+			}
+			// End of block
+			if (zero_run) writer.write(ac_codes.codes[0x00], ac_codes.lengths[0x00]);
+		}
+
+		/** Huffman code of (zero_run, bit count), followed by the bits of value (one's complement if negative) */
+		static void write_coefficient(const int value, const int zero_run, const HuffmanCodes& codes, BitWriter& writer)
+		{
+			const unsigned magnitude = static_cast<unsigned>(std::abs(value));
+			int size = 0;
+			while (magnitude >> size) ++size;
+			const int symbol = zero_run << 4 | size;
+			writer.write(codes.codes[symbol], codes.lengths[symbol]);
+			if (size) writer.write(static_cast<uint32_t>(value < 0 ? value + (1 << size) - 1 : value), size);
+		}
+
+		static constexpr float aan_scales[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+
+		const int width;
+		const int height;
+		const int channels;
+		const bool color;
+		const int horizontal_factor;
+		const int vertical_factor;
+
+		std::array<uint8_t, 64> luma_table{};
+		std::array<uint8_t, 64> chroma_table{};
+		std::array<float, 64> luma_scales{};
+		std::array<float, 64> chroma_scales{};
+		const HuffmanCodes dc_luma;
+		const HuffmanCodes ac_luma;
+		const HuffmanCodes dc_chroma;
+		const HuffmanCodes ac_chroma;
+
+		int next_interval = 0;
+		std::vector<std::vector<uint8_t>> intervals;
+	};
+
+	static void put_marker(std::vector<uint8_t>& output, const uint8_t marker, const size_t length)
+	{
+		output.push_back(0xFF);
+		output.push_back(marker);
+		// Segment length includes its own two bytes
+		if (length)
+		{
+			output.push_back(static_cast<uint8_t>(length >> 8));
+			output.push_back(static_cast<uint8_t>(length));
+		}
+	}
+
+	static void put_huffman_table(std::vector<uint8_t>& output, const uint8_t table_id, const uint8_t* bits, const uint8_t* values, const size_t value_count)
+	{
+		output.push_back(table_id);
+		output.insert(output.end(), bits, bits + 16);
+		output.insert(output.end(), values, values + value_count);
+	}
+
+	Encoder::Encoder(const int width, const int height, const int channels, const int quality, const Subsampling subsampling)
+		: internal(std::make_unique<Internal>(width, height, channels, quality, subsampling)) {}
+
+	Encoder::~Encoder() = default;
+
+	int Encoder::get_interval_rows() const
+	{
+		return internal->mcu_height();
+	}
+
+	void Encoder::write_header(std::vector<uint8_t>& output)
+	{
+		const bool color = internal->color;
+		const int component_count = color ? 3 : 1;
+
+		// SOI and JFIF
+		put_marker(output, 0xD8, 0);
+		put_marker(output, 0xE0, 16);
+		static constexpr uint8_t jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+		output.insert(output.end(), std::begin(jfif), std::end(jfif));
+
+		// Quantization tables, in zigzag order
+		put_marker(output, 0xDB, 2 + 65 * (color ? 2 : 1));
+		for (int table = 0; table < (color ? 2 : 1); ++table)
+		{
+			output.push_back(static_cast<uint8_t>(table));
+			const auto& values = table ? internal->chroma_table : internal->luma_table;
+			for (int i = 0; i < 64; ++i) output.push_back(values[zigzag[i]]);
+		}
+
+		// Frame : component ids are 1 (Y), 2 (Cb) and 3 (Cr)
+		put_marker(output, 0xC0, 8 + 3 * component_count);
+		output.push_back(8);
+		output.push_back(static_cast<uint8_t>(internal->height >> 8));
+		output.push_back(static_cast<uint8_t>(internal->height));
+		output.push_back(static_cast<uint8_t>(internal->width >> 8));
+		output.push_back(static_cast<uint8_t>(internal->width));
+		output.push_back(static_cast<uint8_t>(component_count));
+		for (int c = 0; c < component_count; ++c)
+		{
+			output.push_back(static_cast<uint8_t>(c + 1));
+			output.push_back(static_cast<uint8_t>(c ? 0x11 : internal->horizontal_factor << 4 | internal->vertical_factor));
+			output.push_back(static_cast<uint8_t>(c ? 1 : 0));
+		}
+
+		// Huffman tables
+		put_marker(output, 0xC4, 2 + (17 + 12 + 17 + 162) * (color ? 2 : 1));
+		put_huffman_table(output, 0x00, dc_luma_bits, dc_values, 12);
+		put_huffman_table(output, 0x10, ac_luma_bits, ac_luma_values, 162);
+		if (color)
+		{
+			put_huffman_table(output, 0x01, dc_chroma_bits, dc_values, 12);
+			put_huffman_table(output, 0x11, ac_chroma_bits, ac_chroma_values, 162);
+		}
+
+		// Restart interval : a row of MCUs
+		const int mcus_per_row = (internal->width + internal->mcu_width() - 1) / internal->mcu_width();
+		put_marker(output, 0xDD, 4);
+		output.push_back(static_cast<uint8_t>(mcus_per_row >> 8));
+		output.push_back(static_cast<uint8_t>(mcus_per_row));
+
+		// Start of scan
+		put_marker(output, 0xDA, 6 + 2 * component_count);
+		output.push_back(static_cast<uint8_t>(component_count));
+		for (int c = 0; c < component_count; ++c)
+		{
+			output.push_back(static_cast<uint8_t>(c + 1));
+			output.push_back(static_cast<uint8_t>(c ? 0x11 : 0x00));
+		}
+		output.push_back(0);
+		output.push_back(63);
+		output.push_back(0);
+	}
+
+	void Encoder::write_rows(const uint8_t* rows, const int row_count, std::vector<uint8_t>& output)
+	{
+		const int interval_rows = internal->mcu_height();
+		const int interval_count = (row_count + interval_rows - 1) / interval_rows;
+		const size_t row_size = static_cast<size_t>(internal->width) * internal->channels;
+
+		internal->intervals.resize(interval_count);
+		Executor::parallel_for(interval_count, 1, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const int first_row = static_cast<int>(i) * interval_rows;
+				internal->intervals[i].clear();
+				internal->encode_interval(rows + first_row * row_size, std::min(interval_rows, row_count - first_row), internal->intervals[i]);
+			}
+		});
+
+		for (const auto& interval : internal->intervals)
+		{
+			// Restart markers separate intervals, and cycle from RST0 to RST7
+			if (internal->next_interval) put_marker(output, static_cast<uint8_t>(0xD0 + (internal->next_interval - 1) % 8), 0);
+			output.insert(output.end(), interval.begin(), interval.end());
+			internal->next_interval++;
+		}
+	}
+
+	void Encoder::finish(std::vector<uint8_t>& output)
+	{
+		put_marker(output, 0xD9, 0);
+	}
+}
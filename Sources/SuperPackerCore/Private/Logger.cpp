@@ -0,0 +1,286 @@
+#include "Logger.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if _WIN32
+#include <windows.h>
+HANDLE h_console_out = GetStdHandle(STD_OUTPUT_HANDLE);
+#endif
+
+std::vector<uint8_t> allowed_thread_colors = {
+	2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	18, 19, 20, 22, 23, 24, 26, 27, 28, 30, 31,
+	32, 33, 37, 38, 39, 43, 44, 45, 46, 47,
+	48, 49, 52, 54, 55, 58, 59, 60, 61, 62, 63,
+	64, 65, 66, 67, 70, 71, 73, 74, 75, 76, 78, 79,
+	80, 81, 82, 83, 84, 86, 87, 90, 91, 92, 94, 95,
+	96, 98, 99, 100, 101, 104, 105, 106, 109, 110, 111,
+	112, 113, 114, 115, 116, 117, 120, 121, 122, 123, 125, 127,
+	129, 132, 133, 134 ,135 ,138, 139, 140, 142, 143,
+	144, 145, 148, 149, 150, 151, 154, 155, 156, 157, 158, 159,
+	160, 161, 164, 165, 166, 167, 162, 174, 175,
+	176, 177, 178, 179, 180 ,181, 184, 185, 186, 189, 190, 191,
+	192, 193, 194, 197, 201, 202, 206, 207,
+	208, 209, 210, 211, 214, 215, 220, 222, 223,
+	224, 225, 226, 227, 228, 229, 232, 233, 234, 235, 236, 237,
+	240, 241, 242, 243 ,244 ,245, 248, 249, 250, 252, 253
+};
+
+
+namespace logger
+{
+	static std::atomic<uint8_t(*)()> get_worker_id_func = nullptr;
+
+	struct Message
+	{
+		std::atomic<Message*> next = nullptr;
+		const char* type = nullptr;
+		int color = 0;
+		std::string text;
+		const char* function = nullptr;
+		size_t line = 0;
+		const char* file = nullptr;
+		time_t time = 0;
+		uint8_t worker_id = 255;
+		uint32_t thread_hash = 0;
+	};
+
+	/**
+	 * Intrusive multi-producer single-consumer queue : producers only exchange the head, and the writer thread owns the tail.
+	 * The last popped message is kept as the stub of the queue until the next pop.
+	 */
+	class MessageQueue
+	{
+	public:
+		MessageQueue() : head(&stub), tail(&stub) {}
+
+		void push(Message* message)
+		{
+			message->next.store(nullptr, std::memory_order_relaxed);
+			Message* previous = head.exchange(message, std::memory_order_acq_rel);
+			previous->next.store(message, std::memory_order_release);
+		}
+
+		/** Oldest message, or null if the queue is empty or a push is not linked yet. Only called by the consumer */
+		Message* pop()
+		{
+			Message* next = tail->next.load(std::memory_order_acquire);
+			if (!next) return nullptr;
+			if (tail != &stub) delete tail;
+			tail = next;
+			return next;
+		}
+
+	private:
+		Message stub;
+		std::atomic<Message*> head;
+		Message* tail;
+	};
+
+	/** Text of messages, with the time formatted once per second */
+	class MessageFormatter
+	{
+	public:
+		void append(std::string& output, const Message& message)
+		{
+			if (message.time != cached_time)
+			{
+				struct tm time_str;
+#if _WIN32
+				localtime_s(&time_str, &message.time);
+#else
+				localtime_r(&message.time, &time_str);
+#endif
+				strftime(time_buffer, sizeof(time_buffer), "%X", &time_str);
+				cached_time = message.time;
+			}
+
+			set_color(output, message.color);
+			output += '[';
+			output += time_buffer;
+			output += "  ";
+
+#if _WIN32
+			set_color(output, message.worker_id != 255 ? allowed_thread_colors[message.worker_id % allowed_thread_colors.size()] : CONSOLE_ASSERT);
+#endif
+			output += message.worker_id != 255 ? log_format("#W%d", message.worker_id) : log_format("~%x", message.thread_hash);
+			set_color(output, message.color);
+
+			if (message.function) output += log_format("] [%s] %s::%d : ", message.type, message.function, static_cast<int>(message.line));
+			else output += log_format("] [%s] : ", message.type);
+			output += message.text;
+			if (message.file) output += log_format("\n\t=>%s", message.file);
+			output += '\n';
+			set_color(output, CONSOLE_DEFAULT);
+		}
+
+	private:
+		/** Colors are written as virtual terminal sequences within the text, so a whole batch is written at once */
+		static void set_color([[maybe_unused]] std::string& output, [[maybe_unused]] const int color)
+		{
+#if _WIN32
+			static const bool virtual_terminal = []
+			{
+				DWORD mode = 0;
+				return GetConsoleMode(h_console_out, &mode) && SetConsoleMode(h_console_out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+			}();
+			if (!virtual_terminal) return;
+
+			// Console attributes store blue, green, red and intensity bits, the reverse order of ansi colors
+			const auto ansi_color = [](const int attribute) { return (attribute & 4 ? 1 : 0) | (attribute & 2 ? 2 : 0) | (attribute & 1 ? 4 : 0); };
+			const int foreground = color & 0xF;
+			const int background = color >> 4 & 0xF;
+			output += "\x1b[0;" + std::to_string((foreground & 8 ? 90 : 30) + ansi_color(foreground));
+			if (background) output += ';' + std::to_string((background & 8 ? 100 : 40) + ansi_color(background));
+			output += 'm';
+#endif
+		}
+
+		time_t cached_time = -1;
+		char time_buffer[80] = {};
+	};
+
+	/** Background thread writing queued messages once per drained batch. Output is only flushed after fatal messages and when the writer stops */
+	class Writer
+	{
+	public:
+		Writer() : thread([this] { run(); }) {}
+
+		void push(Message* message)
+		{
+			queue.push(message);
+			pushed.fetch_add(1, std::memory_order_release);
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_one();
+		}
+
+		void flush()
+		{
+			const uint64_t target = pushed.load(std::memory_order_acquire);
+			for (uint64_t current = written.load(std::memory_order_acquire); current < target; current = written.load(std::memory_order_acquire))
+				written.wait(current);
+		}
+
+		void stop()
+		{
+			stopping = true;
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_one();
+			thread.join();
+			std::cout.flush();
+		}
+
+	private:
+		void run()
+		{
+			std::string batch;
+			while (true)
+			{
+				const uint64_t seen = signal.load(std::memory_order_acquire);
+
+				uint64_t count = 0;
+				bool fatal = false;
+				while (Message* message = queue.pop())
+				{
+					formatter.append(batch, *message);
+					fatal |= message->type && message->type[0] == 'F';
+					++count;
+				}
+				if (count)
+				{
+					std::cout.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+					if (fatal) std::cout.flush();
+					batch.clear();
+					written.fetch_add(count, std::memory_order_release);
+					written.notify_all();
+				}
+
+				// A message may be pushed but not linked yet : retry instead of sleeping
+				if (written.load(std::memory_order_relaxed) < pushed.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				if (stopping) return;
+				signal.wait(seen, std::memory_order_acquire);
+			}
+		}
+
+		MessageQueue queue;
+		MessageFormatter formatter;
+		std::atomic<uint64_t> pushed = 0;
+		std::atomic<uint64_t> written = 0;
+		std::atomic<uint64_t> signal = 0;
+		std::atomic<bool> stopping = false;
+		std::thread thread;
+	};
+
+	/** Messages logged after the writer stopped (from static destructors) are written synchronously */
+	static std::atomic<bool> writer_stopped = false;
+	static std::mutex stopped_lock;
+
+	static void stop_writer();
+
+	/** Never destroyed : messages can be logged until the end of the process */
+	static Writer& get_writer()
+	{
+		static Writer* writer = []
+		{
+			auto* new_writer = new Writer();
+			std::atexit(stop_writer);
+			return new_writer;
+		}();
+		return *writer;
+	}
+
+	static void stop_writer()
+	{
+		writer_stopped = true;
+		get_writer().stop();
+	}
+
+	void log_print(const char* type, int color, const std::string_view message, const char* function, size_t line, const char* file)
+	{
+		auto* entry = new Message();
+		entry->type = type;
+		entry->color = color;
+		entry->text = message;
+		entry->function = function;
+		entry->line = line;
+		entry->file = file;
+		entry->time = time(nullptr);
+		entry->thread_hash = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		if (const auto getter = get_worker_id_func.load(std::memory_order_relaxed)) entry->worker_id = getter();
+
+		if (!writer_stopped)
+		{
+			get_writer().push(entry);
+			return;
+		}
+
+		std::lock_guard lock(stopped_lock);
+		static MessageFormatter formatter;
+		std::string text;
+		formatter.append(text, *entry);
+		std::cout << text;
+		std::cout.flush();
+		delete entry;
+	}
+
+	void flush()
+	{
+		if (!writer_stopped) get_writer().flush();
+		std::cout.flush();
+	}
+
+	void set_get_worker_func(uint8_t(*getter)())
+	{
+		get_worker_id_func = getter;
+	}
+}
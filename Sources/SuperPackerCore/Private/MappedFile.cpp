@@ -0,0 +1,61 @@
+#include "MappedFile.h"
+
+#if _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SuperPacker
+{
+	std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path)
+	{
+		std::shared_ptr<MappedFile> file(new MappedFile());
+#if _WIN32
+		file->file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file->file_handle == INVALID_HANDLE_VALUE)
+		{
+			file->file_handle = nullptr;
+			return nullptr;
+		}
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file->file_handle, &file_size) || file_size.QuadPart == 0) return nullptr;
+
+		file->mapping_handle = CreateFileMappingW(file->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!file->mapping_handle) return nullptr;
+
+		file->data = static_cast<const uint8_t*>(MapViewOfFile(file->mapping_handle, FILE_MAP_READ, 0, 0, 0));
+		if (!file->data) return nullptr;
+		file->size = static_cast<size_t>(file_size.QuadPart);
+#else
+		const int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) return nullptr;
+
+		struct stat status = {};
+		void* mapping = MAP_FAILED;
+		if (fstat(descriptor, &status) == 0 && status.st_size > 0) mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+		// The mapping keeps the file referenced
+		close(descriptor);
+		if (mapping == MAP_FAILED) return nullptr;
+
+		file->data = static_cast<const uint8_t*>(mapping);
+		file->size = static_cast<size_t>(status.st_size);
+#endif
+		return file;
+	}
+
+	MappedFile::~MappedFile()
+	{
+#if _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping_handle) CloseHandle(mapping_handle);
+		if (file_handle) CloseHandle(file_handle);
+#else
+		if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+	}
+}
@@ -0,0 +1,171 @@
+#include "Mipmap.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Logger.h"
+#include "Resample.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	static float srgb_to_linear(const float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float linear_to_srgb(const float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1 / 2.4f) - 0.055f;
+	}
+
+	/** Level of one channel, as normalized floats */
+	struct FloatPlane
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<float> values;
+	};
+
+	static FloatPlane downsample(const FloatPlane& source, const int width, const int height, const MipFilter filter)
+	{
+		const ResampleFilter resample_filter = filter == MipFilter::Box ? ResampleFilter::Box : ResampleFilter::Kaiser;
+		const FilterTaps x_taps = make_filter_taps(source.width, width, resample_filter, 4);
+		const FilterTaps y_taps = make_filter_taps(source.height, height, resample_filter);
+
+		FloatPlane level{ width, height, std::vector<float>(static_cast<size_t>(width) * height) };
+		Executor::parallel_for(height, 1, [&](const size_t y_begin, const size_t y_end)
+		{
+			std::vector<float> column_sums(source.width + 3); // padding read by the null taps
+			for (size_t y = y_begin; y < y_end; ++y)
+			{
+				// Vertical pass over whole source rows, then horizontal pass within the accumulated row
+				std::fill_n(column_sums.begin(), source.width, 0.f);
+				for (int k = 0; k < y_taps.tap_count; ++k)
+				{
+					const float weight = y_taps.weights[y * y_taps.tap_count + k];
+					if (weight != 0) Kernels::accumulate(column_sums.data(), source.values.data() + static_cast<size_t>(y_taps.first[y] + k) * source.width, weight, source.width);
+				}
+
+				Kernels::filter_taps(level.values.data() + y * width, column_sums.data(), x_taps.first.data(), x_taps.weights.data(), x_taps.tap_count, width);
+			}
+		});
+		return level;
+	}
+
+	/** Scale giving values the same ratio of samples above threshold as the base level (1 if it cannot be matched) */
+	static float coverage_scale(const std::vector<float>& values, const float threshold, const double coverage)
+	{
+		const auto covered = static_cast<size_t>(std::lround(coverage * values.size()));
+		if (covered == 0 || covered > values.size()) return 1;
+
+		// Smallest value of the covered samples is scaled to the threshold
+		std::vector<float> sorted = values;
+		const auto reference = sorted.begin() + static_cast<ptrdiff_t>(values.size() - covered);
+		std::ranges::nth_element(sorted, reference);
+		return *reference > 0 ? threshold / *reference : 1;
+	}
+
+	template <typename Type>
+	static std::vector<std::shared_ptr<IImage>> generate_mips(const TImage<Type>& image, const MipSettings& settings)
+	{
+		std::vector<std::shared_ptr<TImage<Type>>> levels;
+		int width = image.get_width();
+		int height = image.get_height();
+		while (width > 1 || height > 1)
+		{
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+			levels.emplace_back(std::make_shared<TImage<Type>>(width, height, image.get_channels(), image.get_display_channels()));
+		}
+
+		for (int c = 0; c < image.get_channels(); ++c)
+		{
+			const auto& view = image.get_channel_view(c);
+			if (view.pixel_stride == 0 && view.row_stride == 0)
+			{
+				for (const auto& level : levels) level->set_channel_constant(*view.data, c);
+				continue;
+			}
+
+			const bool linear = settings.srgb && !std::is_floating_point_v<Type> && image.get_channels() >= 3 && c < 3;
+			const float threshold = settings.coverage_thresholds[c];
+
+			// sRGB decoding of 8 bits samples is a table lookup
+			std::array<float, 256> decode_table{};
+			if constexpr (std::is_same_v<Type, uint8_t>)
+				for (int i = 0; i < 256; ++i) decode_table[i] = linear ? srgb_to_linear(i / 255.f) : i / 255.f;
+
+			FloatPlane plane{ view.width, view.height, std::vector<float>(static_cast<size_t>(view.width) * view.height) };
+			Executor::parallel_for_rows(view.height, static_cast<size_t>(view.width) * sizeof(float), [&](const int y_begin, const int y_end)
+			{
+				for (int y = y_begin; y < y_end; ++y)
+				{
+					float* output = plane.values.data() + static_cast<size_t>(y) * view.width;
+					for (int x = 0; x < view.width; ++x)
+					{
+						if constexpr (std::is_same_v<Type, uint8_t>) output[x] = decode_table[view.at(x, y)];
+						else if (linear) output[x] = srgb_to_linear(Kernels::convert_sample<float>(view.at(x, y)));
+						else output[x] = Kernels::convert_sample<float>(view.at(x, y));
+					}
+				}
+			});
+
+			double coverage = 0;
+			if (threshold > 0) coverage = static_cast<double>(std::ranges::count_if(plane.values, [&](const float value) { return value >= threshold; })) / plane.values.size();
+
+			for (const auto& level : levels)
+			{
+				plane = downsample(plane, level->get_width(), level->get_height(), settings.filter);
+				const float scale = threshold > 0 ? coverage_scale(plane.values, threshold, coverage) : 1;
+
+				std::vector<Type> samples(plane.values.size());
+				Executor::parallel_for_rows(level->get_height(), static_cast<size_t>(level->get_width()) * sizeof(float), [&](const int y_begin, const int y_end)
+				{
+					for (size_t i = static_cast<size_t>(y_begin) * level->get_width(); i < static_cast<size_t>(y_end) * level->get_width(); ++i)
+					{
+						// Kaiser ringing can overshoot : integer samples are clamped to [0, 1], floats are kept positive
+						float value = std::max(0.f, plane.values[i] * scale);
+						if (linear) value = linear_to_srgb(std::min(value, 1.f));
+						if constexpr (std::is_floating_point_v<Type>) samples[i] = static_cast<Type>(threshold > 0 ? std::min(value, 1.f) : value);
+						else samples[i] = Kernels::convert_sample<Type>(value);
+					}
+				});
+				level->set_channel_data(std::move(samples), c);
+			}
+		}
+		return { levels.begin(), levels.end() };
+	}
+
+	bool parse_mip_filter(const std::string& name, MipFilter& filter)
+	{
+		if (name == "box") filter = MipFilter::Box;
+		else if (name == "kaiser") filter = MipFilter::Kaiser;
+		else return false;
+		return true;
+	}
+
+	int get_mip_count(int width, int height)
+	{
+		int count = 1;
+		for (; width > 1 || height > 1; ++count)
+		{
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		return count;
+	}
+
+	std::vector<std::shared_ptr<IImage>> generate_mips(const IImage& image, const MipSettings& settings)
+	{
+		trace_zone("generate mips");
+		if (!image.is_valid()) return {};
+		if (auto* ldr_image = dynamic_cast<const Image*>(&image)) return generate_mips(*ldr_image, settings);
+		if (auto* image_16 = dynamic_cast<const Image16*>(&image)) return generate_mips(*image_16, settings);
+		if (auto* hdr_image = dynamic_cast<const HdrImage*>(&image)) return generate_mips(*hdr_image, settings);
+
+		logger_error("unsupported image type for mips");
+		return {};
+	}
+}
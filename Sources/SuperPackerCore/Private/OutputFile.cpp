@@ -0,0 +1,131 @@
+#include "OutputFile.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "Logger.h"
+
+#if _WIN32
+#include <Windows.h>
+#include <io.h>
+#elif __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace SuperPacker
+{
+	/** Reserve disk space for size bytes without changing the file size, so that the file is less fragmented */
+	static void preallocate(FILE* file, const uint64_t size)
+	{
+#if _WIN32
+		FILE_ALLOCATION_INFO allocation = {};
+		allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+		SetFileInformationByHandle(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file))), FileAllocationInfo, &allocation, sizeof(allocation));
+#elif __linux__
+		fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#else
+		(void)file;
+		(void)size;
+#endif
+	}
+
+	OutputFile::OutputFile(std::filesystem::path in_path, std::filesystem::path in_temporary_path, FILE* in_file)
+		: path(std::move(in_path)), temporary_path(std::move(in_temporary_path)), file(in_file)
+	{
+		buffer.reserve(buffer_size);
+	}
+
+	std::unique_ptr<OutputFile> OutputFile::create(const std::filesystem::path& path, const uint64_t expected_size)
+	{
+		// Hidden file in the same directory, so that the final rename never moves data across file systems
+		static std::atomic<uint32_t> counter = 0;
+		auto temporary_path = path;
+		temporary_path.replace_filename("." + path.filename().string() + "." + std::to_string(counter++) + ".tmp");
+
+		FILE* file = nullptr;
+#if _WIN32
+		if (_wfopen_s(&file, temporary_path.c_str(), L"wb") != 0) file = nullptr;
+#else
+		file = fopen(temporary_path.c_str(), "wb");
+#endif
+		if (!file)
+		{
+			logger_error("cannot create %s : %s", temporary_path.string().c_str(), strerror(errno));
+			return nullptr;
+		}
+		// Writes are already gathered in the buffer
+		setvbuf(file, nullptr, _IONBF, 0);
+		if (expected_size) preallocate(file, expected_size);
+
+		return std::unique_ptr<OutputFile>(new OutputFile(path, temporary_path, file));
+	}
+
+	OutputFile::~OutputFile()
+	{
+		if (!file) return;
+		fclose(file);
+		std::error_code error;
+		std::filesystem::remove(temporary_path, error);
+	}
+
+	bool OutputFile::write(const void* data, const size_t size)
+	{
+		if (failed || !file) return false;
+
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		if (buffer.size() + size > buffer_size && !flush_buffer()) return false;
+
+		// Large writes skip the buffer
+		if (size >= buffer_size)
+		{
+			if (fwrite(bytes, 1, size, file) != size) failed = true;
+			return !failed;
+		}
+		buffer.insert(buffer.end(), bytes, bytes + size);
+		return true;
+	}
+
+	bool OutputFile::flush_buffer()
+	{
+		if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) failed = true;
+		buffer.clear();
+		return !failed;
+	}
+
+	bool OutputFile::commit()
+	{
+		if (!file) return false;
+
+		const bool written = flush_buffer() && fflush(file) == 0;
+		const int write_error = errno;
+		const bool closed = fclose(file) == 0;
+		file = nullptr;
+
+		std::error_code error;
+		if (written && closed)
+		{
+			// The temporary file was created with default permissions : keep the ones of the file it replaces (best effort)
+			const auto destination = std::filesystem::status(path, error);
+			if (!error && std::filesystem::exists(destination)) std::filesystem::permissions(temporary_path, destination.permissions(), error);
+
+			// Replace the destination in a single step (rename is atomic on POSIX, and MoveFileEx with replacement on Windows)
+			std::filesystem::rename(temporary_path, path, error);
+			if (!error) return true;
+			logger_error("cannot replace %s : %s", path.string().c_str(), error.message().c_str());
+		}
+		else
+		{
+			logger_error("failed to write %s : %s", path.string().c_str(), strerror(write_error));
+		}
+		std::filesystem::remove(temporary_path, error);
+		return false;
+	}
+
+	void OutputFile::stb_write(void* context, void* data, const int size)
+	{
+		static_cast<OutputFile*>(context)->write(data, static_cast<size_t>(size));
+	}
+}
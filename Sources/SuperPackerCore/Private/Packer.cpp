@@ -0,0 +1,320 @@
+#include "Packer.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "Executor.h"
+#include "Logger.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	/** Copy a channel of another sample type into a new plane */
+	template <typename Type, typename SourceType>
+	static std::vector<Type> convert_channel(const TChannelView<SourceType>& view)
+	{
+		std::vector<Type> plane(static_cast<size_t>(view.width) * view.height);
+		Executor::parallel_for_rows(view.height, static_cast<size_t>(view.width) * sizeof(Type), [&](const int y_begin, const int y_end)
+		{
+			for (int y = y_begin; y < y_end; ++y)
+			{
+				const SourceType* input = view.row(y);
+				Type* output = plane.data() + static_cast<size_t>(y) * view.width;
+				for (int x = 0; x < view.width; ++x) output[x] = Kernels::convert_sample<Type>(input[x * view.pixel_stride]);
+			}
+		});
+		return plane;
+	}
+
+	/** Assign source channel to channel c of target. Return true if the content of the channel changed */
+	template <typename Type>
+	static bool assign_source(const ChannelSource& source, TImage<Type>& target, const int c)
+	{
+		// Output channels only reference source pixels : they are copied once when the output is interleaved
+		if (auto* image = dynamic_cast<const TImage<Type>*>(source.image.get()))
+		{
+			const auto& view = image->get_channel_view(source.source_channel);
+			// Source images are immutable, so an identical view always references identical pixels
+			const bool changed = view != target.get_channel_view(c);
+			target.set_channel_view(view, c, source.image);
+			return changed;
+		}
+
+		if (auto* image = dynamic_cast<const Image*>(source.image.get())) target.set_channel_data(convert_channel<Type>(image->get_channel_view(source.source_channel)), c);
+		else if (auto* image_16 = dynamic_cast<const Image16*>(source.image.get())) target.set_channel_data(convert_channel<Type>(image_16->get_channel_view(source.source_channel)), c);
+		else if (auto* hdr_image = dynamic_cast<const HdrImage*>(source.image.get())) target.set_channel_data(convert_channel<Type>(hdr_image->get_channel_view(source.source_channel)), c);
+		else
+		{
+			logger_error("unsupported source image type");
+			return false;
+		}
+		return true;
+	}
+
+	/** Convert count samples of a channel, from pixel (x, y) of the target, to normalized floats */
+	typedef std::function<void(int x, int y, size_t count, float* output)> SampleReader;
+
+	/** Create the reader of one task : readers keep a state (the last filtered row), so threads never share them */
+	typedef std::function<SampleReader()> ReaderFactory;
+
+	template <typename SourceType>
+	static ReaderFactory make_reader(const TChannelView<SourceType>& view)
+	{
+		return [view]() -> SampleReader
+		{
+			return [view](const int x, const int y, const size_t count, float* output)
+			{
+				const SourceType* input = view.row(y) + x * view.pixel_stride;
+				for (size_t i = 0; i < count; ++i) output[i] = Kernels::convert_sample<float>(input[i * view.pixel_stride]);
+			};
+		};
+	}
+
+	/** Reader of view resampled to width x height : each target row is filtered vertically once, then every batch is filtered horizontally */
+	template <typename SourceType>
+	static ReaderFactory make_reader(const TChannelView<SourceType>& view, const int width, const int height, const ResampleFilter filter)
+	{
+		const auto x_taps = std::make_shared<const FilterTaps>(make_filter_taps(view.width, width, filter, 4));
+		const auto y_taps = std::make_shared<const FilterTaps>(make_filter_taps(view.height, height, filter));
+		return [view, x_taps, y_taps]() -> SampleReader
+		{
+			std::vector<float> filtered_row(view.width + 3); // padding read by the null taps
+			std::vector<float> source_row(view.width);
+			int filtered_y = -1;
+			return [view, x_taps, y_taps, filtered_row = std::move(filtered_row), source_row = std::move(source_row), filtered_y](const int x, const int y, const size_t count, float* output) mutable
+			{
+				if (y != filtered_y)
+				{
+					std::fill_n(filtered_row.begin(), view.width, 0.f);
+					for (int k = 0; k < y_taps->tap_count; ++k)
+					{
+						const float weight = y_taps->weights[static_cast<size_t>(y) * y_taps->tap_count + k];
+						if (weight == 0) continue;
+						const SourceType* input = view.row(y_taps->first[y] + k);
+						for (int i = 0; i < view.width; ++i) source_row[i] = Kernels::convert_sample<float>(input[i * view.pixel_stride]);
+						Kernels::accumulate(filtered_row.data(), source_row.data(), weight, view.width);
+					}
+					filtered_y = y;
+				}
+
+				Kernels::filter_taps(output, filtered_row.data(), x_taps->first.data() + x, x_taps->weights.data() + static_cast<size_t>(x) * x_taps->tap_count, x_taps->tap_count, count);
+			};
+		};
+	}
+
+	template <typename SourceType>
+	static ReaderFactory make_reader(const TChannelView<SourceType>& view, const int width, const int height, const std::optional<ResampleSettings>& resample)
+	{
+		if (view.pixel_stride == 0 && view.row_stride == 0) return make_reader(TChannelView<SourceType>::constant(view.data, width, height));
+		if (resample && (view.width != width || view.height != height)) return make_reader(view, width, height, resample->filter);
+		return make_reader(view);
+	}
+
+	static ReaderFactory make_reader(const ChannelSource& input, const int width, const int height, const std::optional<ResampleSettings>& resample)
+	{
+		if (auto* image = dynamic_cast<const Image*>(input.image.get())) return make_reader(image->get_channel_view(input.source_channel), width, height, resample);
+		if (auto* image_16 = dynamic_cast<const Image16*>(input.image.get())) return make_reader(image_16->get_channel_view(input.source_channel), width, height, resample);
+		if (auto* hdr_image = dynamic_cast<const HdrImage*>(input.image.get())) return make_reader(hdr_image->get_channel_view(input.source_channel), width, height, resample);
+
+		const float value = Kernels::convert_sample<float>(input.default_value);
+		return [value]() -> SampleReader
+		{
+			return [value](int, int, const size_t count, float* output) { std::fill_n(output, count, value); };
+		};
+	}
+
+	/**
+	 * Compute every channel of mask in a single pass : channels with an expression, and channels of sources resampled to the size of target.
+	 * Each batch of samples of the used inputs is read once, and the results are written straight into the output planes.
+	 */
+	template <typename Type>
+	static void compute_channels(const std::vector<ChannelSource>& sources, TImage<Type>& target, const uint32_t mask, const std::optional<ResampleSettings>& resample)
+	{
+		trace_zone("compute channels");
+		const int width = target.get_width();
+		const int height = target.get_height();
+
+		struct Program
+		{
+			int channel;
+			const Expression* expression; // null : the channel is its single input
+			std::vector<int> inputs;      // index in readers of each variable (-1 if unused)
+			std::vector<Type> plane;
+		};
+		std::vector<Program> programs;
+		std::vector<ReaderFactory> readers;
+		std::vector<std::pair<const IImage*, int>> reader_keys;
+
+		// Inputs shared by several channels are only read once per batch
+		const auto add_reader = [&](const ChannelSource& input)
+		{
+			const std::pair key(input.image.get(), input.image ? input.source_channel : -1 - input.default_value);
+			const auto existing = std::ranges::find(reader_keys, key);
+			if (existing != reader_keys.end()) return static_cast<int>(existing - reader_keys.begin());
+			reader_keys.push_back(key);
+			readers.push_back(make_reader(input, width, height, resample));
+			return static_cast<int>(readers.size() - 1);
+		};
+
+		size_t scratch_size = 0;
+		for (int c = 0; c < static_cast<int>(sources.size()); ++c)
+		{
+			if (!(mask & 1u << c)) continue;
+			const auto& source = sources[c];
+			Program program{ c, source.expression.get(), {}, std::vector<Type>(static_cast<size_t>(width) * height) };
+			if (!source.expression)
+			{
+				program.inputs.push_back(add_reader(source));
+				programs.push_back(std::move(program));
+				continue;
+			}
+
+			program.inputs.assign(source.inputs.size(), -1);
+			for (size_t v = 0; v < source.inputs.size() && v < 32; ++v)
+				if (source.expression->get_variable_mask() & 1u << v) program.inputs[v] = add_reader(source.inputs[v]);
+			scratch_size = std::max(scratch_size, source.expression->get_scratch_size());
+			programs.push_back(std::move(program));
+		}
+
+		Executor::parallel_for_rows(height, static_cast<size_t>(width) * programs.size() * sizeof(Type), [&](const int y_begin, const int y_end)
+		{
+			std::vector<SampleReader> task_readers;
+			for (const auto& factory : readers) task_readers.push_back(factory());
+
+			std::vector<float> batches(readers.size() * Expression::max_batch);
+			std::vector<float> scratch(scratch_size);
+			std::vector<const float*> variables;
+			for (int y = y_begin; y < y_end; ++y)
+			{
+				for (int x = 0; x < width; x += static_cast<int>(Expression::max_batch))
+				{
+					const size_t count = std::min<size_t>(Expression::max_batch, width - x);
+					for (size_t r = 0; r < task_readers.size(); ++r) task_readers[r](x, y, count, batches.data() + r * Expression::max_batch);
+
+					for (auto& program : programs)
+					{
+						variables.assign(program.inputs.size(), nullptr);
+						for (size_t v = 0; v < program.inputs.size(); ++v)
+							if (program.inputs[v] >= 0) variables[v] = batches.data() + program.inputs[v] * Expression::max_batch;
+
+						const float* results = program.expression ? program.expression->evaluate(variables.data(), scratch.data(), count) : variables[0];
+						Type* output = program.plane.data() + static_cast<size_t>(y) * width + x;
+						for (size_t i = 0; i < count; ++i) output[i] = Kernels::convert_sample<Type>(results[i]);
+					}
+				}
+			}
+		});
+
+		for (auto& program : programs) target.set_channel_data(std::move(program.plane), program.channel);
+	}
+
+	template <typename Type>
+	uint32_t pack_channels(const std::vector<ChannelSource>& sources, std::shared_ptr<TImage<Type>>& target, const std::optional<ResampleSettings>& resample)
+	{
+		trace_zone("pack channels");
+		const auto channel_count = static_cast<int>(sources.size());
+
+		int image_width = 0;
+		int image_height = 0;
+
+		// Images read by expressions must have the same size as other sources, unless they are resampled
+		std::vector<const IImage*> images;
+		for (const auto& source : sources)
+		{
+			if (!source.expression) images.push_back(source.image.get());
+			else
+				for (size_t v = 0; v < source.inputs.size() && v < 32; ++v)
+					if (source.expression->get_variable_mask() & 1u << v) images.push_back(source.inputs[v].image.get());
+		}
+
+		for (const auto* image : images)
+		{
+			if (image)
+			{
+				if (resample) {
+					image_width = std::max(image_width, image->get_width());
+					image_height = std::max(image_height, image->get_height());
+				}
+				else if (!image_width || !image_height) {
+					image_width = image->get_width();
+					image_height = image->get_height();
+				}
+				else if (image_width != image->get_width() || image_height != image->get_height())
+				{
+					logger_warning("wrong image dimention");
+					target = nullptr;
+					return 0;
+				}
+			}
+		}
+
+		if (image_width == 0 || image_height == 0) {
+			target = nullptr;
+			return 0;
+		}
+
+		if (resample && resample->width > 0) image_width = resample->width;
+		if (resample && resample->height > 0) image_height = resample->height;
+
+		uint32_t changed_channels = 0;
+		if (!target || target->get_width() != image_width || target->get_height() != image_height || target->get_channels() != channel_count)
+		{
+			target = std::make_shared<TImage<Type>>(image_width, image_height, channel_count);
+			changed_channels = (1u << channel_count) - 1;
+		}
+
+		uint32_t computed_channels = 0;
+		for (int c = 0; c < channel_count; ++c)
+		{
+			const auto& source = sources[c];
+			if (source.expression || (source.image && (source.image->get_width() != image_width || source.image->get_height() != image_height)))
+			{
+				computed_channels |= 1u << c;
+			}
+			else if (source.image)
+			{
+				if (assign_source(source, *target, c)) changed_channels |= 1u << c;
+			}
+			else
+			{
+				const auto previous_view = target->get_channel_view(c);
+				const Type value = Kernels::convert_sample<Type>(source.default_value);
+				if (previous_view.pixel_stride != 0 || previous_view.row_stride != 0 || *previous_view.data != value) changed_channels |= 1u << c;
+				target->set_channel_constant(value, c);
+			}
+		}
+
+		if (computed_channels)
+		{
+			compute_channels(sources, *target, computed_channels, resample);
+			changed_channels |= computed_channels;
+		}
+		return changed_channels;
+	}
+
+	template uint32_t pack_channels<uint8_t>(const std::vector<ChannelSource>&, std::shared_ptr<Image>&, const std::optional<ResampleSettings>&);
+	template uint32_t pack_channels<uint16_t>(const std::vector<ChannelSource>&, std::shared_ptr<Image16>&, const std::optional<ResampleSettings>&);
+	template uint32_t pack_channels<float>(const std::vector<ChannelSource>&, std::shared_ptr<HdrImage>&, const std::optional<ResampleSettings>&);
+
+	template <typename Type>
+	static std::shared_ptr<IImage> pack_as(const std::vector<ChannelSource>& sources, const std::optional<ResampleSettings>& resample)
+	{
+		std::shared_ptr<TImage<Type>> image;
+		pack_channels(sources, image, resample);
+		return image;
+	}
+
+	std::shared_ptr<IImage> pack_for_format(const std::vector<ChannelSource>& sources, const std::string& format, const std::optional<ResampleSettings>& resample)
+	{
+		if (format == "hdr") return pack_as<float>(sources, resample);
+
+		const auto is_high_precision = [](const ChannelSource& source) { return source.image && !dynamic_cast<const Image*>(source.image.get()); };
+		const bool high_precision = std::ranges::any_of(sources, [&](const ChannelSource& source)
+		{
+			return source.expression ? std::ranges::any_of(source.inputs, is_high_precision) : is_high_precision(source);
+		});
+		if (format == "png" && high_precision) return pack_as<uint16_t>(sources, resample);
+
+		return pack_as<uint8_t>(sources, resample);
+	}
+}
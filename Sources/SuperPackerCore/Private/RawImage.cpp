@@ -0,0 +1,74 @@
+#include "RawImage.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+
+namespace SuperPacker
+{
+	static uint32_t read_little_endian(const uint8_t* data, const int bytes)
+	{
+		uint32_t value = 0;
+		for (int i = bytes - 1; i >= 0; --i) value = value << 8 | data[i];
+		return value;
+	}
+
+	static std::optional<RawImageLayout> parse_tga(const uint8_t* header, const size_t header_size)
+	{
+		if (header_size < 18) return std::nullopt;
+
+		RawImageLayout layout;
+		const int image_type = header[2] & ~8;
+		const int bits = header[16];
+		layout.rle = (header[2] & 8) != 0;
+		layout.top_down = (header[17] & 0x20) != 0;
+		layout.width = static_cast<int>(read_little_endian(header + 12, 2));
+		layout.height = static_cast<int>(read_little_endian(header + 14, 2));
+		// Color maps, right-to-left pixels and bottom-up RLE rows are left to stb_image
+		if (header[1] != 0 || header[17] & 0x10 || (layout.rle && !layout.top_down) || layout.width <= 0 || layout.height <= 0) return std::nullopt;
+
+		if (image_type == 2 && bits == 24) layout.format = RawImageLayout::PixelFormat::Bgr;
+		else if (image_type == 2 && bits == 32) layout.format = RawImageLayout::PixelFormat::Bgra;
+		else if (image_type == 3 && bits == 8) layout.format = RawImageLayout::PixelFormat::Gray;
+		else if (image_type == 3 && bits == 16) layout.format = RawImageLayout::PixelFormat::GrayAlpha;
+		else return std::nullopt;
+
+		layout.data_offset = 18 + header[0];
+		layout.row_size = static_cast<size_t>(layout.width) * layout.get_pixel_size();
+		return layout;
+	}
+
+	static std::optional<RawImageLayout> parse_bmp(const uint8_t* header, const size_t header_size)
+	{
+		if (header_size < 54) return std::nullopt;
+
+		const uint32_t info_size = read_little_endian(header + 14, 4);
+		const auto width = static_cast<int32_t>(read_little_endian(header + 18, 4));
+		const auto height = static_cast<int32_t>(read_little_endian(header + 22, 4));
+		const uint32_t bits = read_little_endian(header + 28, 2);
+		const uint32_t compression = read_little_endian(header + 30, 4);
+		if (info_size < 40 || bits != 24 || compression != 0 || width <= 0 || height == 0 || height == INT32_MIN) return std::nullopt;
+
+		// Rows are padded to 4 bytes, and a negative height means top-down rows
+		RawImageLayout layout;
+		layout.width = width;
+		layout.height = std::abs(height);
+		layout.format = RawImageLayout::PixelFormat::Bgr;
+		layout.data_offset = read_little_endian(header + 10, 4);
+		layout.row_size = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+		layout.top_down = height < 0;
+		return layout;
+	}
+
+	std::optional<RawImageLayout> parse_raw_image_header(const uint8_t* header, const size_t header_size, const std::filesystem::path& path)
+	{
+		if (header_size >= 2 && header[0] == 'B' && header[1] == 'M') return parse_bmp(header, header_size);
+
+		std::string extension = path.extension().string();
+		std::ranges::transform(extension, extension.begin(), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		if (extension == ".tga") return parse_tga(header, header_size);
+
+		return std::nullopt;
+	}
+}
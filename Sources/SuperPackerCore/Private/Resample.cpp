@@ -0,0 +1,234 @@
+#include "Resample.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <numbers>
+#include <string_view>
+#include <vector>
+
+#include "Executor.h"
+#include "Logger.h"
+
+namespace SuperPacker
+{
+	static double sinc(const double t)
+	{
+		return t == 0 ? 1 : std::sin(std::numbers::pi * t) / (std::numbers::pi * t);
+	}
+
+	static double bessel_i0(const double x)
+	{
+		double sum = 1;
+		double term = 1;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= x / (2 * k) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	/** Filter radius in source pixels, before downscaling widens it */
+	static double get_support(const ResampleFilter filter)
+	{
+		switch (filter)
+		{
+		case ResampleFilter::Nearest:
+		case ResampleFilter::Box: return 0.5;
+		case ResampleFilter::Bilinear: return 1;
+		case ResampleFilter::Kaiser:
+		case ResampleFilter::Lanczos: return 3;
+		}
+		return 1;
+	}
+
+	static double evaluate_filter(const ResampleFilter filter, const double t)
+	{
+		constexpr double width = 3;
+		constexpr double alpha = 4;
+		switch (filter)
+		{
+		case ResampleFilter::Bilinear: return std::max(0.0, 1 - std::abs(t));
+		case ResampleFilter::Kaiser: return std::abs(t) >= width ? 0 : sinc(t) * bessel_i0(alpha * std::sqrt(1 - t * t / (width * width))) / bessel_i0(alpha);
+		case ResampleFilter::Lanczos: return std::abs(t) >= width ? 0 : sinc(t) * sinc(t / width);
+		default: return 1;
+		}
+	}
+
+	bool parse_resample_filter(const std::string& name, ResampleFilter& filter)
+	{
+		if (name == "nearest") filter = ResampleFilter::Nearest;
+		else if (name == "bilinear") filter = ResampleFilter::Bilinear;
+		else if (name == "box") filter = ResampleFilter::Box;
+		else if (name == "kaiser") filter = ResampleFilter::Kaiser;
+		else if (name == "lanczos") filter = ResampleFilter::Lanczos;
+		else return false;
+		return true;
+	}
+
+	/** Parse a positive size filling the whole text */
+	static bool parse_dimension(const std::string_view text, int& value)
+	{
+		int parsed = 0;
+		const auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+		if (error != std::errc() || last != text.data() + text.size() || parsed <= 0) return false;
+		value = parsed;
+		return true;
+	}
+
+	bool parse_resample_size(const std::string& value, ResampleSettings& settings)
+	{
+		const auto separator = value.find('x');
+		if (separator == std::string::npos) return false;
+		const std::string_view text(value);
+		int width, height;
+		if (!parse_dimension(text.substr(0, separator), width) || !parse_dimension(text.substr(separator + 1), height)) return false;
+		settings.width = width;
+		settings.height = height;
+		return true;
+	}
+
+	/** Round the tap count up to a multiple of tap_multiple with null weights */
+	static void pad_filter_taps(FilterTaps& taps, const int destination_size, const int tap_multiple)
+	{
+		const int tap_count = (taps.tap_count + tap_multiple - 1) / tap_multiple * tap_multiple;
+		if (tap_count == taps.tap_count) return;
+
+		std::vector<float> weights(static_cast<size_t>(destination_size) * tap_count, 0.f);
+		for (int i = 0; i < destination_size; ++i)
+			std::copy_n(taps.weights.data() + static_cast<size_t>(i) * taps.tap_count, taps.tap_count, weights.data() + static_cast<size_t>(i) * tap_count);
+		taps.tap_count = tap_count;
+		taps.weights = std::move(weights);
+	}
+
+	FilterTaps make_filter_taps(const int source_size, const int destination_size, const ResampleFilter filter, const int tap_multiple)
+	{
+		const double step = static_cast<double>(source_size) / destination_size;
+		FilterTaps taps;
+		taps.first.resize(destination_size);
+
+		if (filter == ResampleFilter::Nearest)
+		{
+			taps.tap_count = 1;
+			taps.weights.assign(destination_size, 1.f);
+			for (int i = 0; i < destination_size; ++i) taps.first[i] = std::min(static_cast<int>((i + 0.5) * step), source_size - 1);
+			pad_filter_taps(taps, destination_size, tap_multiple);
+			return taps;
+		}
+
+		// Box covers exactly one destination pixel, other filters are only widened when downscaling
+		const double scale = std::max(1.0, step);
+		const double radius = filter == ResampleFilter::Box ? step / 2 : get_support(filter) * scale;
+
+		// Unclamped source range of each destination pixel
+		std::vector<std::pair<int, int>> ranges(destination_size);
+		int window = 1;
+		for (int i = 0; i < destination_size; ++i)
+		{
+			const double center = (i + 0.5) * step;
+			ranges[i] = { static_cast<int>(std::floor(center - radius)), static_cast<int>(std::ceil(center + radius)) - 1 };
+			window = std::max(window, ranges[i].second - ranges[i].first + 1);
+		}
+
+		taps.tap_count = std::min(window, source_size);
+		taps.weights.resize(static_cast<size_t>(destination_size) * taps.tap_count);
+		for (int i = 0; i < destination_size; ++i)
+		{
+			const double center = (i + 0.5) * step;
+			const int first = std::clamp(ranges[i].first, 0, source_size - taps.tap_count);
+			float* weights = taps.weights.data() + static_cast<size_t>(i) * taps.tap_count;
+			taps.first[i] = first;
+
+			double total = 0;
+			for (int source = ranges[i].first; source <= ranges[i].second; ++source)
+			{
+				double weight;
+				if (filter == ResampleFilter::Box) weight = std::max(0.0, std::min<double>(source + 1, center + radius) - std::max<double>(source, center - radius));
+				else weight = evaluate_filter(filter, (source + 0.5 - center) / scale);
+				weights[std::clamp(source, 0, source_size - 1) - first] += static_cast<float>(weight);
+				total += weight;
+			}
+			for (int k = 0; k < taps.tap_count; ++k) weights[k] = static_cast<float>(weights[k] / total);
+		}
+		pad_filter_taps(taps, destination_size, tap_multiple);
+		return taps;
+	}
+
+	template <typename Type> struct BoxAccumulator { typedef float Type_t; };
+	template <> struct BoxAccumulator<uint8_t> { typedef uint32_t Type_t; };
+	template <> struct BoxAccumulator<uint16_t> { typedef uint64_t Type_t; };
+
+	template <typename Type>
+	static Type box_average(const typename BoxAccumulator<Type>::Type_t sum, const uint32_t area)
+	{
+		if constexpr (std::is_integral_v<Type>) return static_cast<Type>((sum + area / 2) / area);
+		else return static_cast<Type>(sum / static_cast<float>(area));
+	}
+
+	template <typename Type>
+	static std::shared_ptr<const IImage> make_proxy(const TImage<Type>& source, const int proxy_width, const int proxy_height)
+	{
+		typedef typename BoxAccumulator<Type>::Type_t Accumulator;
+
+		const int width = source.get_width();
+		const int height = source.get_height();
+
+		// Each proxy pixel covers source pixels [bounds[x], bounds[x + 1])
+		std::vector<int> x_bounds(proxy_width + 1);
+		std::vector<int> y_bounds(proxy_height + 1);
+		for (int x = 0; x <= proxy_width; ++x) x_bounds[x] = static_cast<int>(static_cast<int64_t>(x) * width / proxy_width);
+		for (int y = 0; y <= proxy_height; ++y) y_bounds[y] = static_cast<int>(static_cast<int64_t>(y) * height / proxy_height);
+
+		auto proxy = std::make_shared<Image>(proxy_width, proxy_height, source.get_channels(), source.get_display_channels());
+		proxy->source_path = source.source_path;
+
+		for (int c = 0; c < source.get_display_channels(); ++c)
+		{
+			const auto& view = source.get_channel_view(c);
+			std::vector<uint8_t> plane(static_cast<size_t>(proxy_width) * proxy_height);
+
+			Executor::parallel_for(proxy_height, 1, [&](const size_t y_begin, const size_t y_end)
+			{
+				std::vector<Accumulator> sums(proxy_width);
+				for (size_t y = y_begin; y < y_end; ++y)
+				{
+					std::ranges::fill(sums, Accumulator(0));
+					for (int source_y = y_bounds[y]; source_y < y_bounds[y + 1]; ++source_y)
+					{
+						const Type* row = view.row(source_y);
+						for (int x = 0; x < proxy_width; ++x)
+						{
+							Accumulator sum = 0;
+							for (int source_x = x_bounds[x]; source_x < x_bounds[x + 1]; ++source_x) sum += row[source_x * view.pixel_stride];
+							sums[x] += sum;
+						}
+					}
+
+					const uint32_t rows = y_bounds[y + 1] - y_bounds[y];
+					uint8_t* output = plane.data() + y * proxy_width;
+					for (int x = 0; x < proxy_width; ++x) output[x] = Kernels::convert_sample<uint8_t>(box_average<Type>(sums[x], rows * (x_bounds[x + 1] - x_bounds[x])));
+				}
+			});
+			proxy->set_channel_data(std::move(plane), c);
+		}
+		return proxy;
+	}
+
+	std::shared_ptr<const IImage> make_proxy(const std::shared_ptr<const IImage>& source, const int max_size)
+	{
+		if (!source || !source->is_valid()) return source;
+
+		const double scale = std::min(1.0, static_cast<double>(max_size) / std::max(source->get_width(), source->get_height()));
+		const int proxy_width = std::max(1, static_cast<int>(std::lround(source->get_width() * scale)));
+		const int proxy_height = std::max(1, static_cast<int>(std::lround(source->get_height() * scale)));
+
+		if (scale == 1.0 && dynamic_cast<const Image*>(source.get())) return source;
+		if (auto* ldr_image = dynamic_cast<const Image*>(source.get())) return make_proxy(*ldr_image, proxy_width, proxy_height);
+		if (auto* image_16 = dynamic_cast<const Image16*>(source.get())) return make_proxy(*image_16, proxy_width, proxy_height);
+		if (auto* hdr_image = dynamic_cast<const HdrImage*>(source.get())) return make_proxy(*hdr_image, proxy_width, proxy_height);
+
+		logger_error("unsupported image type for proxy");
+		return source;
+	}
+}
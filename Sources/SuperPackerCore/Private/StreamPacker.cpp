@@ -0,0 +1,156 @@
+#include "StreamPacker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "ChannelView.h"
+#include "Executor.h"
+#include "Logger.h"
+#include "StripReader.h"
+#include "StripWriter.h"
+#include "Trace.h"
+
+namespace SuperPacker
+{
+	/** Source file and its current strip of RGBA rows */
+	struct SourceStrip
+	{
+		std::filesystem::path path;
+		std::unique_ptr<IStripReader> reader;
+		std::vector<uint8_t> rows;
+		std::vector<uint8_t> converted_rows;
+	};
+
+	static std::unique_ptr<IStripReader> open_source(const std::filesystem::path& path)
+	{
+		if (auto reader = open_strip_reader(path)) return reader;
+
+		// Owned by the reader only (not cached), so the decoded image is released with the stream
+		logger_warning("%s cannot be streamed : the whole image is decoded first", path.string().c_str());
+		auto reader = make_image_strip_reader(load_image(path));
+		if (!reader) logger_error("failed to load %s : %s", path.string().c_str(), stbi_failure_reason());
+		return reader;
+	}
+
+	/** Read the next rows of source, converted to samples of Type. Return null on read error */
+	template <typename Type>
+	static const Type* read_strip(SourceStrip& source, const int row_count)
+	{
+		const size_t sample_count = static_cast<size_t>(source.reader->get_width()) * row_count * 4;
+		source.rows.resize(sample_count * source.reader->get_sample_size());
+		if (!source.reader->read_rows(source.rows.data(), row_count)) return nullptr;
+		if (source.reader->get_sample_size() == sizeof(Type)) return reinterpret_cast<const Type*>(source.rows.data());
+
+		source.converted_rows.resize(sample_count * sizeof(Type));
+		auto* converted = reinterpret_cast<Type*>(source.converted_rows.data());
+		const auto convert = [&](const auto* samples)
+		{
+			Executor::parallel_for(sample_count, 64 * 1024, [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i) converted[i] = Kernels::convert_sample<Type>(samples[i]);
+			});
+		};
+		if (source.reader->get_sample_size() == 1) convert(source.rows.data());
+		else convert(reinterpret_cast<const uint16_t*>(source.rows.data()));
+		return converted;
+	}
+
+	template <typename Type>
+	static bool pack_strips(const std::vector<StreamSource>& sources, std::vector<SourceStrip>& files, const std::vector<int>& source_files, IStripWriter& writer, const int strip_rows)
+	{
+		const int width = files[0].reader->get_width();
+		const int height = files[0].reader->get_height();
+		const auto channel_count = static_cast<int>(sources.size());
+
+		std::vector<Type> constants(channel_count);
+		for (int c = 0; c < channel_count; ++c) constants[c] = Kernels::convert_sample<Type>(sources[c].default_value);
+
+		std::vector<const Type*> file_rows(files.size());
+		std::vector<TChannelView<Type>> views(channel_count);
+		std::vector<Type> output(static_cast<size_t>(width) * strip_rows * channel_count);
+
+		for (int y = 0; y < height; y += strip_rows)
+		{
+			const int row_count = std::min(strip_rows, height - y);
+
+			// Each file is decoded on its own thread
+			std::atomic<bool> read_error = false;
+			Executor::parallel_for(files.size(), 1, [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					file_rows[i] = read_strip<Type>(files[i], row_count);
+					if (!file_rows[i])
+					{
+						logger_error("failed to read %s", files[i].path.string().c_str());
+						read_error = true;
+					}
+				}
+			});
+			if (read_error) return false;
+
+			for (int c = 0; c < channel_count; ++c)
+			{
+				if (source_files[c] >= 0) views[c] = TChannelView<Type>::interleaved(file_rows[source_files[c]], sources[c].source_channel, 4, width, row_count);
+				else views[c] = TChannelView<Type>::constant(&constants[c], width, row_count);
+			}
+
+			Executor::parallel_for_rows(row_count, static_cast<size_t>(width) * channel_count * sizeof(Type), [&](const int y_begin, const int y_end)
+			{
+				interleave_views(views.data(), channel_count, output.data() + static_cast<size_t>(y_begin) * width * channel_count, y_begin, y_end);
+			});
+
+			if (!writer.write_rows(output.data(), row_count)) return false;
+		}
+		return writer.finish();
+	}
+
+	bool stream_pack(const std::vector<StreamSource>& sources, const std::string& file_path, const std::string& format, int strip_rows)
+	{
+		trace_zone("stream pack");
+		strip_rows = std::max(strip_rows, 1);
+
+		// Each file is only read once, even if it is assigned to multiple channels
+		std::vector<SourceStrip> files;
+		std::vector<int> source_files(sources.size(), -1);
+		for (size_t c = 0; c < sources.size(); ++c)
+		{
+			if (sources[c].path.empty()) continue;
+
+			const auto it = std::ranges::find_if(files, [&](const SourceStrip& file) { return file.path == sources[c].path; });
+			if (it != files.end())
+			{
+				source_files[c] = static_cast<int>(it - files.begin());
+				continue;
+			}
+
+			auto reader = open_source(sources[c].path);
+			if (!reader) return false;
+			if (!files.empty() && (reader->get_width() != files[0].reader->get_width() || reader->get_height() != files[0].reader->get_height()))
+			{
+				logger_error("wrong image dimention : %s", sources[c].path.string().c_str());
+				return false;
+			}
+			source_files[c] = static_cast<int>(files.size());
+			files.push_back({ sources[c].path, std::move(reader), {}, {} });
+		}
+
+		if (files.empty() || sources.empty() || sources.size() > 4)
+		{
+			logger_error("cannot export current image combination");
+			return false;
+		}
+
+		const bool high_precision = format == "png" && std::ranges::any_of(files, [](const SourceStrip& file) { return file.reader->get_sample_size() > 1; });
+		const int sample_size = high_precision ? 2 : 1;
+		const auto writer = open_strip_writer(file_path, format, files[0].reader->get_width(), files[0].reader->get_height(), static_cast<int>(sources.size()), sample_size);
+		if (!writer)
+		{
+			logger_error("cannot stream %s to %s", format.c_str(), file_path.c_str());
+			return false;
+		}
+
+		return high_precision ? pack_strips<uint16_t>(sources, files, source_files, *writer, strip_rows) : pack_strips<uint8_t>(sources, files, source_files, *writer, strip_rows);
+	}
+}
@@ -0,0 +1,413 @@
+#include "StripReader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "Deflate.h"
+#include "RawImage.h"
+
+namespace SuperPacker
+{
+	static FILE* open_file(const std::filesystem::path& path)
+	{
+		FILE* file = nullptr;
+#if _WIN32
+		if (_wfopen_s(&file, path.c_str(), L"rb") != 0) file = nullptr;
+#else
+		file = fopen(path.c_str(), "rb");
+#endif
+		return file;
+	}
+
+	static bool seek_file(FILE* file, const uint64_t offset)
+	{
+#if _WIN32
+		return _fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+		return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+	}
+
+	static uint32_t read_big_endian(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 | static_cast<uint32_t>(data[2]) << 8 | data[3];
+	}
+
+	class FileStripReader : public IStripReader
+	{
+	public:
+		explicit FileStripReader(FILE* in_file)
+			: file(in_file) {}
+
+		~FileStripReader() override { fclose(file); }
+
+		FileStripReader(const FileStripReader&) = delete;
+		FileStripReader& operator=(const FileStripReader&) = delete;
+
+	protected:
+		bool read_bytes(void* destination, const size_t size) { return fread(destination, 1, size, file) == size; }
+
+		FILE* file;
+		int next_row = 0;
+	};
+
+	/**
+	 * Rows stored in file order (TGA and BMP). Bottom-up files are read strip by strip from the end.
+	 * RLE rows (TGA) are decoded sequentially, so they must be stored top-down.
+	 */
+	class RawStripReader final : public FileStripReader
+	{
+	public:
+		using PixelFormat = RawImageLayout::PixelFormat;
+
+		RawStripReader(FILE* in_file, const RawImageLayout& in_layout)
+			: FileStripReader(in_file), layout(in_layout)
+		{
+			width = layout.width;
+			height = layout.height;
+		}
+
+		bool read_rows(void* destination, const int row_count) override
+		{
+			if (row_count <= 0 || next_row + row_count > height) return false;
+
+			file_rows.resize(layout.row_size * row_count);
+			if (layout.rle)
+			{
+				if ((next_row == 0 && !seek_file(file, layout.data_offset)) || !decode_rle(file_rows.data(), file_rows.size())) return false;
+			}
+			else
+			{
+				const int first_row = layout.top_down ? next_row : height - next_row - row_count;
+				if (!seek_file(file, layout.data_offset + static_cast<uint64_t>(first_row) * layout.row_size) || !read_bytes(file_rows.data(), file_rows.size())) return false;
+			}
+
+			for (int r = 0; r < row_count; ++r)
+			{
+				const uint8_t* input = file_rows.data() + static_cast<size_t>(layout.top_down ? r : row_count - 1 - r) * layout.row_size;
+				uint8_t* output = static_cast<uint8_t*>(destination) + static_cast<size_t>(r) * width * 4;
+				for (int x = 0; x < width; ++x, output += 4)
+				{
+					switch (layout.format)
+					{
+					case PixelFormat::Gray:
+						output[0] = output[1] = output[2] = input[x];
+						output[3] = 255;
+						break;
+					case PixelFormat::GrayAlpha:
+						output[0] = output[1] = output[2] = input[x * 2];
+						output[3] = input[x * 2 + 1];
+						break;
+					case PixelFormat::Bgr:
+						output[0] = input[x * 3 + 2];
+						output[1] = input[x * 3 + 1];
+						output[2] = input[x * 3];
+						output[3] = 255;
+						break;
+					case PixelFormat::Bgra:
+						output[0] = input[x * 4 + 2];
+						output[1] = input[x * 4 + 1];
+						output[2] = input[x * 4];
+						output[3] = input[x * 4 + 3];
+						break;
+					}
+				}
+			}
+			next_row += row_count;
+			return true;
+		}
+
+	private:
+		/** Decode TGA packets until output is full. Packets can span several rows and strips */
+		bool decode_rle(uint8_t* output, const size_t size)
+		{
+			const auto pixel_size = static_cast<size_t>(layout.get_pixel_size());
+			for (size_t offset = 0; offset < size; offset += pixel_size)
+			{
+				if (packet_remaining == 0)
+				{
+					const int header = getc(file);
+					if (header == EOF) return false;
+					packet_remaining = (header & 0x7F) + 1;
+					packet_repeated = (header & 0x80) != 0;
+					if (packet_repeated && !read_bytes(packet_pixel, pixel_size)) return false;
+				}
+				if (packet_repeated) std::copy_n(packet_pixel, pixel_size, output + offset);
+				else if (!read_bytes(output + offset, pixel_size)) return false;
+				--packet_remaining;
+			}
+			return true;
+		}
+
+		const RawImageLayout layout;
+		std::vector<uint8_t> file_rows;
+		int packet_remaining = 0;
+		bool packet_repeated = false;
+		uint8_t packet_pixel[4] = {};
+	};
+
+	/** Non interlaced PNG : IDAT chunks are inflated and unfiltered one row at a time */
+	class PngStripReader final : public FileStripReader
+	{
+	public:
+		explicit PngStripReader(FILE* in_file)
+			: FileStripReader(in_file) {}
+
+		bool open()
+		{
+			static constexpr uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			uint8_t header[8];
+			if (!read_bytes(header, 8) || memcmp(header, signature, 8) != 0) return false;
+
+			int bit_depth = 0;
+			int interlace = 0;
+			while (true)
+			{
+				uint8_t chunk[8];
+				if (!read_bytes(chunk, 8)) return false;
+				const uint32_t length = read_big_endian(chunk);
+				if (memcmp(chunk + 4, "IDAT", 4) == 0)
+				{
+					idat_remaining = length;
+					break;
+				}
+
+				// Other chunks are skipped without being read
+				const bool known_chunk = memcmp(chunk + 4, "IHDR", 4) == 0 || memcmp(chunk + 4, "PLTE", 4) == 0 || memcmp(chunk + 4, "tRNS", 4) == 0;
+				std::vector<uint8_t> content(known_chunk ? length : 0);
+				if (!read_bytes(content.data(), content.size()) || fseek(file, static_cast<long>(length - content.size()) + 4, SEEK_CUR) != 0) return false;
+
+				if (memcmp(chunk + 4, "IHDR", 4) == 0 && length == 13)
+				{
+					width = static_cast<int>(read_big_endian(content.data()));
+					height = static_cast<int>(read_big_endian(content.data() + 4));
+					bit_depth = content[8];
+					color_type = content[9];
+					interlace = content[12];
+					if (content[10] != 0 || content[11] != 0) return false;
+				}
+				else if (memcmp(chunk + 4, "PLTE", 4) == 0)
+				{
+					palette.assign(256 * 4, 255);
+					for (uint32_t i = 0; i < std::min<uint32_t>(length / 3, 256); ++i) std::copy_n(content.data() + i * 3, 3, palette.data() + i * 4);
+				}
+				else if (memcmp(chunk + 4, "tRNS", 4) == 0)
+				{
+					transparency = content;
+				}
+				else if (memcmp(chunk + 4, "IEND", 4) == 0) return false;
+			}
+
+			static constexpr int color_channels[] = { 1, 0, 3, 1, 2, 0, 4 };
+			if (width <= 0 || height <= 0 || interlace != 0 || color_type > 6 || color_channels[color_type] == 0) return false;
+			if (bit_depth != 8 && (bit_depth != 16 || color_type == 3)) return false;
+			if (color_type == 3)
+			{
+				if (palette.empty()) return false;
+				for (size_t i = 0; i < std::min<size_t>(transparency.size(), 256); ++i) palette[i * 4 + 3] = transparency[i];
+			}
+
+			sample_size = bit_depth / 8;
+			pixel_size = color_channels[color_type] * sample_size;
+			row_size = static_cast<size_t>(width) * pixel_size;
+			previous_row.assign(row_size, 0);
+			current_row.resize(row_size + 1);
+			decoder = std::make_unique<Deflate::ZlibDecoder>([this](uint8_t* buffer, const size_t size) { return read_idat(buffer, size); });
+			return true;
+		}
+
+		bool read_rows(void* destination, const int row_count) override
+		{
+			if (row_count <= 0 || next_row + row_count > height) return false;
+			for (int r = 0; r < row_count; ++r)
+			{
+				if (!decoder->read(current_row.data(), current_row.size()) || !unfilter_row()) return false;
+				if (sample_size == 1) expand_row(static_cast<uint8_t*>(destination) + static_cast<size_t>(r) * width * 4);
+				else expand_row(static_cast<uint16_t*>(destination) + static_cast<size_t>(r) * width * 4);
+				std::copy(current_row.begin() + 1, current_row.end(), previous_row.begin());
+			}
+			next_row += row_count;
+			return true;
+		}
+
+	private:
+		/** Feed the decoder with the content of consecutive IDAT chunks */
+		size_t read_idat(uint8_t* buffer, const size_t size)
+		{
+			while (idat_remaining == 0)
+			{
+				uint8_t chunk[8];
+				if (idat_finished || fseek(file, 4, SEEK_CUR) != 0 || !read_bytes(chunk, 8) || memcmp(chunk + 4, "IDAT", 4) != 0)
+				{
+					idat_finished = true;
+					return 0;
+				}
+				idat_remaining = read_big_endian(chunk);
+			}
+			const size_t read = fread(buffer, 1, std::min<size_t>(size, idat_remaining), file);
+			idat_remaining -= static_cast<uint32_t>(read);
+			return read;
+		}
+
+		bool unfilter_row()
+		{
+			const uint8_t filter = current_row[0];
+			uint8_t* row = current_row.data() + 1;
+			const uint8_t* up = previous_row.data();
+			const size_t left_offset = pixel_size;
+			for (size_t i = 0; i < row_size; ++i)
+			{
+				const int left = i >= left_offset ? row[i - left_offset] : 0;
+				const int up_left = i >= left_offset ? up[i - left_offset] : 0;
+				switch (filter)
+				{
+				case 0: break;
+				case 1: row[i] = static_cast<uint8_t>(row[i] + left); break;
+				case 2: row[i] = static_cast<uint8_t>(row[i] + up[i]); break;
+				case 3: row[i] = static_cast<uint8_t>(row[i] + ((left + up[i]) >> 1)); break;
+				case 4:
+				{
+					const int p = left + up[i] - up_left;
+					const int pa = std::abs(p - left);
+					const int pb = std::abs(p - up[i]);
+					const int pc = std::abs(p - up_left);
+					row[i] = static_cast<uint8_t>(row[i] + (pa <= pb && pa <= pc ? left : pb <= pc ? up[i] : up_left));
+					break;
+				}
+				default: return false;
+				}
+			}
+			return true;
+		}
+
+		/** Convert the current row to RGBA, applying palette and transparency */
+		template <typename Type>
+		void expand_row(Type* output) const
+		{
+			constexpr Type opaque = std::numeric_limits<Type>::max();
+			const uint8_t* row = current_row.data() + 1;
+			const auto sample = [&](const size_t index) -> Type
+			{
+				if constexpr (sizeof(Type) == 1) return row[index];
+				else return static_cast<Type>(row[index * 2] << 8 | row[index * 2 + 1]);
+			};
+			const auto transparent_value = [&](const size_t index) { return static_cast<Type>(transparency[index * 2] << 8 | transparency[index * 2 + 1]); };
+
+			for (size_t x = 0; x < static_cast<size_t>(width); ++x, output += 4)
+			{
+				switch (color_type)
+				{
+				case 0:
+					output[0] = output[1] = output[2] = sample(x);
+					output[3] = transparency.size() >= 2 && output[0] == transparent_value(0) ? 0 : opaque;
+					break;
+				case 2:
+					for (size_t c = 0; c < 3; ++c) output[c] = sample(x * 3 + c);
+					output[3] = transparency.size() >= 6 && output[0] == transparent_value(0) && output[1] == transparent_value(1) && output[2] == transparent_value(2) ? 0 : opaque;
+					break;
+				case 3:
+					std::copy_n(palette.data() + static_cast<size_t>(row[x]) * 4, 4, output);
+					break;
+				case 4:
+					output[0] = output[1] = output[2] = sample(x * 2);
+					output[3] = sample(x * 2 + 1);
+					break;
+				default:
+					for (size_t c = 0; c < 4; ++c) output[c] = sample(x * 4 + c);
+					break;
+				}
+			}
+		}
+
+		int color_type = 0;
+		int pixel_size = 0;
+		size_t row_size = 0;
+		uint32_t idat_remaining = 0;
+		bool idat_finished = false;
+		std::vector<uint8_t> palette;
+		std::vector<uint8_t> transparency;
+		std::vector<uint8_t> previous_row;
+		std::vector<uint8_t> current_row;
+		std::unique_ptr<Deflate::ZlibDecoder> decoder;
+	};
+
+	/** Interleave rows of an image already decoded */
+	class ImageStripReader final : public IStripReader
+	{
+	public:
+		explicit ImageStripReader(std::shared_ptr<const IImage> in_image)
+			: image(std::move(in_image))
+		{
+			width = image->get_width();
+			height = image->get_height();
+			sample_size = dynamic_cast<const Image*>(image.get()) ? 1 : 2;
+		}
+
+		bool read_rows(void* destination, const int row_count) override
+		{
+			if (row_count <= 0 || next_row + row_count > height) return false;
+
+			if (auto* ldr_image = dynamic_cast<const Image*>(image.get())) read_views(*ldr_image, static_cast<uint8_t*>(destination), row_count);
+			else if (auto* image_16 = dynamic_cast<const Image16*>(image.get())) read_views(*image_16, static_cast<uint16_t*>(destination), row_count);
+			else if (auto* hdr_image = dynamic_cast<const HdrImage*>(image.get())) read_views(*hdr_image, static_cast<uint16_t*>(destination), row_count);
+			else return false;
+
+			next_row += row_count;
+			return true;
+		}
+
+	private:
+		template <typename Type, typename OutputType>
+		void read_views(const TImage<Type>& source, OutputType* destination, const int row_count) const
+		{
+			TChannelView<Type> views[4];
+			for (int c = 0; c < 4; ++c) views[c] = source.get_channel_view(c);
+
+			if constexpr (std::is_same_v<Type, OutputType>)
+			{
+				interleave_views(views, 4, destination, next_row, next_row + row_count);
+			}
+			else
+			{
+				for (int y = next_row; y < next_row + row_count; ++y)
+					for (int x = 0; x < width; ++x)
+						for (int c = 0; c < 4; ++c) *destination++ = Kernels::convert_sample<OutputType>(views[c].at(x, y));
+			}
+		}
+
+		std::shared_ptr<const IImage> image;
+		int next_row = 0;
+	};
+
+	std::unique_ptr<IStripReader> open_strip_reader(const std::filesystem::path& path)
+	{
+		FILE* file = open_file(path);
+		if (!file) return nullptr;
+
+		uint8_t header[raw_image_header_size] = {};
+		const size_t header_size = fread(header, 1, sizeof(header), file);
+		rewind(file);
+
+		if (header_size >= 8 && header[0] == 0x89 && header[1] == 'P' && header[2] == 'N' && header[3] == 'G')
+		{
+			auto reader = std::make_unique<PngStripReader>(file);
+			if (reader->open()) return reader;
+			return nullptr;
+		}
+
+		if (const auto layout = parse_raw_image_header(header, header_size, path)) return std::make_unique<RawStripReader>(file, *layout);
+
+		fclose(file);
+		return nullptr;
+	}
+
+	std::unique_ptr<IStripReader> make_image_strip_reader(std::shared_ptr<const IImage> image)
+	{
+		if (!image || !image->is_valid()) return nullptr;
+		return std::make_unique<ImageStripReader>(std::move(image));
+	}
+}
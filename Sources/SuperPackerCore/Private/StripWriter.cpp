@@ -0,0 +1,522 @@
+#include "StripWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "stb_image_write.h"
+
+#include "Deflate.h"
+#include "Executor.h"
+#include "OutputFile.h"
+
+namespace SuperPacker
+{
+	static std::atomic<int> png_compression_level = 8;
+	static std::atomic<PngFilter> png_filter = PngFilter::Adaptive;
+	static std::atomic<int> jpeg_quality = 90;
+	static std::atomic<Jpeg::Subsampling> jpeg_subsampling = Jpeg::Subsampling::S420;
+
+	static void put_little_endian(uint8_t* destination, const uint32_t value, const int bytes)
+	{
+		for (int i = 0; i < bytes; ++i) destination[i] = static_cast<uint8_t>(value >> i * 8);
+	}
+
+	static void put_big_endian(uint8_t* destination, const uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i) destination[i] = static_cast<uint8_t>(value >> (24 - i * 8));
+	}
+
+	class FileStripWriter : public IStripWriter
+	{
+	public:
+		FileStripWriter(std::unique_ptr<OutputFile> in_file, const int in_width, const int in_height, const int in_channels)
+			: file(std::move(in_file)), width(in_width), height(in_height), channels(in_channels) {}
+
+	protected:
+		bool write_bytes(const void* data, const size_t size) { return file->write(data, size); }
+
+		/** Replace the destination file once every row was written. An incomplete file is discarded */
+		bool close_file()
+		{
+			if (!file || next_row != height) return false;
+			const bool committed = file->commit();
+			file = nullptr;
+			return committed;
+		}
+
+		/** Validate and advance the current row */
+		bool begin_rows(const int row_count)
+		{
+			if (!file || row_count <= 0 || next_row + row_count > height) return false;
+			next_row += row_count;
+			return true;
+		}
+
+		std::unique_ptr<OutputFile> file;
+		const int width;
+		const int height;
+		const int channels;
+		int next_row = 0;
+	};
+
+	/** Uncompressed or RLE true color / grayscale TGA, written top-down */
+	class TgaStripWriter final : public FileStripWriter
+	{
+	public:
+		TgaStripWriter(std::unique_ptr<OutputFile> in_file, const int in_width, const int in_height, const int in_channels)
+			: FileStripWriter(std::move(in_file), in_width, in_height, in_channels), rle(stbi_write_tga_with_rle != 0) {}
+
+		bool write_header()
+		{
+			const bool has_alpha = channels == 2 || channels == 4;
+			const bool gray = channels <= 2;
+			uint8_t header[18] = {};
+			header[2] = static_cast<uint8_t>((gray ? 3 : 2) + (rle ? 8 : 0));
+			put_little_endian(header + 12, width, 2);
+			put_little_endian(header + 14, height, 2);
+			header[16] = static_cast<uint8_t>(channels * 8);
+			header[17] = static_cast<uint8_t>((has_alpha ? 8 : 0) | 0x20);
+			return write_bytes(header, sizeof(header));
+		}
+
+		bool write_rows(const void* rows, const int row_count) override
+		{
+			if (!begin_rows(row_count)) return false;
+
+			const size_t row_size = static_cast<size_t>(width) * channels;
+			const auto* input = static_cast<const uint8_t*>(rows);
+			std::vector<uint8_t> pixels(row_size);
+			encoded.clear();
+			for (int r = 0; r < row_count; ++r, input += row_size)
+			{
+				// TGA pixels are stored as BGR(A)
+				std::copy_n(input, row_size, pixels.data());
+				if (channels >= 3)
+					for (size_t i = 0; i < row_size; i += channels) std::swap(pixels[i], pixels[i + 2]);
+
+				if (rle) encode_rle(pixels.data());
+				else encoded.insert(encoded.end(), pixels.begin(), pixels.end());
+			}
+			return write_bytes(encoded.data(), encoded.size());
+		}
+
+		bool finish() override { return close_file(); }
+
+	private:
+		/** Same packets as stb_image_write : packets never cross rows and contain at most 128 pixels */
+		void encode_rle(const uint8_t* row)
+		{
+			const auto pixel = [&](const int x) { return row + static_cast<size_t>(x) * channels; };
+			for (int x = 0; x < width;)
+			{
+				int length = 1;
+				bool repeated = false;
+				if (x < width - 1)
+				{
+					repeated = memcmp(pixel(x), pixel(x + 1), channels) == 0;
+					length = 2;
+					for (int k = x + 2; k < width && length < 128; ++k)
+					{
+						// Literal packets stop before the next repeated pixels
+						const bool same = memcmp(pixel(k - 1), pixel(k), channels) == 0;
+						if (repeated != same)
+						{
+							if (!repeated) --length;
+							break;
+						}
+						++length;
+					}
+				}
+
+				if (repeated)
+				{
+					encoded.push_back(static_cast<uint8_t>(0x80 | (length - 1)));
+					encoded.insert(encoded.end(), pixel(x), pixel(x) + channels);
+				}
+				else
+				{
+					encoded.push_back(static_cast<uint8_t>(length - 1));
+					encoded.insert(encoded.end(), pixel(x), pixel(x + length));
+				}
+				x += length;
+			}
+		}
+
+		const bool rle;
+		std::vector<uint8_t> encoded;
+	};
+
+	/** 24 bits BMP written top-down (negative height). Gray channels are expanded and alpha is dropped, like stb_image_write */
+	class BmpStripWriter final : public FileStripWriter
+	{
+	public:
+		BmpStripWriter(std::unique_ptr<OutputFile> in_file, const int in_width, const int in_height, const int in_channels)
+			: FileStripWriter(std::move(in_file), in_width, in_height, in_channels), row_size((static_cast<size_t>(in_width) * 3 + 3) & ~static_cast<size_t>(3)) {}
+
+		bool write_header()
+		{
+			const uint64_t data_size = static_cast<uint64_t>(row_size) * height;
+			if (data_size + 54 > std::numeric_limits<uint32_t>::max()) return false;
+
+			uint8_t header[54] = { 'B', 'M' };
+			put_little_endian(header + 2, static_cast<uint32_t>(data_size + 54), 4);
+			put_little_endian(header + 10, 54, 4);
+			put_little_endian(header + 14, 40, 4);
+			put_little_endian(header + 18, width, 4);
+			put_little_endian(header + 22, static_cast<uint32_t>(-height), 4);
+			put_little_endian(header + 26, 1, 2);
+			put_little_endian(header + 28, 24, 2);
+			put_little_endian(header + 34, static_cast<uint32_t>(data_size), 4);
+			return write_bytes(header, sizeof(header));
+		}
+
+		bool write_rows(const void* rows, const int row_count) override
+		{
+			if (!begin_rows(row_count)) return false;
+
+			encoded.assign(row_size * row_count, 0);
+			const auto* input = static_cast<const uint8_t*>(rows);
+			for (int r = 0; r < row_count; ++r)
+			{
+				uint8_t* output = encoded.data() + static_cast<size_t>(r) * row_size;
+				for (int x = 0; x < width; ++x, input += channels, output += 3)
+				{
+					output[0] = input[channels >= 3 ? 2 : 0];
+					output[1] = input[channels >= 3 ? 1 : 0];
+					output[2] = input[0];
+				}
+			}
+			return write_bytes(encoded.data(), encoded.size());
+		}
+
+		bool finish() override { return close_file(); }
+
+	private:
+		const size_t row_size;
+		std::vector<uint8_t> encoded;
+	};
+
+	static uint8_t paeth(const int a, const int b, const int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+	}
+
+	/**
+	 * Filter a scanline of big endian bytes. Adaptive tries every filter and keeps the one with the smallest sum of absolute values (same heuristic as stb) :
+	 * candidates alternate between output and scratch (row_size bytes, only used by Adaptive), so the best one is copied at most once
+	 */
+	static void filter_png_row(const uint8_t* row, const uint8_t* previous_row, const size_t row_size, const int pixel_size, const PngFilter mode, uint8_t* output, uint8_t* scratch)
+	{
+		const int first_filter = mode == PngFilter::Adaptive ? 0 : static_cast<int>(mode);
+		const int last_filter = mode == PngFilter::Adaptive ? 4 : static_cast<int>(mode);
+
+		uint8_t* best = nullptr;
+		int best_sum = std::numeric_limits<int>::max();
+		for (int filter = first_filter; filter <= last_filter; ++filter)
+		{
+			uint8_t* candidate = best == output + 1 ? scratch : output + 1;
+			int sum = 0;
+			for (size_t i = 0; i < row_size; ++i)
+			{
+				const int left = i >= static_cast<size_t>(pixel_size) ? row[i - pixel_size] : 0;
+				const int up = previous_row ? previous_row[i] : 0;
+				const int up_left = previous_row && i >= static_cast<size_t>(pixel_size) ? previous_row[i - pixel_size] : 0;
+				uint8_t value = row[i];
+				switch (filter)
+				{
+				case 1: value = static_cast<uint8_t>(value - left); break;
+				case 2: value = static_cast<uint8_t>(value - up); break;
+				case 3: value = static_cast<uint8_t>(value - ((left + up) >> 1)); break;
+				case 4: value = static_cast<uint8_t>(value - paeth(left, up, up_left)); break;
+				default: break;
+				}
+				candidate[i] = value;
+				sum += std::abs(static_cast<int8_t>(value));
+			}
+			if (sum < best_sum)
+			{
+				best_sum = sum;
+				best = candidate;
+				output[0] = static_cast<uint8_t>(filter);
+			}
+		}
+		if (best != output + 1) std::copy_n(best, row_size, output + 1);
+	}
+
+	/**
+	 * 8 or 16 bits PNG. Rows are filtered in parallel, then deflated by independent chunks on every thread
+	 * (see Deflate::ZlibEncoder), and the resulting zlib stream is split into IDAT chunks of about 64KB
+	 */
+	class PngStripWriter final : public FileStripWriter
+	{
+	public:
+		PngStripWriter(std::unique_ptr<OutputFile> in_file, const int in_width, const int in_height, const int in_channels, const int in_sample_size)
+			: FileStripWriter(std::move(in_file), in_width, in_height, in_channels), sample_size(in_sample_size),
+			  row_size(static_cast<size_t>(in_width) * in_channels * in_sample_size), filter(png_filter),
+			  encoder(png_compression_level, deflate_chunk_size) {}
+
+		bool write_header()
+		{
+			static constexpr uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			static constexpr uint8_t color_types[] = { 0, 0, 4, 2, 6 };
+
+			uint8_t header[13] = {};
+			put_big_endian(header, width);
+			put_big_endian(header + 4, height);
+			header[8] = static_cast<uint8_t>(sample_size * 8);
+			header[9] = color_types[channels];
+			return write_bytes(signature, sizeof(signature)) && write_chunk("IHDR", header, sizeof(header));
+		}
+
+		bool write_rows(const void* rows, const int row_count) override
+		{
+			if (!begin_rows(row_count)) return false;
+
+			// Png samples are big endian
+			strip.resize(row_size * row_count);
+			if (sample_size == 2)
+			{
+				const auto* samples = static_cast<const uint16_t*>(rows);
+				Executor::parallel_for_rows(row_count, row_size, [&](const int y_begin, const int y_end)
+				{
+					for (size_t i = static_cast<size_t>(y_begin) * row_size / 2; i < static_cast<size_t>(y_end) * row_size / 2; ++i)
+					{
+						strip[i * 2] = static_cast<uint8_t>(samples[i] >> 8);
+						strip[i * 2 + 1] = static_cast<uint8_t>(samples[i]);
+					}
+				});
+			}
+			else
+			{
+				std::copy_n(static_cast<const uint8_t*>(rows), strip.size(), strip.data());
+			}
+
+			// The first row of the strip is filtered against the last row of the previous strip
+			filtered.resize((row_size + 1) * row_count);
+			if (filter == PngFilter::Adaptive) filter_scratch.resize(row_size * row_count);
+			Executor::parallel_for(row_count, 1, [&](const size_t y_begin, const size_t y_end)
+			{
+				for (size_t y = y_begin; y < y_end; ++y)
+				{
+					const uint8_t* previous = y ? strip.data() + (y - 1) * row_size : previous_row.empty() ? nullptr : previous_row.data();
+					uint8_t* scratch = filter_scratch.empty() ? nullptr : filter_scratch.data() + y * row_size;
+					filter_png_row(strip.data() + y * row_size, previous, row_size, channels * sample_size, filter, filtered.data() + y * (row_size + 1), scratch);
+				}
+			});
+			previous_row.assign(strip.end() - static_cast<ptrdiff_t>(row_size), strip.end());
+
+			encoder.write(filtered.data(), filtered.size(), compressed);
+			return write_compressed(false);
+		}
+
+		bool finish() override
+		{
+			encoder.finish(compressed);
+			return write_compressed(true) && write_chunk("IEND", nullptr, 0) && close_file();
+		}
+
+	private:
+		bool write_chunk(const char* type, const uint8_t* data, const size_t size)
+		{
+			uint8_t length[4];
+			put_big_endian(length, static_cast<uint32_t>(size));
+			uint8_t crc[4];
+			put_big_endian(crc, Deflate::crc32(data, size, Deflate::crc32(reinterpret_cast<const uint8_t*>(type), 4)));
+			return write_bytes(length, 4) && write_bytes(type, 4) && (size == 0 || write_bytes(data, size)) && write_bytes(crc, 4);
+		}
+
+		/** Emit compressed data as IDAT chunks of 64KB (and the remaining bytes once the stream is complete) */
+		bool write_compressed(const bool complete)
+		{
+			constexpr size_t chunk_size = 64 * 1024;
+			size_t offset = 0;
+			while (compressed.size() - offset >= chunk_size || (complete && offset < compressed.size()))
+			{
+				const size_t size = std::min(chunk_size, compressed.size() - offset);
+				if (!write_chunk("IDAT", compressed.data() + offset, size)) return false;
+				offset += size;
+			}
+			compressed.erase(compressed.begin(), compressed.begin() + static_cast<ptrdiff_t>(offset));
+			return true;
+		}
+
+		/** Filtered bytes deflated by each thread */
+		static constexpr size_t deflate_chunk_size = 256 * 1024;
+
+		const int sample_size;
+		const size_t row_size;
+		const PngFilter filter;
+		Deflate::ZlibEncoder encoder;
+		std::vector<uint8_t> strip;
+		std::vector<uint8_t> filtered;
+		std::vector<uint8_t> filter_scratch; // rejected candidates of adaptive filtering, one row per strip row
+		std::vector<uint8_t> previous_row;
+		std::vector<uint8_t> compressed;
+	};
+
+	void set_png_compression_level(const int level)
+	{
+		png_compression_level = std::clamp(level, 0, 9);
+	}
+
+	int get_png_compression_level()
+	{
+		return png_compression_level;
+	}
+
+	void set_png_filter(const PngFilter filter)
+	{
+		png_filter = filter;
+	}
+
+	PngFilter get_png_filter()
+	{
+		return png_filter;
+	}
+
+	bool parse_png_filter(const std::string& name, PngFilter& filter)
+	{
+		static constexpr const char* names[] = { "none", "sub", "up", "average", "paeth", "adaptive" };
+		for (int i = 0; i < 6; ++i)
+		{
+			if (name != names[i]) continue;
+			filter = static_cast<PngFilter>(i);
+			return true;
+		}
+		return false;
+	}
+
+	/** Baseline jpeg. Rows are buffered until there is a restart interval for every thread, then encoded in parallel */
+	class JpegStripWriter final : public FileStripWriter
+	{
+	public:
+		JpegStripWriter(std::unique_ptr<OutputFile> in_file, const int in_width, const int in_height, const int in_channels)
+			: FileStripWriter(std::move(in_file), in_width, in_height, in_channels), row_size(static_cast<size_t>(in_width) * in_channels),
+			  encoder(in_width, in_height, in_channels, jpeg_quality, jpeg_subsampling) {}
+
+		bool write_header()
+		{
+			encoder.write_header(encoded);
+			return write_encoded();
+		}
+
+		bool write_rows(const void* rows, const int row_count) override
+		{
+			if (!begin_rows(row_count)) return false;
+
+			const auto* samples = static_cast<const uint8_t*>(rows);
+			pending.insert(pending.end(), samples, samples + row_size * row_count);
+
+			const size_t interval_size = row_size * encoder.get_interval_rows();
+			const size_t batch_size = interval_size * std::max<size_t>(Executor::get_thread_count(), 1);
+			if (pending.size() < batch_size) return true;
+
+			const size_t complete_size = pending.size() / interval_size * interval_size;
+			encoder.write_rows(pending.data(), static_cast<int>(complete_size / row_size), encoded);
+			pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(complete_size));
+			return write_encoded();
+		}
+
+		bool finish() override
+		{
+			if (!pending.empty()) encoder.write_rows(pending.data(), static_cast<int>(pending.size() / row_size), encoded);
+			encoder.finish(encoded);
+			return write_encoded() && close_file();
+		}
+
+	private:
+		bool write_encoded()
+		{
+			const bool success = write_bytes(encoded.data(), encoded.size());
+			encoded.clear();
+			return success;
+		}
+
+		const size_t row_size;
+		Jpeg::Encoder encoder;
+		std::vector<uint8_t> pending;
+		std::vector<uint8_t> encoded;
+	};
+
+	void set_jpeg_quality(const int quality)
+	{
+		jpeg_quality = std::clamp(quality, 1, 100);
+	}
+
+	int get_jpeg_quality()
+	{
+		return jpeg_quality;
+	}
+
+	void set_jpeg_subsampling(const Jpeg::Subsampling subsampling)
+	{
+		jpeg_subsampling = subsampling;
+	}
+
+	Jpeg::Subsampling get_jpeg_subsampling()
+	{
+		return jpeg_subsampling;
+	}
+
+	bool parse_jpeg_subsampling(const std::string& name, Jpeg::Subsampling& subsampling)
+	{
+		static constexpr const char* names[] = { "444", "422", "420" };
+		for (int i = 0; i < 3; ++i)
+		{
+			if (name != names[i]) continue;
+			subsampling = static_cast<Jpeg::Subsampling>(i);
+			return true;
+		}
+		return false;
+	}
+
+	bool can_write_strips(const std::string& format, const int sample_size)
+	{
+		if (format == "png") return sample_size == 1 || sample_size == 2;
+		return (format == "tga" || format == "bmp" || format == "jpg") && sample_size == 1;
+	}
+
+	std::unique_ptr<IStripWriter> open_strip_writer(const std::string& file_path, const std::string& format, const int width, const int height, const int channels, const int sample_size)
+	{
+		if (!can_write_strips(format, sample_size) || width <= 0 || height <= 0 || channels < 1 || channels > 4) return nullptr;
+		if ((format == "tga" || format == "jpg") && (width > 0xFFFF || height > 0xFFFF)) return nullptr;
+
+		// Uncompressed files have a known size, reserved up front
+		uint64_t expected_size = 0;
+		if (format == "bmp") expected_size = 54 + ((static_cast<uint64_t>(width) * 3 + 3) & ~static_cast<uint64_t>(3)) * height;
+		else if (format == "tga" && !stbi_write_tga_with_rle) expected_size = 18 + static_cast<uint64_t>(width) * height * channels;
+
+		auto file = OutputFile::create(file_path, expected_size);
+		if (!file) return nullptr;
+
+		if (format == "png")
+		{
+			auto writer = std::make_unique<PngStripWriter>(std::move(file), width, height, channels, sample_size);
+			if (writer->write_header()) return writer;
+		}
+		else if (format == "tga")
+		{
+			auto writer = std::make_unique<TgaStripWriter>(std::move(file), width, height, channels);
+			if (writer->write_header()) return writer;
+		}
+		else if (format == "jpg")
+		{
+			auto writer = std::make_unique<JpegStripWriter>(std::move(file), width, height, channels);
+			if (writer->write_header()) return writer;
+		}
+		else
+		{
+			auto writer = std::make_unique<BmpStripWriter>(std::move(file), width, height, channels);
+			if (writer->write_header()) return writer;
+		}
+		return nullptr;
+	}
+}
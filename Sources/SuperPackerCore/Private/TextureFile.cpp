@@ -0,0 +1,130 @@
+#include "TextureFile.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "OutputFile.h"
+
+namespace SuperPacker
+{
+	// Optional is not trivially copyable, so the default is stored as -1
+	static std::atomic<int> texture_block_format = -1;
+
+	static void put_uint32(std::vector<uint8_t>& output, const size_t offset, const uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i) output[offset + i] = static_cast<uint8_t>(value >> i * 8);
+	}
+
+	static uint32_t four_cc(const char* code)
+	{
+		return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 | static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+	}
+
+	static std::vector<uint8_t> make_dds_header(const BlockCompression::Format block_format, const std::vector<TextureLevel>& levels)
+	{
+		constexpr uint32_t caps = 0x1, height = 0x2, width = 0x4, pixel_format = 0x1000, mipmap_count = 0x20000, linear_size = 0x80000;
+		constexpr uint32_t caps_complex = 0x8, caps_texture = 0x1000, caps_mipmap = 0x400000;
+		const bool has_mips = levels.size() > 1;
+		const bool dx10 = block_format == BlockCompression::Format::BC7;
+
+		std::vector<uint8_t> header(4 + 124 + (dx10 ? 20 : 0));
+		std::memcpy(header.data(), "DDS ", 4);
+		put_uint32(header, 4, 124);
+		put_uint32(header, 8, caps | height | width | pixel_format | linear_size | (has_mips ? mipmap_count : 0));
+		put_uint32(header, 12, levels[0].height);
+		put_uint32(header, 16, levels[0].width);
+		put_uint32(header, 20, static_cast<uint32_t>(levels[0].blocks.size()));
+		put_uint32(header, 28, static_cast<uint32_t>(levels.size()));
+
+		// Pixel format
+		put_uint32(header, 76, 32);
+		put_uint32(header, 80, 0x4);
+		switch (block_format)
+		{
+		case BlockCompression::Format::BC1: put_uint32(header, 84, four_cc("DXT1")); break;
+		case BlockCompression::Format::BC3: put_uint32(header, 84, four_cc("DXT5")); break;
+		case BlockCompression::Format::BC4: put_uint32(header, 84, four_cc("ATI1")); break;
+		case BlockCompression::Format::BC5: put_uint32(header, 84, four_cc("ATI2")); break;
+		case BlockCompression::Format::BC7: put_uint32(header, 84, four_cc("DX10")); break;
+		}
+		put_uint32(header, 108, caps_texture | (has_mips ? caps_complex | caps_mipmap : 0));
+
+		if (dx10)
+		{
+			put_uint32(header, 128, 98); // DXGI_FORMAT_BC7_UNORM
+			put_uint32(header, 132, 3);  // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+			put_uint32(header, 140, 1);  // array size
+		}
+		return header;
+	}
+
+	static std::vector<uint8_t> make_ktx_header(const BlockCompression::Format block_format, const std::vector<TextureLevel>& levels)
+	{
+		static constexpr uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+		uint32_t internal_format = 0, base_format = 0;
+		switch (block_format)
+		{
+		case BlockCompression::Format::BC1: internal_format = 0x83F0; base_format = 0x1907; break; // COMPRESSED_RGB_S3TC_DXT1, RGB
+		case BlockCompression::Format::BC3: internal_format = 0x83F3; base_format = 0x1908; break; // COMPRESSED_RGBA_S3TC_DXT5, RGBA
+		case BlockCompression::Format::BC4: internal_format = 0x8DBB; base_format = 0x1903; break; // COMPRESSED_RED_RGTC1, RED
+		case BlockCompression::Format::BC5: internal_format = 0x8DBD; base_format = 0x8227; break; // COMPRESSED_RG_RGTC2, RG
+		case BlockCompression::Format::BC7: internal_format = 0x8E8C; base_format = 0x1908; break; // COMPRESSED_RGBA_BPTC_UNORM, RGBA
+		}
+
+		std::vector<uint8_t> header(64);
+		std::memcpy(header.data(), identifier, sizeof(identifier));
+		put_uint32(header, 12, 0x04030201);
+		put_uint32(header, 20, 1); // type size
+		put_uint32(header, 28, internal_format);
+		put_uint32(header, 32, base_format);
+		put_uint32(header, 36, levels[0].width);
+		put_uint32(header, 40, levels[0].height);
+		put_uint32(header, 52, 1); // faces
+		put_uint32(header, 56, static_cast<uint32_t>(levels.size()));
+		return header;
+	}
+
+	void set_texture_block_format(const std::optional<BlockCompression::Format> format)
+	{
+		texture_block_format = format ? static_cast<int>(*format) : -1;
+	}
+
+	std::optional<BlockCompression::Format> get_texture_block_format()
+	{
+		const int format = texture_block_format;
+		if (format < 0) return {};
+		return static_cast<BlockCompression::Format>(format);
+	}
+
+	bool is_texture_format(const std::string& format)
+	{
+		return format == "dds" || format == "ktx";
+	}
+
+	bool write_texture_file(const std::string& file_path, const std::string& format, const BlockCompression::Format block_format, const std::vector<TextureLevel>& levels)
+	{
+		if (!is_texture_format(format) || levels.empty()) return false;
+
+		const bool ktx = format == "ktx";
+		const auto header = ktx ? make_ktx_header(block_format, levels) : make_dds_header(block_format, levels);
+
+		uint64_t expected_size = header.size();
+		for (const auto& level : levels) expected_size += level.blocks.size() + (ktx ? 4 : 0);
+
+		const auto file = OutputFile::create(file_path, expected_size);
+		if (!file || !file->write(header.data(), header.size())) return false;
+		for (const auto& level : levels)
+		{
+			// Ktx levels are prefixed by their size. Blocks are a multiple of 8 bytes, so no padding is needed
+			if (ktx)
+			{
+				std::vector<uint8_t> image_size(4);
+				put_uint32(image_size, 0, static_cast<uint32_t>(level.blocks.size()));
+				if (!file->write(image_size.data(), image_size.size())) return false;
+			}
+			if (!file->write(level.blocks.data(), level.blocks.size())) return false;
+		}
+		return file->commit();
+	}
+}
@@ -0,0 +1,162 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Executor.h"
+#include "Logger.h"
+#include "OutputFile.h"
+
+namespace SuperPacker::Trace
+{
+	struct Event
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t duration;
+	};
+
+	/** Zones of one thread. Only its own thread records, so the lock is only contended while the trace is written */
+	struct ThreadBuffer
+	{
+		std::mutex lock;
+		std::vector<Event> events;
+		size_t recorded = 0; // next event goes to events[recorded % ring_size]
+		int thread_id = 0;
+		std::string thread_name;
+	};
+
+	static const auto epoch = std::chrono::steady_clock::now();
+	static std::atomic<bool> enabled = false;
+	static std::mutex buffers_lock;
+	static std::vector<std::shared_ptr<ThreadBuffer>> buffers; // kept after their thread exits
+	static std::filesystem::path output_path;
+
+	/** Write the trace at exit if an output was set */
+	static struct ExitWriter
+	{
+		~ExitWriter()
+		{
+			std::filesystem::path path;
+			{
+				std::lock_guard lock(buffers_lock);
+				path = output_path;
+			}
+			if (!path.empty() && write(path)) logger_validate("trace written to %s", path.string().c_str());
+		}
+	} exit_writer;
+
+	static ThreadBuffer& get_thread_buffer()
+	{
+		thread_local std::shared_ptr<ThreadBuffer> buffer;
+		if (buffer) return *buffer;
+
+		buffer = std::make_shared<ThreadBuffer>();
+		buffer->events.resize(ring_size);
+		const uint8_t worker_id = Executor::get_worker_id();
+
+		std::lock_guard lock(buffers_lock);
+		buffer->thread_id = static_cast<int>(buffers.size()) + 1;
+		buffer->thread_name = worker_id != 255 ? "worker " + std::to_string(worker_id) : "thread " + std::to_string(buffer->thread_id);
+		buffers.push_back(buffer);
+		return *buffer;
+	}
+
+	void set_enabled(const bool in_enabled)
+	{
+		enabled = in_enabled;
+	}
+
+	bool is_enabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	void set_output(const std::filesystem::path& path)
+	{
+		{
+			std::lock_guard lock(buffers_lock);
+			output_path = path;
+		}
+		if (!path.empty()) set_enabled(true);
+	}
+
+	uint64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	void Zone::record(const char* name, const uint64_t start, const uint64_t duration)
+	{
+		auto& buffer = get_thread_buffer();
+		std::lock_guard lock(buffer.lock);
+		buffer.events[buffer.recorded++ % ring_size] = { name, start, duration };
+	}
+
+	void clear()
+	{
+		std::lock_guard lock(buffers_lock);
+		for (const auto& buffer : buffers)
+		{
+			std::lock_guard buffer_lock(buffer->lock);
+			buffer->recorded = 0;
+		}
+	}
+
+	static void append_escaped(std::string& json, const std::string& text)
+	{
+		json += '"';
+		for (const char character : text)
+		{
+			if (character == '"' || character == '\\') json += '\\';
+			json += character;
+		}
+		json += '"';
+	}
+
+	bool write(const std::filesystem::path& path)
+	{
+		// Complete events ("X") with timestamps in microseconds, and the name of each thread as metadata
+		std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		char numbers[128];
+		{
+			std::lock_guard lock(buffers_lock);
+			for (const auto& buffer : buffers)
+			{
+				std::lock_guard buffer_lock(buffer->lock);
+				json += first ? "\n" : ",\n";
+				first = false;
+				snprintf(numbers, sizeof(numbers), "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", buffer->thread_id);
+				json += numbers;
+				append_escaped(json, buffer->thread_name);
+				json += "}}";
+
+				const size_t count = std::min(buffer->recorded, ring_size);
+				for (size_t i = buffer->recorded - count; i < buffer->recorded; ++i)
+				{
+					const Event& event = buffer->events[i % ring_size];
+					json += ",\n{\"ph\":\"X\",\"pid\":1,\"name\":";
+					append_escaped(json, event.name);
+					snprintf(numbers, sizeof(numbers), ",\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", buffer->thread_id, event.start / 1000.0, event.duration / 1000.0);
+					json += numbers;
+				}
+			}
+		}
+		json += "\n]}\n";
+
+		const auto file = OutputFile::create(path, json.size());
+		if (!file || !file->write(json.data(), json.size()) || !file->commit())
+		{
+			logger_error("failed to write trace %s", path.string().c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Expression.h"
+#include "Resample.h"
+
+/*
+ * @Batch - Pack many outputs described by an ini manifest in a single run
+ *
+ *		std::vector<BatchOutput> outputs;
+ *		if (load_batch_manifest("materials.ini", outputs)) run_batch(outputs);
+ *
+ * Manifest : one category per output (path relative to the manifest), keys of [defaults] apply to every output
+ *
+ *		[defaults]
+ *		format=png                      ; outputs without extension (the format key of an output wins over its extension)
+ *
+ *		[rock/orm.png]
+ *		combination=rgb                 ; grayscale, rg, rgb or rgba (default : deduced from assigned channels)
+ *		r=rock/ao.png                   ; <path>[:<r|g|b|a>] or a constant value in [0, 255]
+ *		g=rock/roughness.png:r
+ *		b=0
+ *		expression_g=invert(g)          ; computed from the sources of r, g, b and a (see Expression.h)
+ *
+ *		[rock/albedo.tga]
+ *		source=rock/albedo.png          ; source of every unassigned channel
+ *		resample=lanczos                ; and size=<w>x<h>, see Resample.h
+ *
+ * Outputs and their source files form a graph : each file is decoded once, when its first output needs it, and released
+ * as soon as its last output is written. Outputs sharing files are run next to each other, and independent outputs run in parallel.
+ */
+
+namespace SuperPacker
+{
+	/** Content of one output channel : a channel of the file at path, or default_value if path is empty */
+	struct BatchChannel
+	{
+		std::filesystem::path path;
+		int source_channel = -1; // -1 : same channel as the output
+		int default_value = -1; // -1 : 0 for rgb, 255 for alpha
+	};
+
+	struct BatchOutput
+	{
+		std::filesystem::path path;
+		std::string format;
+		int channel_count = 4;
+		std::array<BatchChannel, 4> channels;
+		std::array<std::shared_ptr<const Expression>, 4> expressions;
+		std::optional<ResampleSettings> resample;
+	};
+
+	struct BatchStatistics
+	{
+		size_t written = 0;
+		size_t failed = 0;
+		size_t decoded = 0;
+		size_t peak_decoded = 0; // most source files held in memory at once
+	};
+
+	/** Index of channel r, g, b or a. Return -1 for any other name */
+	[[nodiscard]] int get_channel_index(const std::string& name);
+
+	/** Channels of grayscale, rg, rgb or rgba. Return 0 for any other name */
+	[[nodiscard]] int get_combination_channel_count(const std::string& name);
+
+	/** Parse <path>[:<r|g|b|a>] or a constant value in [0, 255]. Return false if value is invalid */
+	[[nodiscard]] bool parse_batch_channel(const std::string& value, BatchChannel& channel);
+
+	/** Read outputs of the manifest at path. Return false (with logged errors) if any output is invalid */
+	bool load_batch_manifest(const std::filesystem::path& path, std::vector<BatchOutput>& outputs);
+
+	/** Pack and write every output. Failed outputs are logged and do not stop the others */
+	BatchStatistics run_batch(const std::vector<BatchOutput>& outputs);
+}
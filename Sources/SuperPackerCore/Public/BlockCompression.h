@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ChannelView.h"
+
+/*
+ * @BlockCompression - BCn (S3TC / RGTC / BPTC) texture compression
+ *
+ *		const auto blocks = BlockCompression::compress(views, 2, BlockCompression::Format::BC5);
+ *
+ * Images are split into 4x4 blocks (edges repeat the last row and column), compressed in parallel by rows of blocks.
+ * Endpoints are fitted along the principal axis of each block then refined by least squares, and palette
+ * indices are searched with SSE2 when available.
+ */
+
+namespace SuperPacker::BlockCompression
+{
+	enum class Format
+	{
+		BC1, // rgb, 4 bits per pixel
+		BC3, // rgba, 8 bits per pixel
+		BC4, // r, 4 bits per pixel
+		BC5, // rg, 8 bits per pixel
+		BC7  // rgba, 8 bits per pixel (mode 6 only)
+	};
+
+	/** Bytes per 4x4 block */
+	[[nodiscard]] size_t get_block_size(Format format);
+
+	/** Format storing channel_count channels : BC4 (grayscale), BC5 (rg), BC1 (rgb) or BC3 (rgba) */
+	[[nodiscard]] Format get_default_format(int channel_count);
+
+	/** Parse bc1, bc3, bc4, bc5 or bc7. Return false if name is not a supported format */
+	[[nodiscard]] bool parse_format(const std::string& name, Format& format);
+
+	/** Compress 1 to 4 channel views of the same size. Missing color channels are read as 0, and missing alpha as 255 */
+	[[nodiscard]] std::vector<uint8_t> compress(const ChannelView* views, int channel_count, Format format);
+}
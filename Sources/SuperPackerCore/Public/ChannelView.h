@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "ImageKernels.h"
+
+namespace SuperPacker
+{
+	/**
+	 * Non-owning view over one channel of an image.
+	 * Can reference a plane, one channel of interleaved pixels, or a single constant value (pixel and row stride of 0)
+	 */
+	template <typename Type>
+	struct TChannelView
+	{
+		const Type* data = nullptr;
+		ptrdiff_t pixel_stride = 0; // elements between two pixels of a row
+		ptrdiff_t row_stride = 0;   // elements between two rows (can be negative for bottom-up images)
+		int width = 0;
+		int height = 0;
+
+		[[nodiscard]] const Type& at(const int x, const int y) const { return data[y * row_stride + x * pixel_stride]; }
+		[[nodiscard]] const Type* row(const int y) const { return data + y * row_stride; }
+
+		/** Pixels of each row are contiguous */
+		[[nodiscard]] bool is_dense() const { return pixel_stride == 1; }
+
+		/** The whole view is a single contiguous plane */
+		[[nodiscard]] bool is_plane() const { return pixel_stride == 1 && row_stride == width; }
+
+		bool operator==(const TChannelView&) const = default;
+
+		static TChannelView plane(const Type* data, const int width, const int height)
+		{
+			return { data, 1, width, width, height };
+		}
+
+		static TChannelView interleaved(const Type* pixels, const int channel, const int channel_count, const int width, const int height)
+		{
+			return { pixels + channel, channel_count, static_cast<ptrdiff_t>(width) * channel_count, width, height };
+		}
+
+		static TChannelView constant(const Type* value, const int width, const int height)
+		{
+			return { value, 0, 0, width, height };
+		}
+	};
+
+	typedef TChannelView<uint8_t> ChannelView;
+
+	/** Write rows [y_begin, y_end) of views as interleaved pixels (views[0].width * channel_count values per row) */
+	template <typename Type>
+	void interleave_views(const TChannelView<Type>* views, const int channel_count, Type* destination, const int y_begin, const int y_end)
+	{
+		if (channel_count <= 0 || y_begin >= y_end) return;
+		const int width = views[0].width;
+
+		bool planes = true;
+		bool dense = true;
+		for (int c = 0; c < channel_count; ++c)
+		{
+			planes &= views[c].is_plane();
+			dense &= views[c].is_dense();
+		}
+
+		// Contiguous planes : a single kernel call over all rows
+		if (planes)
+		{
+			const Type* rows[4];
+			for (int c = 0; c < channel_count; ++c) rows[c] = views[c].row(y_begin);
+			Kernels::interleave(rows, destination, channel_count, static_cast<size_t>(width) * (y_end - y_begin));
+			return;
+		}
+
+		for (int y = y_begin; y < y_end; ++y)
+		{
+			Type* output = destination + static_cast<size_t>(y - y_begin) * width * channel_count;
+			if (dense)
+			{
+				const Type* rows[4];
+				for (int c = 0; c < channel_count; ++c) rows[c] = views[c].row(y);
+				Kernels::interleave(rows, output, channel_count, width);
+				continue;
+			}
+
+			for (int c = 0; c < channel_count; ++c)
+			{
+				const Type* input = views[c].row(y);
+				const ptrdiff_t stride = views[c].pixel_stride;
+				for (int x = 0; x < width; ++x) output[static_cast<size_t>(x) * channel_count + c] = input[x * stride];
+			}
+		}
+	}
+
+	/** Overwrite a single channel of rows [y_begin, y_end) of interleaved pixels, leaving other channels untouched */
+	template <typename Type>
+	void write_channel_view(const TChannelView<Type>& view, const int channel, const int channel_count, Type* destination, const int y_begin, const int y_end)
+	{
+		const int width = view.width;
+		for (int y = y_begin; y < y_end; ++y)
+		{
+			Type* output = destination + static_cast<size_t>(y - y_begin) * width * channel_count + channel;
+			const Type* input = view.row(y);
+			const ptrdiff_t stride = view.pixel_stride;
+			for (int x = 0; x < width; ++x) output[static_cast<size_t>(x) * channel_count] = input[x * stride];
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/*
+ * @Deflate - Incremental zlib (RFC 1950 / 1951) streams
+ *
+ *		Deflate::ZlibEncoder encoder(6);
+ *		encoder.write(rows, size, compressed);  // as many times as needed
+ *		encoder.finish(compressed);
+ *
+ * Data is compressed in blocks as soon as enough input is available, so the memory used by a stream
+ * stays bounded by the 32KB window and the current block, whatever the size of the stream.
+ *
+ * With a chunk size, input is split into chunks compressed on every thread (like pigz) : each chunk is primed with
+ * the 32KB before it and ends with a sync flush, so the result is still a single standard zlib stream.
+ */
+
+namespace SuperPacker::Deflate
+{
+	[[nodiscard]] uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+	/** Adler-32 of the concatenation of two blocks, from their checksums and the size of the second one */
+	[[nodiscard]] uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2);
+	[[nodiscard]] uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+	class ZlibEncoder final
+	{
+	public:
+		/**
+		 * Level 0 only stores data, 1 is the fastest and 9 gives the smallest output.
+		 * A non zero chunk_size compresses input by chunks of this size in parallel.
+		 */
+		explicit ZlibEncoder(int level = 6, size_t chunk_size = 0);
+		~ZlibEncoder();
+
+		ZlibEncoder(const ZlibEncoder&) = delete;
+		ZlibEncoder& operator=(const ZlibEncoder&) = delete;
+
+		/** Compress data. Compressed bytes produced so far are appended to output */
+		void write(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+
+		/** Compress pending input, and align output on a byte boundary with an empty stored block */
+		void flush(std::vector<uint8_t>& output);
+
+		/** Compress pending input and terminate the stream */
+		void finish(std::vector<uint8_t>& output);
+
+	private:
+		struct Internal;
+		std::unique_ptr<Internal> internal;
+	};
+
+	class ZlibDecoder final
+	{
+	public:
+		/** Compressed data is pulled from read(buffer, size), which return the number of bytes written in buffer (0 at the end of the input) */
+		explicit ZlibDecoder(std::function<size_t(uint8_t* buffer, size_t size)> read);
+		~ZlibDecoder();
+
+		ZlibDecoder(const ZlibDecoder&) = delete;
+		ZlibDecoder& operator=(const ZlibDecoder&) = delete;
+
+		/** Decompress exactly size bytes into output. Return false if the stream is corrupted or ends before */
+		bool read(uint8_t* output, size_t size);
+
+	private:
+		struct Internal;
+		std::unique_ptr<Internal> internal;
+	};
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/*
+ * @Executor - Run a loop on every cores
+ *
+ *		Executor::parallel_for_rows(height, width * channels, [&](int y_begin, int y_end) { ... });
+ *
+ * Items are split into tiles, and each thread receive a contiguous range of tiles. A thread that completed
+ * its own range steals tiles from the end of other ranges, so uneven tiles still keep every core busy.
+ * The calling thread takes part in the work, so parallel_for can safely be called from a worker.
+ */
+
+namespace SuperPacker::Executor
+{
+	/** Set the number of threads running parallel loops (including the calling thread). 0 = hardware concurrency */
+	void set_thread_count(size_t thread_count);
+	[[nodiscard]] size_t get_thread_count();
+
+	/** Index of the current worker thread, or 255 if the current thread is not an executor worker */
+	[[nodiscard]] uint8_t get_worker_id();
+
+	/** Run function(begin, end) on every tile of [0, count) and wait for completion */
+	void parallel_for(size_t count, size_t tile_size, const std::function<void(size_t begin, size_t end)>& function);
+
+	/** Run function(y_begin, y_end) on bands of rows. Bands contain enough rows to process about 64KB each */
+	void parallel_for_rows(int height, size_t row_bytes, const std::function<void(int y_begin, int y_end)>& function);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * @Expression - Arithmetic over source channels, compiled once and evaluated by batches of samples
+ *
+ *		std::string error;
+ *		const auto expression = Expression::compile("lerp(r, 1 - g, 0.5) * a", { "r", "g", "b", "a" }, error);
+ *		const float* result = expression->evaluate(variables, scratch.data(), count);
+ *
+ * Samples are normalized floats ([0, 1] for 8 and 16 bits images). Supported syntax :
+ *		numbers, variables, + - * / and parentheses
+ *		min(x, y)  max(x, y)  clamp(x, low, high)  saturate(x)  abs(x)  invert(x) = 1 - x
+ *		lerp(x, y, t)  threshold(x, t) = x >= t ? 1 : 0  remap(x, in_low, in_high, out_low, out_high)
+ *
+ * Expressions are compiled to a list of operations over registers of one batch each (constants are folded), and every
+ * operation runs over the whole batch with SSE2, so no plane is ever allocated for intermediate results.
+ */
+
+namespace SuperPacker
+{
+	class Expression final
+	{
+	public:
+		/** Largest count accepted by evaluate() */
+		static constexpr size_t max_batch = 256;
+
+		/** Compile text, where each name of variables is a variable (variable i is read from variables[i] on evaluation). Return null and set error on failure */
+		[[nodiscard]] static std::shared_ptr<const Expression> compile(const std::string& text, const std::vector<std::string>& variables, std::string& error);
+
+		[[nodiscard]] const std::string& get_text() const { return text; }
+
+		/** Bit i is set if variable i is read by the expression */
+		[[nodiscard]] uint32_t get_variable_mask() const { return variable_mask; }
+
+		/** Floats of scratch memory needed by evaluate() */
+		[[nodiscard]] size_t get_scratch_size() const { return static_cast<size_t>(register_count - variable_count) * max_batch; }
+
+		/** Evaluate count samples (at most max_batch), where variables[i] holds count samples of variable i. Return the results, stored in scratch or in variables */
+		[[nodiscard]] const float* evaluate(const float* const* variables, float* scratch, size_t count) const;
+
+	private:
+		enum class Operation : uint8_t
+		{
+			Add,
+			Subtract,
+			Multiply,
+			Divide,
+			Min,
+			Max,
+			Abs,
+			Lerp,
+			Threshold
+		};
+
+		/** Registers [0, variable_count) are variables, then constants and intermediate results */
+		struct Instruction
+		{
+			Operation operation;
+			uint16_t output;
+			uint16_t inputs[3];
+		};
+
+		struct Constant
+		{
+			uint16_t output;
+			float value;
+		};
+
+		friend class ExpressionParser;
+
+		Expression() = default;
+
+		std::string text;
+		std::vector<Instruction> instructions;
+		std::vector<Constant> constants;
+		uint32_t variable_mask = 0;
+		int variable_count = 0;
+		int register_count = 0;
+		uint16_t result = 0;
+	};
+}
@@ -0,0 +1,240 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <stb_image.h>
+#include <vector>
+
+#include "ChannelView.h"
+#include "Executor.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "Trace.h"
+
+namespace SuperPacker {
+
+	/** Progress report and cancellation of an image being loaded on another thread */
+	struct LoadProgress
+	{
+		std::atomic<float> progress = 0.f;
+		std::atomic<bool> cancelled = false;
+	};
+
+	/** stb_image read callbacks over a mapped file, reporting read progress and stopping as soon as the load is cancelled */
+	class StbFileReader final
+	{
+	public:
+		StbFileReader(const MappedFile& in_file, LoadProgress* in_progress)
+			: file(in_file), progress(in_progress) {}
+
+		static const stbi_io_callbacks callbacks;
+
+	private:
+		static int read(void* user, char* data, int size);
+		static void skip(void* user, int n);
+		static int eof(void* user);
+
+		const MappedFile& file;
+		size_t position = 0;
+		LoadProgress* progress;
+	};
+
+	/**
+	 * Views of channels of an uncompressed TGA or BMP file, pointing straight into the mapping. Views of missing channels are
+	 * left null (alpha is opaque). Return false if pixels of the file cannot be referenced without decoding.
+	 */
+	bool map_raw_channels(const MappedFile& file, const std::filesystem::path& path, TChannelView<uint8_t> (&views)[4], int& width, int& height, int& channels);
+
+	/** CPU pixel storage. Images never touch the GPU : see ImageTexture for display */
+	class IImage
+	{
+	public:
+		explicit IImage(const std::filesystem::path& path)
+			: source_path(path) {}
+
+		explicit IImage(const int in_with, const int in_height, const int in_channels)
+			: width(in_with), height(in_height), channels(in_channels) {}
+
+		virtual ~IImage() = default;
+		
+		[[nodiscard]] int get_width() const { return width; }
+		[[nodiscard]] int get_height() const { return height; }
+		[[nodiscard]] int get_channels() const { return channels; }
+		[[nodiscard]] int get_display_channels() const { return display_channels; }
+		[[nodiscard]] bool is_valid() const { return width > 0 && height > 0; }
+
+		/** Bytes of pixel data owned by this image (pixels referenced in other images or in mapped files are not counted) */
+		[[nodiscard]] virtual size_t get_memory_size() const = 0;
+
+		std::optional<std::filesystem::path> source_path;
+		
+	protected:
+		int display_channels = 0;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+	};
+
+	template <typename Type>
+	class TImage final : public IImage
+	{
+	public:
+		/** Load image file. Progress is optional, and the image is left invalid if the load was cancelled */
+		explicit TImage(const std::filesystem::path& path, LoadProgress* progress = nullptr)
+			: TImage(MappedFile::open(path), path, progress) {}
+
+		/** Load image from the mapping of the file at path */
+		TImage(const std::shared_ptr<const MappedFile>& file, const std::filesystem::path& path, LoadProgress* progress)
+			: IImage(path)
+		{
+			display_channels = 4;
+			data.resize(4);
+
+			// Pixels of uncompressed files are referenced in place
+			if constexpr (std::is_same_v<Type, uint8_t>)
+			{
+				if (file && map_raw_channels(*file, path, views, width, height, channels))
+				{
+					mapping = file;
+					for (int c = 0; c < 4; ++c)
+						if (!views[c].data) set_channel_constant(255, c);
+					if (progress) progress->progress = 1.f;
+					return;
+				}
+			}
+
+			Type* raw_data = nullptr;
+			{
+				trace_zone("decode");
+				if (file) raw_data = decode(*file, progress);
+			}
+			if (!raw_data || (progress && progress->cancelled))
+			{
+				stbi_image_free(raw_data);
+				width = height = channels = 0;
+				return;
+			}
+			
+			trace_zone("deinterleave");
+			for (int c = 0; c < 4; ++c)
+			{
+				data[c].resize(static_cast<size_t>(width) * height);
+				views[c] = TChannelView<Type>::plane(data[c].data(), width, height);
+			}
+			Executor::parallel_for_rows(height, static_cast<size_t>(width) * 4 * sizeof(Type), [&](const int y_begin, const int y_end)
+			{
+				const size_t offset = static_cast<size_t>(y_begin) * width;
+				Type* planes[4];
+				for (int c = 0; c < 4; ++c) planes[c] = data[c].data() + offset;
+				Kernels::deinterleave(raw_data + offset * 4, planes, 4, static_cast<size_t>(y_end - y_begin) * width);
+			});
+
+			stbi_image_free(raw_data);
+			if (progress) progress->progress = 1.f;
+		}
+
+		/** Create an empty image : every channel is a constant 0 until it is assigned. Display channels default to in_channels */
+		explicit TImage(const int in_with, const int in_height, const int in_channels, const int in_display_channels = 0)
+			: IImage(in_with, in_height, in_channels)
+		{
+			display_channels = in_display_channels ? in_display_channels : in_channels;
+			data.resize(4);
+			for (int c = 0; c < 4; ++c) set_channel_constant(0, c);
+		}
+
+		TImage(const TImage&) = delete;
+		TImage& operator=(const TImage&) = delete;
+
+		/** Store channel_data as an owned plane */
+		void set_channel_data(std::vector<Type> channel_data, const int channel_offset)
+		{
+			data[channel_offset] = std::move(channel_data);
+			views[channel_offset] = TChannelView<Type>::plane(data[channel_offset].data(), width, height);
+		}
+
+		/** Reference pixels of another image without copying them. Owner is kept alive as long as it is referenced */
+		void set_channel_view(const TChannelView<Type>& view, const int channel_offset, const std::shared_ptr<const IImage>& owner)
+		{
+			data[channel_offset].clear();
+			views[channel_offset] = view;
+			view_owners[channel_offset] = owner;
+		}
+
+		/** Fill channel with a single value without allocating a plane */
+		void set_channel_constant(const Type value, const int channel_offset)
+		{
+			data[channel_offset].clear();
+			constants[channel_offset] = value;
+			views[channel_offset] = TChannelView<Type>::constant(&constants[channel_offset], width, height);
+			view_owners[channel_offset] = nullptr;
+		}
+
+		[[nodiscard]] Type get_pixel(const int channel, const int x, const int y) const
+		{
+			return views[channel].at(x, y);
+		}
+
+		[[nodiscard]] const TChannelView<Type>& get_channel_view(const int channel) const
+		{
+			return views[channel];
+		}
+
+		[[nodiscard]] size_t get_memory_size() const override
+		{
+			size_t size = 0;
+			for (const auto& plane : data) size += plane.size() * sizeof(Type);
+			return size;
+		}
+		
+		std::vector<Type> gen_data_from_channels(int desired_channels) const
+		{
+			std::vector<Type> result;
+			result.resize(static_cast<size_t>(width) * height * desired_channels);
+
+			Executor::parallel_for_rows(height, static_cast<size_t>(width) * desired_channels * sizeof(Type), [&](const int y_begin, const int y_end)
+			{
+				interleave_views(views, desired_channels, result.data() + static_cast<size_t>(y_begin) * width * desired_channels, y_begin, y_end);
+			});
+			
+			return result;
+		}
+	
+	private:
+
+		/** Decode file as 4 channels of Type : the stb_image decoder is selected at compile time */
+		Type* decode(const MappedFile& file, LoadProgress* progress)
+		{
+			// Callbacks report progress and can be cancelled, and stb cannot address more than 2GB of memory
+			if (progress || file.get_size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+			{
+				StbFileReader reader(file, progress);
+				if constexpr (std::is_same_v<Type, uint8_t>) return stbi_load_from_callbacks(&StbFileReader::callbacks, &reader, &width, &height, &channels, 4);
+				else if constexpr (std::is_same_v<Type, uint16_t>) return stbi_load_16_from_callbacks(&StbFileReader::callbacks, &reader, &width, &height, &channels, 4);
+				else return stbi_loadf_from_callbacks(&StbFileReader::callbacks, &reader, &width, &height, &channels, 4);
+			}
+
+			const auto size = static_cast<int>(file.get_size());
+			if constexpr (std::is_same_v<Type, uint8_t>) return stbi_load_from_memory(file.get_data(), size, &width, &height, &channels, 4);
+			else if constexpr (std::is_same_v<Type, uint16_t>) return stbi_load_16_from_memory(file.get_data(), size, &width, &height, &channels, 4);
+			else return stbi_loadf_from_memory(file.get_data(), size, &width, &height, &channels, 4);
+		}
+
+		std::vector<std::vector<Type>> data;
+		TChannelView<Type> views[4];
+		std::shared_ptr<const IImage> view_owners[4];
+		std::shared_ptr<const MappedFile> mapping;
+		Type constants[4] = {};
+	};
+
+	typedef TImage<uint8_t> Image;
+	typedef TImage<uint16_t> Image16;
+	typedef TImage<float> HdrImage;
+
+	/** Load image file with its own sample type : HdrImage for radiance files, Image16 for 16 bits files and Image otherwise */
+	[[nodiscard]] std::shared_ptr<IImage> load_image(const std::filesystem::path& path, LoadProgress* progress = nullptr);
+
+}
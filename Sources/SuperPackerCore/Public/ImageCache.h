@@ -0,0 +1,36 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+
+#include "Image.h"
+
+/*
+ * @ImageCache - Process-wide cache of decoded image files
+ *
+ * Images are identified by their canonical path, file size and last write time, so a modified file is decoded again.
+ * Cached images are shared between every user and must never be modified.
+ * Least recently used images are released from the cache when the memory budget is exceeded
+ * (they stay alive as long as someone still reference them).
+ */
+
+namespace SuperPacker::ImageCache
+{
+	struct Statistics
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+		size_t memory_size = 0;
+		size_t image_count = 0;
+	};
+
+	/** Get decoded image from the cache, or decode and store it. Concurrent loads of the same file are only decoded once */
+	[[nodiscard]] std::shared_ptr<const IImage> load(const std::filesystem::path& path, LoadProgress* progress = nullptr);
+
+	/** Maximum bytes of pixel data kept by the cache (default : 1GB) */
+	void set_memory_budget(size_t bytes);
+
+	[[nodiscard]] Statistics get_statistics();
+
+	void clear();
+}
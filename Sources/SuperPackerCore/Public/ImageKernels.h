@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/*
+ * Conversion kernels between interleaved pixels (RGBARGBA...) and separated planes (RRR... GGG...)
+ *
+ * Implemented for 1 to 4 channels with SSE2 (always available on x64), AVX2 if the project is
+ * compiled with ENABLE_AVX2, and a scalar fallback for remaining pixels and other architectures.
+ */
+
+namespace SuperPacker::Kernels
+{
+	/** Split pixel_count interleaved pixels of channel_count values into channel_count planes */
+	template <typename Type>
+	void deinterleave(const Type* source, Type* const* planes, int channel_count, size_t pixel_count);
+
+	/** Merge channel_count planes of pixel_count values into interleaved pixels */
+	template <typename Type>
+	void interleave(const Type* const* planes, Type* destination, int channel_count, size_t pixel_count);
+
+	/** output[i] += input[i] * weight for count values (rows of separable filters) */
+	void accumulate(float* output, const float* input, float weight, size_t count);
+
+	/**
+	 * output[i] = sum of input[first[i] + k] * weights[i * tap_count + k] for k < tap_count (horizontal pass of separable filters).
+	 * Vectorized over whole rows when tap_count is a multiple of 4 (see make_filter_taps).
+	 */
+	void filter_taps(float* output, const float* input, const int* first, const float* weights, int tap_count, size_t count);
+
+	/** Convert a sample to another type : integers use their full range, and floats are normalized in [0, 1] */
+	template <typename To, typename From>
+	constexpr To convert_sample(const From value)
+	{
+		if constexpr (std::is_same_v<To, From>) return value;
+		else if constexpr (std::is_floating_point_v<From> && std::is_floating_point_v<To>) return static_cast<To>(value);
+		else if constexpr (std::is_floating_point_v<From>) return static_cast<To>(std::clamp(static_cast<float>(value), 0.f, 1.f) * std::numeric_limits<To>::max() + 0.5f);
+		else if constexpr (std::is_floating_point_v<To>) return static_cast<To>(value) / static_cast<To>(std::numeric_limits<From>::max());
+		else return static_cast<To>((static_cast<uint64_t>(value) * std::numeric_limits<To>::max() + std::numeric_limits<From>::max() / 2) / std::numeric_limits<From>::max());
+	}
+
+	/** Name of the instruction set used by the kernels (for logs and benchmarks) */
+	const char* get_instruction_set();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Image.h"
+
+/*
+ * @ImageLoader - Decode image files on background threads
+ *
+ *		auto task = load_image_async("path/image.png");
+ *		...
+ *		if (task->get_state() == ImageLoadTask::State::Ready) use(task->get_image());
+ *
+ * Cancelled tasks stop reading their file as soon as possible and never deliver an image.
+ */
+
+namespace SuperPacker
+{
+	class ImageLoadTask final
+	{
+	public:
+		enum class State
+		{
+			Queued,
+			Decoding,
+			Ready,
+			Failed,
+			Cancelled
+		};
+
+		explicit ImageLoadTask(std::filesystem::path in_path)
+			: path(std::move(in_path)) {}
+
+		[[nodiscard]] const std::filesystem::path& get_path() const { return path; }
+		[[nodiscard]] State get_state() const { return state; }
+		[[nodiscard]] float get_progress() const { return load_progress.progress; }
+		[[nodiscard]] bool is_done() const { return state == State::Ready || state == State::Failed || state == State::Cancelled; }
+
+		/** Decoded image, only available once the task is ready */
+		[[nodiscard]] std::shared_ptr<const IImage> get_image() const;
+		[[nodiscard]] std::string get_error() const;
+
+		/** Stop decoding. The task will end in Cancelled state */
+		void cancel() { load_progress.cancelled = true; }
+
+	private:
+		friend void execute_load_task(ImageLoadTask& task);
+
+		const std::filesystem::path path;
+		std::atomic<State> state = State::Queued;
+		LoadProgress load_progress;
+
+		mutable std::mutex result_lock;
+		std::shared_ptr<const IImage> image;
+		std::string error;
+	};
+
+	/** Queue image decoding on a background thread */
+	[[nodiscard]] std::shared_ptr<ImageLoadTask> load_image_async(const std::filesystem::path& path);
+}
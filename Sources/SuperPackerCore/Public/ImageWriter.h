@@ -0,0 +1,25 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "Image.h"
+#include "Mipmap.h"
+
+namespace SuperPacker
+{
+	/**
+	 * Write image on disk. Format is the short name of the desired file format : png (Image or Image16),
+	 * tga, bmp, jpg, dds, ktx (Image) or hdr (HdrImage). Png, tga, bmp and jpg files are encoded by strips of rows (see StripWriter),
+	 * dds and ktx files are block compressed (see BlockCompression and TextureFile).
+	 * Files are written to a temporary file which replaces file_path once complete (see OutputFile). If mips are exported,
+	 * they are embedded in dds and ktx files, and written next to other formats as <name>_mip<level>.<extension>. Return false on error.
+	 */
+	bool write_image(const std::string& file_path, const std::string& format, const IImage& image);
+
+	/** Mip chain generated by write_image. Empty (default) only writes the base level */
+	void set_export_mips(const std::optional<MipSettings>& settings);
+	[[nodiscard]] std::optional<MipSettings> get_export_mips();
+
+	/** Path of the file of a mip level written next to file_path : <name>_mip<level>.<extension> */
+	[[nodiscard]] std::string get_mip_path(const std::string& file_path, int level);
+}
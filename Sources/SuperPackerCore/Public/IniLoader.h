@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * @IniLoader - Read and write ini files
+ *
+ * 1) Create a new IniLoader with desired file path
+ *			IniLoader my_loader("path/config.ini");
+ *
+ * 2) Read and write property from your loader
+ *			std::string value = myLoader.get_property_as_string("category_name", "property_name", "defaultValue");
+ *			myLoader.set_property_as_string("category_name", "property_name", "value");
+ *
+ * 3) Clear a property value by writing an empty string
+ *			myLoader.set_property_as_string("category_name", "property_name", "");
+ *
+ * 4) Modifications are saved in the background, save_delay after the last one (or call save() to write them now)
+ *
+ * The file is parsed in a single pass over its content : categories and properties are indexed by name, and every line keeps
+ * its original text (comments, spacing, order) until its value is modified. Saves keep the line endings of the loaded file. Saves write a temporary file renamed over the
+ * previous one (see OutputFile), so an interrupted save never truncates the config.
+ */
+
+
+class IniLoader final
+{
+public:
+
+	/** Delay between the last modification and its background save */
+	static constexpr std::chrono::milliseconds save_delay{ 500 };
+
+	/** Create a new ini loader - automatically load file at designed path or create path if file doesn't exist. Ini file must have '.ini extension' */
+	IniLoader(const std::string file_path);
+
+	/** Stop the background saver, and write modifications that were not saved yet */
+	~IniLoader();
+
+	IniLoader(const IniLoader&) = delete;
+	IniLoader& operator=(const IniLoader&) = delete;
+
+	/** Get ini property from category and property name. Default value is returned if we can't find any occurrence, or if it is not a valid number (strings may be written without quotes) */
+	[[nodiscard]] const std::string get_property_as_string(const std::string& categoryName, const std::string& propertyName, const std::string& defaultValue = "");
+	[[nodiscard]] double get_property_as_double(const std::string& categoryName, const std::string& propertyName, const double& defaultValue = 0.f);
+	[[nodiscard]] int get_property_as_int(const std::string& categoryName, const std::string& propertyName, const int& defaultValue = 0);
+	[[nodiscard]] bool get_property_as_double(const std::string& categoryName, const std::string& propertyName, const bool& defaultValue = false);
+	[[nodiscard]] bool get_property_as_bool(const std::string& categoryName, const std::string& propertyName, const bool& defaultValue = false) { return get_property_as_double(categoryName, propertyName, defaultValue); }
+
+	/** Name of every category, in file order */
+	[[nodiscard]] std::vector<std::string> get_categories() const;
+
+	/** Set ini property. Modifications are saved in the background (nothing is written if the value did not change) */
+	void set_property_as_string(const std::string& categoryName, const std::string& propertyName, const std::string& propertyValue) { set_property(categoryName, propertyName, std::string('"' + std::string(propertyValue) + '"')); }
+	void set_property_as_double(const std::string& categoryName, const std::string& propertyName, const double& propertyValue) { set_property(categoryName, propertyName, std::to_string(propertyValue)); }
+	void set_property_as_int(const std::string& categoryName, const std::string& propertyName, const int& propertyValue) { set_property(categoryName, propertyName, std::to_string(propertyValue)); }
+	void set_property_as_bool(const std::string& categoryName, const std::string& propertyName, const bool& propertyValue) { set_property(categoryName, propertyName, propertyValue ? "true" : "false"); }
+
+	/** Write pending modifications on disk now */
+	void save();
+
+private:
+
+	/** Line of the file : a view of the loaded content, or of its own text once modified */
+	struct IniLine
+	{
+		std::string_view text;
+		std::string modified_text;
+	};
+	typedef std::list<IniLine>::iterator LineIterator;
+
+	/** Property line, and position of its value in the line */
+	struct IniProperty
+	{
+		LineIterator line;
+		size_t value_offset = 0;
+		size_t value_size = 0;
+
+		[[nodiscard]] std::string_view value() const { return line->text.substr(value_offset, value_size); }
+	};
+
+	struct IniCategory
+	{
+		/** Last line of the category : new properties are inserted after it */
+		LineIterator last_line;
+		std::unordered_map<std::string, IniProperty> properties;
+	};
+
+	/** Internal methods */
+	[[nodiscard]] const std::string get_property(const std::string& categoryName, const std::string& propertyName) const;
+	void set_property(const std::string& categoryName, const std::string& propertyName, const std::string& propertyValue);
+	void clear_property(const std::string& categoryName, const std::string& propertyName);
+
+	void link_or_create();
+	void parse();
+
+	/** Replace the text of a line, or insert a new line before position */
+	static void set_line(IniLine& line, std::string text);
+	LineIterator insert_line(LineIterator position, std::string text);
+
+	/** Content of the file to write. Requires lock */
+	[[nodiscard]] std::string write_content() const;
+
+	/** Write current content if it changed since the last save (or always if forced) */
+	void save_content(bool force);
+
+	/** Background saver : wait for modifications, then for save_delay without modification */
+	void run_saver();
+
+	/** ini file path */
+	std::string source_file;
+
+	/** Loaded file, referenced by the lines that were not modified */
+	std::string content;
+	std::list<IniLine> lines;
+
+	/** Line ending of the loaded file ("\r\n" if its first line ends with one), written after every line */
+	std::string line_ending = "\n";
+
+	std::unordered_map<std::string, IniCategory> ini_categories;
+	std::vector<std::string> category_names;
+
+	mutable std::mutex lock;
+	std::condition_variable modified;
+	std::chrono::steady_clock::time_point last_modification;
+	uint64_t modification_count = 0;
+	uint64_t saved_count = 0;
+	bool stopping = false;
+	std::thread saver;
+
+	/** Keep saves (and their renames) in order */
+	std::mutex save_lock;
+};
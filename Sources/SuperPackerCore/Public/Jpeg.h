@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * @Jpeg - Baseline JPEG encoder with restart intervals
+ *
+ *		Jpeg::Encoder encoder(width, height, 3, 90, Jpeg::Subsampling::S420);
+ *		encoder.write_header(encoded);
+ *		encoder.write_rows(rows, row_count, encoded);  // as many times as needed
+ *		encoder.finish(encoded);
+ *
+ * Each row of MCUs (8 or 16 rows of pixels) is an independent restart interval, so the rows received by
+ * write_rows() are encoded on every thread, then concatenated with restart markers into a single standard file.
+ */
+
+namespace SuperPacker::Jpeg
+{
+	/** Chroma resolution : full (4:4:4), half horizontally (4:2:2) or half in both directions (4:2:0) */
+	enum class Subsampling
+	{
+		S444,
+		S422,
+		S420
+	};
+
+	class Encoder final
+	{
+	public:
+		/** Gray and gray alpha images are encoded as grayscale, alpha is dropped. Quality is in [1, 100] */
+		Encoder(int width, int height, int channels, int quality, Subsampling subsampling);
+		~Encoder();
+
+		Encoder(const Encoder&) = delete;
+		Encoder& operator=(const Encoder&) = delete;
+
+		/** Rows of pixels in each restart interval. Rows should be written by multiples of it (except the last ones) */
+		[[nodiscard]] int get_interval_rows() const;
+
+		/** Append markers up to the start of scan */
+		void write_header(std::vector<uint8_t>& output);
+
+		/** Encode the next row_count rows of interleaved 8 bits samples */
+		void write_rows(const uint8_t* rows, int row_count, std::vector<uint8_t>& output);
+
+		/** Append the end of image marker */
+		void finish(std::vector<uint8_t>& output);
+
+	private:
+		struct Internal;
+		std::unique_ptr<Internal> internal;
+	};
+}
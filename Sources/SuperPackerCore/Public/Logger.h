@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+ * @Logger - Console messages from any thread
+ *
+ *		logger_log("export to %s (%d channels)", path.c_str(), channels);
+ *
+ * Messages are formatted on the calling thread (in a stack buffer), pushed to a lock-free queue, and written by a background
+ * thread in batches : logging never blocks workers. Output is flushed after fatal messages, on logger::flush and at exit, not per batch.
+ * Levels below LOGGER_MIN_LEVEL (0 : log, 1 : validate, 2 : warning, 3 : error) are compiled out, without evaluating their arguments.
+ */
+
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
+
+#if _DEBUG
+#define LOGGER_PRINT(type, color, format, ...) logger::log_message(type, color, __FUNCTION__, __LINE__, nullptr, format, ##__VA_ARGS__)
+#define LOGGER_PRINT_FILE(type, color, format, ...) logger::log_message(type, color, __FUNCTION__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+#define LOGGER_BREAK() __debugbreak()
+#else
+#define LOGGER_PRINT(type, color, format, ...) logger::log_message(type, color, nullptr, 0, nullptr, format, ##__VA_ARGS__)
+#define LOGGER_PRINT_FILE(type, color, format, ...) logger::log_message(type, color, nullptr, 0, nullptr, format, ##__VA_ARGS__)
+#define LOGGER_BREAK()
+#endif
+
+/** Arguments of compiled out messages are only referenced in an unevaluated context */
+#define LOGGER_DISCARD(format, ...) ((void)sizeof(logger::log_format(format, ##__VA_ARGS__)))
+
+#if LOGGER_MIN_LEVEL <= 0
+#define logger_log(format, ...) LOGGER_PRINT("I", logger::ConsoleColor::CONSOLE_DISPLAY, format, ##__VA_ARGS__)
+#else
+#define logger_log(format, ...) LOGGER_DISCARD(format, ##__VA_ARGS__)
+#endif
+#if LOGGER_MIN_LEVEL <= 1
+#define logger_validate(format, ...) LOGGER_PRINT("V", logger::ConsoleColor::CONSOLE_VALIDATE, format, ##__VA_ARGS__)
+#else
+#define logger_validate(format, ...) LOGGER_DISCARD(format, ##__VA_ARGS__)
+#endif
+#if LOGGER_MIN_LEVEL <= 2
+#define logger_warning(format, ...) LOGGER_PRINT("W", logger::ConsoleColor::CONSOLE_WARNING, format, ##__VA_ARGS__)
+#else
+#define logger_warning(format, ...) LOGGER_DISCARD(format, ##__VA_ARGS__)
+#endif
+#if LOGGER_MIN_LEVEL <= 3
+#define logger_error(format, ...) LOGGER_PRINT_FILE("E", logger::ConsoleColor::CONSOLE_FAIL, format, ##__VA_ARGS__)
+#else
+#define logger_error(format, ...) LOGGER_DISCARD(format, ##__VA_ARGS__)
+#endif
+#define logger_fail(format, ...) { logger::log_message("F", logger::ConsoleColor::CONSOLE_ASSERT, __FUNCTION__, __LINE__, __FILE__, format, ##__VA_ARGS__); logger::flush(); LOGGER_BREAK(); exit(EXIT_FAILURE); }
+
+
+namespace logger
+{
+	enum ConsoleColor {
+		CONSOLE_FG_COLOR_BLACK = 0,
+		CONSOLE_FG_COLOR_BLUE = 1,
+		CONSOLE_FG_COLOR_GREEN = 2,
+		CONSOLE_FG_COLOR_RED = 4,
+		CONSOLE_FG_COLOR_LIGHT = 8,
+		CONSOLE_FG_COLOR_LIGHT_RED = CONSOLE_FG_COLOR_RED | CONSOLE_FG_COLOR_LIGHT,
+		CONSOLE_FG_COLOR_WHITE = CONSOLE_FG_COLOR_RED | CONSOLE_FG_COLOR_GREEN | CONSOLE_FG_COLOR_BLUE,
+		CONSOLE_FG_COLOR_ORANGE = CONSOLE_FG_COLOR_RED | CONSOLE_FG_COLOR_GREEN,
+		CONSOLE_FG_COLOR_VIOLET = CONSOLE_FG_COLOR_RED | CONSOLE_FG_COLOR_BLUE,
+		CONSOLE_FG_COLOR_LIGHT_BLUE = CONSOLE_FG_COLOR_GREEN | CONSOLE_FG_COLOR_BLUE,
+		CONSOLE_FG_COLOR_CYAN = CONSOLE_FG_COLOR_GREEN | CONSOLE_FG_COLOR_BLUE | CONSOLE_FG_COLOR_LIGHT,
+		CONSOLE_BG_COLOR_BLUE = 16,
+		CONSOLE_BG_COLOR_GREEN = 32,
+		CONSOLE_BG_COLOR_RED = 64,
+		CONSOLE_BG_COLOR_LIGHT = 128,
+		CONSOLE_DEFAULT = CONSOLE_FG_COLOR_WHITE,
+		CONSOLE_VALIDATE = CONSOLE_FG_COLOR_GREEN,
+		CONSOLE_DISPLAY = CONSOLE_FG_COLOR_LIGHT_BLUE,
+		CONSOLE_WARNING = CONSOLE_FG_COLOR_ORANGE,
+		CONSOLE_FAIL = CONSOLE_FG_COLOR_LIGHT_RED,
+		CONSOLE_ASSERT = CONSOLE_FG_COLOR_VIOLET | CONSOLE_BG_COLOR_RED | CONSOLE_BG_COLOR_GREEN | CONSOLE_BG_COLOR_LIGHT
+	};
+	
+	template<typename... Params>
+	std::string log_format(const char* format, Params... args) {
+		char buffer[512];
+		const int size = snprintf(buffer, sizeof(buffer), format, args...);
+		if (size < 0) return format;
+		if (static_cast<size_t>(size) < sizeof(buffer)) return std::string(buffer, size);
+		std::string result(size, '\0');
+		snprintf(result.data(), result.size() + 1, format, args...);
+		return result;
+	}
+	
+	/** Queue a message. Message is copied : the background writer adds time, thread and location */
+	void log_print(const char* type, int color, std::string_view message, const char* function = nullptr, size_t line = 0, const char* file = nullptr);
+
+	/** Format a message on the stack (the heap is only used for messages longer than 512 characters) and queue it */
+	template<typename... Params>
+	void log_message(const char* type, int color, const char* function, size_t line, const char* file, const char* format, Params... args) {
+		char buffer[512];
+		const int size = snprintf(buffer, sizeof(buffer), format, args...);
+		if (size < 0) log_print(type, color, format, function, line, file);
+		else if (static_cast<size_t>(size) < sizeof(buffer)) log_print(type, color, std::string_view(buffer, size), function, line, file);
+		else log_print(type, color, log_format(format, args...), function, line, file);
+	}
+
+	/** Wait until every message queued before this call is written and flushed */
+	void flush();
+
+	template<typename... Params>
+	void log(const char* format, Params... args)	{
+		log_message("I", CONSOLE_DISPLAY, nullptr, 0, nullptr, format, args...);
+	}
+	
+	template<typename... Params>
+	void validate(const char* format, Params... args) {
+		log_message("V", CONSOLE_VALIDATE, nullptr, 0, nullptr, format, args...);
+	}
+	
+	template<typename... Params>
+	void warning(const char* format, Params... args) {
+		log_message("W", CONSOLE_WARNING, nullptr, 0, nullptr, format, args...);
+	}
+		
+	template<typename... Params>
+	void error(const char* format, Params... args) {
+		log_message("E", CONSOLE_FAIL, nullptr, 0, nullptr, format, args...);
+	}
+
+	template<typename... Params>
+	void fail(const char* format, Params... args) {
+		log_message("F", CONSOLE_ASSERT, nullptr, 0, nullptr, format, args...);
+		flush();
+#if _DEBUG
+		__debugbreak();
+#endif
+		exit(EXIT_FAILURE);
+	}
+
+
+	void set_get_worker_func(uint8_t(*getter)());
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+/*
+ * @MappedFile - Read-only memory mapping of a whole file
+ *
+ * Pages are loaded by the system on first access and shared with its file cache, so file content is never copied
+ * into process buffers. The mapping stays valid as long as the MappedFile is alive.
+ */
+
+namespace SuperPacker
+{
+	class MappedFile final
+	{
+	public:
+		/** Map file content. Return null if the file cannot be opened or is empty */
+		[[nodiscard]] static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path);
+
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] const uint8_t* get_data() const { return data; }
+		[[nodiscard]] size_t get_size() const { return size; }
+
+	private:
+		MappedFile() = default;
+
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+#if _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+
+/*
+ * @Mipmap - Mip chains of packed images
+ *
+ *		MipSettings settings;
+ *		settings.coverage_thresholds[3] = 0.5f; // keep the alpha tested area of every level
+ *		const auto levels = generate_mips(image, settings);
+ *
+ * Each level is filtered from the previous one by a separable filter : rows of each channel are accumulated with SSE2,
+ * and destination rows are computed on every thread. Images of 8, 16 bits and float samples give levels of the same type.
+ */
+
+namespace SuperPacker
+{
+	enum class MipFilter
+	{
+		Box,   // average of the covered pixels
+		Kaiser // kaiser windowed sinc (width 3, alpha 4) : sharper levels
+	};
+
+	struct MipSettings
+	{
+		MipFilter filter = MipFilter::Kaiser;
+
+		/** Filter the rgb channels of images of 3 or 4 channels in linear space (sRGB decoded). Ignored for float images */
+		bool srgb = false;
+
+		/** Per channel threshold in [0, 1] whose coverage (ratio of samples above it) is preserved at every level. Disabled if not positive */
+		float coverage_thresholds[4] = { -1, -1, -1, -1 };
+	};
+
+	/** Parse box or kaiser. Return false if name is not a mip filter */
+	[[nodiscard]] bool parse_mip_filter(const std::string& name, MipFilter& filter);
+
+	/** Number of levels of a full chain, down to 1x1, including the base level */
+	[[nodiscard]] int get_mip_count(int width, int height);
+
+	/** Levels 1 (half size) to the last 1x1 level, with the channels and sample type of image. Constant channels stay constant */
+	[[nodiscard]] std::vector<std::shared_ptr<IImage>> generate_mips(const IImage& image, const MipSettings& settings);
+}
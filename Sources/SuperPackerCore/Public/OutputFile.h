@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+/*
+ * @OutputFile - Buffered file written next to its destination, then renamed over it
+ *
+ *		auto file = OutputFile::create(path, expected_size);
+ *		file->write(data, size);  // as many times as needed
+ *		if (!file->commit()) ...
+ *
+ * Writes are gathered in a large buffer, and the destination is only replaced once every byte was written,
+ * so a failed or interrupted export never leaves a truncated file behind.
+ */
+
+namespace SuperPacker
+{
+	class OutputFile final
+	{
+	public:
+		/** Create a temporary file in the directory of path, with expected_size bytes preallocated (if known). Return null on error */
+		[[nodiscard]] static std::unique_ptr<OutputFile> create(const std::filesystem::path& path, uint64_t expected_size = 0);
+
+		/** Delete the temporary file if it was not committed */
+		~OutputFile();
+
+		OutputFile(const OutputFile&) = delete;
+		OutputFile& operator=(const OutputFile&) = delete;
+
+		/** Return false if this or any previous write failed */
+		bool write(const void* data, size_t size);
+
+		/** Flush, close and atomically rename the temporary file to the destination, with the permissions of the file it replaces. Return false (and delete it) on any error */
+		bool commit();
+
+		/** Write callback for stbi_write_*_to_func, with the OutputFile as context */
+		static void stb_write(void* context, void* data, int size);
+
+	private:
+		OutputFile(std::filesystem::path in_path, std::filesystem::path in_temporary_path, FILE* in_file);
+
+		bool flush_buffer();
+
+		static constexpr size_t buffer_size = 4 * 1024 * 1024;
+
+		const std::filesystem::path path;
+		const std::filesystem::path temporary_path;
+		FILE* file;
+		std::vector<uint8_t> buffer;
+		bool failed = false;
+	};
+}
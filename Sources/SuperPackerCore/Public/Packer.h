@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Expression.h"
+#include "Image.h"
+#include "Resample.h"
+
+namespace SuperPacker
+{
+	/**
+	 * Content of one output channel : a channel of the assigned image, or default_value if no image is assigned.
+	 * If an expression is set, the channel is computed from inputs instead (variable i reads inputs[i], expressions of inputs are ignored).
+	 */
+	struct ChannelSource
+	{
+		std::shared_ptr<const IImage> image;
+		uint8_t source_channel = 0;
+		uint8_t default_value = 0;
+		std::shared_ptr<const Expression> expression;
+		std::vector<ChannelSource> inputs;
+	};
+
+	/**
+	 * Route sources into target (one output channel per source). Target is reused if its dimensions still match,
+	 * and reset to null if no source image is assigned or if source dimensions doesn't match (and resample is not set).
+	 * Channels of sources with the sample type of target are referenced, others are converted. Channels with an expression, and
+	 * channels of sources resampled to the output size, are all computed in a single pass over target, by batches of samples.
+	 * Return a mask of the output channels whose content changed (bit c = channel c, every bit if target was reallocated).
+	 */
+	template <typename Type>
+	uint32_t pack_channels(const std::vector<ChannelSource>& sources, std::shared_ptr<TImage<Type>>& target, const std::optional<ResampleSettings>& resample = {});
+
+	/**
+	 * Pack sources with the sample type stored by format : float for hdr, 16 bits for png if a source has more than 8 bits,
+	 * and 8 bits otherwise. Return null if sources cannot be packed.
+	 */
+	[[nodiscard]] std::shared_ptr<IImage> pack_for_format(const std::vector<ChannelSource>& sources, const std::string& format, const std::optional<ResampleSettings>& resample = {});
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace SuperPacker
+{
+	/** Pixel layout of an uncompressed (or RLE TGA) file : rows can be read from the file without any decoder */
+	struct RawImageLayout
+	{
+		// Values are bytes per pixel
+		enum class PixelFormat { Gray = 1, GrayAlpha = 2, Bgr = 3, Bgra = 4 };
+
+		int width = 0;
+		int height = 0;
+		PixelFormat format = PixelFormat::Bgr;
+		uint64_t data_offset = 0;
+		size_t row_size = 0; // bytes per row in the file, including padding
+		bool top_down = false;
+		bool rle = false;
+
+		[[nodiscard]] int get_pixel_size() const { return static_cast<int>(format); }
+	};
+
+	/** Bytes of file header needed by parse_raw_image_header */
+	constexpr size_t raw_image_header_size = 54;
+
+	/**
+	 * Find the pixel layout of true color or grayscale TGA files (uncompressed, or RLE with top-down rows) and 24 bits BMP files.
+	 * TGA files have no signature and are identified by their extension. Return nothing for other files.
+	 */
+	[[nodiscard]] std::optional<RawImageLayout> parse_raw_image_header(const uint8_t* header, size_t header_size, const std::filesystem::path& path);
+}
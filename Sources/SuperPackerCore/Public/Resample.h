@@ -0,0 +1,67 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+
+/*
+ * @Resample - Separable filters bringing images to another size
+ *
+ *		const FilterTaps taps = make_filter_taps(source_width, width, ResampleFilter::Lanczos);
+ *		for (int k = 0; k < taps.tap_count; ++k) sum += row[taps.first[x] + k] * taps.weights[x * taps.tap_count + k];
+ *
+ * Weights of each axis are computed once per size, then rows are filtered vertically with Kernels::accumulate and horizontally
+ * with Kernels::filter_taps (taps padded to multiples of 4). Downscaling widens the filters by the scale so every source pixel contributes.
+ */
+
+namespace SuperPacker
+{
+	enum class ResampleFilter
+	{
+		Nearest,  // closest source pixel
+		Bilinear, // tent of radius 1
+		Box,      // average of the covered pixels
+		Kaiser,   // kaiser windowed sinc (width 3, alpha 4)
+		Lanczos   // lanczos windowed sinc (width 3) : sharpest
+	};
+
+	/**
+	 * Weights of a resampling along one axis : destination pixel i is the sum of weights[i * tap_count + k] * source[first[i] + k].
+	 * Taps falling outside of the source are folded on the edge pixels.
+	 */
+	struct FilterTaps
+	{
+		int tap_count = 0;
+		std::vector<int> first;
+		std::vector<float> weights;
+	};
+
+	/** Size of the resampled sources when channels are packed */
+	struct ResampleSettings
+	{
+		ResampleFilter filter = ResampleFilter::Bilinear;
+
+		/** Output size. Each null dimension is the largest one of the sources */
+		int width = 0;
+		int height = 0;
+	};
+
+	/** Parse nearest, bilinear, box, kaiser or lanczos. Return false if name is not a resample filter */
+	[[nodiscard]] bool parse_resample_filter(const std::string& name, ResampleFilter& filter);
+
+	/** Parse <width>x<height> into settings. Return false if value is not a size of positive dimensions */
+	[[nodiscard]] bool parse_resample_size(const std::string& value, ResampleSettings& settings);
+
+	/**
+	 * Weights of filter from source_size to destination_size pixels (both positive). The tap count is rounded up to a multiple of
+	 * tap_multiple with null weights, so rows read by these taps need tap_multiple - 1 readable (finite) values past their end.
+	 */
+	[[nodiscard]] FilterTaps make_filter_taps(int source_size, int destination_size, ResampleFilter filter, int tap_multiple = 1);
+
+	/**
+	 * 8 bits box filtered copy of source whose largest side is at most max_size pixels (aspect ratio is kept).
+	 * Images of the same size always give proxies of the same size. 8 bits sources are returned as is if they are already small enough.
+	 */
+	[[nodiscard]] std::shared_ptr<const IImage> make_proxy(const std::shared_ptr<const IImage>& source, int max_size);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*
+ * @StreamPacker - Pack image files too large to be kept in memory
+ *
+ *		stream_pack({ { "albedo.tga", 0 }, { "mask.png", 0 }, { {}, 0, 128 } }, "out.png", "png");
+ *
+ * Sources are read by strips of rows, each strip is packed and written before the next one is read, so memory
+ * stays bounded by a few strips whatever the image size. TGA, BMP and PNG sources are decoded on demand
+ * (see StripReader), other files are decoded entirely first.
+ */
+
+namespace SuperPacker
+{
+	/** Content of one output channel : a channel of the file at path, or default_value if path is empty */
+	struct StreamSource
+	{
+		std::filesystem::path path;
+		uint8_t source_channel = 0;
+		uint8_t default_value = 0;
+	};
+
+	/**
+	 * Pack sources into file_path (one output channel per source). Format is png, tga, bmp or jpg. Png files are written
+	 * with 16 bits samples if a source has more than 8 bits. Return false if a source cannot be read or the output written.
+	 */
+	bool stream_pack(const std::vector<StreamSource>& sources, const std::string& file_path, const std::string& format, int strip_rows = 64);
+}
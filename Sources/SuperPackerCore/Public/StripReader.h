@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "Image.h"
+
+/*
+ * @StripReader - Read images from top to bottom by strips of rows
+ *
+ *		auto reader = open_strip_reader(path);
+ *		reader->read_rows(strip.data(), 64); // width * 4 samples per row
+ *
+ * Rows are always delivered as 4 channels (RGBA) like images decoded by stb_image, so that source channels
+ * have the same meaning in streamed and in memory packs. Samples are 8 bits, or 16 bits for 16 bits files.
+ */
+
+namespace SuperPacker
+{
+	class IStripReader
+	{
+	public:
+		virtual ~IStripReader() = default;
+
+		[[nodiscard]] int get_width() const { return width; }
+		[[nodiscard]] int get_height() const { return height; }
+
+		/** Bytes per sample of decoded rows : 1 (uint8_t) or 2 (uint16_t) */
+		[[nodiscard]] int get_sample_size() const { return sample_size; }
+
+		/** Decode the next row_count rows into destination. Return false on read error */
+		virtual bool read_rows(void* destination, int row_count) = 0;
+
+	protected:
+		int width = 0;
+		int height = 0;
+		int sample_size = 1;
+	};
+
+	/**
+	 * Open a reader decoding rows on demand from uncompressed TGA, 24 bits BMP or non interlaced PNG files.
+	 * Return null if the file cannot be streamed.
+	 */
+	[[nodiscard]] std::unique_ptr<IStripReader> open_strip_reader(const std::filesystem::path& path);
+
+	/** Read rows of an image already in memory, for files that cannot be streamed. Float samples are converted to 16 bits */
+	[[nodiscard]] std::unique_ptr<IStripReader> make_image_strip_reader(std::shared_ptr<const IImage> image);
+}
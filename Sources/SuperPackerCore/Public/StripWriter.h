@@ -0,0 +1,75 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "Jpeg.h"
+
+/*
+ * @StripWriter - Write images from top to bottom by strips of rows
+ *
+ *		auto writer = open_strip_writer(path, "png", width, height, 4, 1);
+ *		writer->write_rows(strip.data(), 64); // width * channels samples per row
+ *		writer->finish();
+ *
+ * Rows are encoded as soon as they are received, so only the current strip is kept in memory.
+ * Png rows are filtered and deflated on every thread, by chunks of rows. Jpeg rows are encoded on every thread,
+ * by restart intervals.
+ */
+
+namespace SuperPacker
+{
+	class IStripWriter
+	{
+	public:
+		virtual ~IStripWriter() = default;
+
+		/** Encode the next row_count rows of interleaved samples. Return false on write error */
+		virtual bool write_rows(const void* rows, int row_count) = 0;
+
+		/** Complete the file once every row was written, and move it to its destination. Return false on write error */
+		virtual bool finish() = 0;
+	};
+
+	/** Png row filter. Adaptive picks, for each row, the filter giving the smallest sum of absolute values */
+	enum class PngFilter
+	{
+		None,
+		Sub,
+		Up,
+		Average,
+		Paeth,
+		Adaptive
+	};
+
+	/** Deflate level of png files, from 0 (stored) to 9 (smallest). Default is 8 */
+	void set_png_compression_level(int level);
+	[[nodiscard]] int get_png_compression_level();
+
+	/** Row filter of png files. Default is adaptive */
+	void set_png_filter(PngFilter filter);
+	[[nodiscard]] PngFilter get_png_filter();
+
+	/** Parse none, sub, up, average, paeth or adaptive. Return false if name is not a png filter */
+	[[nodiscard]] bool parse_png_filter(const std::string& name, PngFilter& filter);
+
+	/** Quality of jpeg files, from 1 to 100. Default is 90 */
+	void set_jpeg_quality(int quality);
+	[[nodiscard]] int get_jpeg_quality();
+
+	/** Chroma subsampling of jpeg files. Default is 4:2:0 */
+	void set_jpeg_subsampling(Jpeg::Subsampling subsampling);
+	[[nodiscard]] Jpeg::Subsampling get_jpeg_subsampling();
+
+	/** Parse 444, 422 or 420. Return false if name is not a subsampling mode */
+	[[nodiscard]] bool parse_jpeg_subsampling(const std::string& name, Jpeg::Subsampling& subsampling);
+
+	/** Return true if rows of samples of sample_size bytes can be written to format by a strip writer */
+	[[nodiscard]] bool can_write_strips(const std::string& format, int sample_size);
+
+	/**
+	 * Create a temporary file next to file_path and write its header. The destination is only replaced by finish(), so
+	 * a writer destroyed before completion leaves no partial file. Format is png (8 or 16 bits samples), tga, bmp or jpg (8 bits samples).
+	 * Return null if the format is not supported or if the file cannot be created.
+	 */
+	[[nodiscard]] std::unique_ptr<IStripWriter> open_strip_writer(const std::string& file_path, const std::string& format, int width, int height, int channels, int sample_size);
+}
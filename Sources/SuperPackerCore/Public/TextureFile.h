@@ -0,0 +1,36 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+
+/*
+ * @TextureFile - DDS and KTX containers of block compressed textures
+ *
+ *		const std::vector<TextureLevel> levels = { { width, height, BlockCompression::compress(views, 4, format) } };
+ *		write_texture_file("out.dds", "dds", format, levels);
+ *
+ * Dds files use the legacy DXT1 / DXT5 / ATI1 / ATI2 headers (and a DX10 header for BC7), ktx files are KTX 1.1.
+ */
+
+namespace SuperPacker
+{
+	/** Blocks of one mip level, from the largest one */
+	struct TextureLevel
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<uint8_t> blocks;
+	};
+
+	/** Block format of dds and ktx files. Empty (default) picks it from the exported channel count (see BlockCompression::get_default_format) */
+	void set_texture_block_format(std::optional<BlockCompression::Format> format);
+	[[nodiscard]] std::optional<BlockCompression::Format> get_texture_block_format();
+
+	/** Return true if format is dds or ktx */
+	[[nodiscard]] bool is_texture_format(const std::string& format);
+
+	/** Write levels to a dds or ktx file, through an OutputFile. Return false on error */
+	[[nodiscard]] bool write_texture_file(const std::string& file_path, const std::string& format, BlockCompression::Format block_format, const std::vector<TextureLevel>& levels);
+}
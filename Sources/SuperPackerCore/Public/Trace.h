@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+/*
+ * @Trace - Scoped zones of the hot paths, exported as Chrome / Perfetto trace events
+ *
+ *		Trace::set_output("superpacker.trace.json"); // record, and write at exit
+ *		{
+ *			trace_zone("encode png");
+ *			...
+ *		}
+ *		Trace::write("now.trace.json"); // or dump on demand
+ *
+ * Each thread records its zones (start and duration) in its own ring buffer, so recording never waits on other threads.
+ * Zones are only recorded once tracing is enabled, and trace_zone compiles to nothing if SUPERPACKER_TRACING is 0.
+ */
+
+#ifndef SUPERPACKER_TRACING
+#define SUPERPACKER_TRACING 1
+#endif
+
+#define TRACE_CONCATENATE_INNER(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_INNER(a, b)
+
+#if SUPERPACKER_TRACING
+/** Record the enclosing scope. Name must be a string with static storage (a literal) */
+#define trace_zone(name) const SuperPacker::Trace::Zone TRACE_CONCATENATE(trace_zone_, __LINE__)(name)
+#else
+#define trace_zone(name) do {} while (false)
+#endif
+
+namespace SuperPacker::Trace
+{
+	/** Zones of each thread kept in memory : older zones are overwritten */
+	static constexpr size_t ring_size = 16384;
+
+	/** Start or stop recording zones. Recorded zones are kept */
+	void set_enabled(bool enabled);
+	[[nodiscard]] bool is_enabled();
+
+	/** Enable recording and write the trace to path at exit (empty path : nothing is written at exit) */
+	void set_output(const std::filesystem::path& path);
+
+	/** Write the recorded zones of every thread as trace event json. Return false on error */
+	bool write(const std::filesystem::path& path);
+
+	/** Forget recorded zones */
+	void clear();
+
+	/** Nanoseconds since the trace epoch (start of the process) */
+	[[nodiscard]] uint64_t now();
+
+	class Zone final
+	{
+	public:
+		explicit Zone(const char* in_name)
+			: name(is_enabled() ? in_name : nullptr), start(name ? now() : 0) {}
+
+		~Zone()
+		{
+			if (name) record(name, start, now() - start);
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		static void record(const char* name, uint64_t start, uint64_t duration);
+
+		const char* const name;
+		const uint64_t start;
+	};
+}